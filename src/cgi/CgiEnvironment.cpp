@@ -0,0 +1,33 @@
+#include "CgiEnvironment.hpp"
+#include "../config/ServerConfig.hpp"
+#include "../http/HttpResponse.hpp"
+
+#include <cstdlib>
+
+CgiEnvironment::CgiEnvironment() { }
+
+CgiEnvironment::~CgiEnvironment() { }
+
+void	CgiEnvironment::compile(const ServerConfig &server)
+{
+	const char	*path = getenv("PATH");
+
+	staticVariables.clear();
+	staticVariables.push_back("GATEWAY_INTERFACE=CGI/1.1");
+	staticVariables.push_back("SERVER_SOFTWARE=" SERVER_SOFTWARE);
+	staticVariables.push_back("SERVER_PORT=" + std::to_string(server.port));
+	staticVariables.push_back("DOCUMENT_ROOT=" + server.root);
+	staticVariables.push_back(std::string("PATH=") + (path ? path : DEFAULT_CGI_PATH));
+}
+
+// envp stays valid as long as this environment and requestVariables are not modified
+void	CgiEnvironment::build(const std::vector<std::string> &requestVariables, std::vector<char *> &envp) const
+{
+	envp.clear();
+	envp.reserve(staticVariables.size() + requestVariables.size() + 1);
+	for (size_t i = 0; i < staticVariables.size(); i++)
+		envp.push_back(const_cast<char *>(staticVariables[i].c_str()));
+	for (size_t i = 0; i < requestVariables.size(); i++)
+		envp.push_back(const_cast<char *>(requestVariables[i].c_str()));
+	envp.push_back(NULL);
+}
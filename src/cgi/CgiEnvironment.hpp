@@ -0,0 +1,36 @@
+
+
+
+#pragma once
+#ifndef CGIENVIRONMENT_HPP
+#define CGIENVIRONMENT_HPP
+
+#include <string>
+#include <vector>
+
+// PATH of the scripts when the server itself was started without one
+#define DEFAULT_CGI_PATH "/usr/local/bin:/usr/bin:/bin"
+
+class ServerConfig;
+
+/*
+	Environment of the CGI scripts of a server block. The variables that do
+	not depend on the request are formatted once, when the configuration is
+	loaded; a request only formats its own and the array handed to
+	posix_spawn points into both, nothing is copied again.
+*/
+class CgiEnvironment
+{
+private:
+	std::vector<std::string>	staticVariables;
+
+public:
+	CgiEnvironment();
+	~CgiEnvironment();
+
+	void	compile(const ServerConfig &server);
+	void	build(const std::vector<std::string> &requestVariables, std::vector<char *> &envp) const;
+};
+
+
+#endif /* CGIENVIRONMENT_HPP */
@@ -6,30 +6,39 @@
 #include "../http/RequestHandler.hpp"
 #include "../config/ServerConfig.hpp"
 #include "../event_polling/EventPoller.hpp"
+#include "CgiResponseHeaders.hpp"
 
 
 
 class CgiHandler
 {
 private:
-	int 												pid;
+	pid_t												pid;
 	int													pipeFd[2];
 	int													postBodyFd;
 	int													cgiClientSocket;
-	std::string											cgiResponseMessage;
-	std::chrono::time_point<std::chrono::steady_clock>	startTime;
+	std::string											cgiResponseMessage; // output read before the response is started
+	CgiResponseHeaders									responseHeaders;
+	CgiHeaderStatus										headerStatus;
+	std::chrono::time_point<std::chrono::steady_clock>	lastOutputTime;
 
 	bool												isValid;
+	bool												isStreaming; // the response is started, the rest of the output is streamed
+	bool												isOutputWatched; // the pipe is registered for READ
 	
 public:
-	CgiHandler(HttpRequest &request, ServerConfig &config, EventPoller *eventManager, int clientSocket,  const std::string &postPath = "");
+	CgiHandler(HttpRequest &request, ServerConfig &config, EventPoller *eventManager, int clientSocket, int bodyFd = -1);
 	~CgiHandler();
 	
-	std::string				buildCgiResponse();
+	HttpResponse			buildCgiResponse();
 	void					addCgiResponseMessage(const std::string &cgiOutput);
-	char					**initiateEnvVariables(HttpRequest &request, ServerConfig &serverConfig);
-	void					handleCgiDirective(HttpRequest &request,  ServerConfig &serverConfig, EventPoller *eventManager, const std::string &postPath);
-	void					delete2dArray(char **str);
+	CgiHeaderStatus			parseResponseHeaders(bool isComplete);
+	const CgiResponseHeaders	&getResponseHeaders() const;
+	void					initiateEnvVariables(HttpRequest &request, ServerConfig &serverConfig, std::vector<std::string> &envVector);
+	static const std::vector<VariableTemplate>	&getEnvTemplates();
+	void					addFormFieldVariables(HttpRequest &request, std::vector<std::string> &envVector);
+	void					handleCgiDirective(HttpRequest &request,  ServerConfig &serverConfig, EventPoller *eventManager);
+	bool					spawnScript(const std::string &scriptPath, char **envp);
 
 
 	int						getChildPid();
@@ -37,6 +46,11 @@ public:
 	int						getCgiReadFd() const;
 	const std::string		&getCgiResponseMessage() const;
 
+	void					watchOutput(EventPoller *eventManager, bool watch);
+	void					startStreaming();
+	bool					isStreamingOutput() const;
+	void					updateOutputTime();
+
 	//utilities
 	// void					closeCgiPipe();
 
@@ -0,0 +1,210 @@
+#include "CgiResponseHeaders.hpp"
+#include "../http/StatusCodes.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+CgiResponseHeaders::CgiResponseHeaders()
+	: statusCode(200), hasStatus(false), hasContentLength(false), contentLength(0), bodyStart(0) { }
+
+/*
+	Parses the header section at the start of "output", which may still be
+	incomplete while the script runs. "isComplete" tells that the script
+	closed its output, whatever was received is all there is.
+*/
+CgiHeaderStatus	CgiResponseHeaders::parse(const std::string &output, bool isComplete)
+{
+	bool	isDecided;
+	size_t	headerEnd;
+
+	*this = CgiResponseHeaders();
+	if (output.empty())
+		return (isComplete ? CGI_HEADERS_INVALID : CGI_HEADERS_INCOMPLETE);
+	bool hasHeaders = startsWithHeader(output, isComplete, isDecided);
+	if (!isDecided)
+		return (output.size() > CGI_MAX_HEADERS_SIZE ? CGI_HEADERS_INVALID : CGI_HEADERS_INCOMPLETE);
+	if (!hasHeaders)
+	{
+		this->statusMessage = StatusCodes::getReason(200);
+		return (CGI_HEADERS_COMPLETE);
+	}
+	headerEnd = findHeaderEnd(output, this->bodyStart);
+	if (headerEnd == std::string::npos)
+	{
+		if (output.size() > CGI_MAX_HEADERS_SIZE)
+			return (CGI_HEADERS_INVALID);
+		if (!isComplete)
+			return (CGI_HEADERS_INCOMPLETE);
+		// the script ended with its headers, there is no body
+		headerEnd = output.size();
+		this->bodyStart = output.size();
+	}
+	else if (headerEnd > CGI_MAX_HEADERS_SIZE)
+		return (CGI_HEADERS_INVALID);
+
+	size_t	lineStart = 0;
+	while (lineStart < headerEnd)
+	{
+		size_t lineEnd = output.find('\n', lineStart);
+		if (lineEnd == std::string::npos || lineEnd > headerEnd)
+			lineEnd = headerEnd;
+		std::string	line = output.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (!parseLine(line))
+			return (CGI_HEADERS_INVALID);
+	}
+	if (!this->hasStatus)
+	{
+		this->statusCode = this->location.empty() ? 200 : 302;
+		this->statusMessage = StatusCodes::getReason(this->statusCode);
+	}
+	return (CGI_HEADERS_COMPLETE);
+}
+
+// false for a Status or Content-Length that cannot be used, lines without a name are skipped
+bool	CgiResponseHeaders::parseLine(const std::string &line)
+{
+	size_t	colon = line.find(':');
+
+	if (colon == std::string::npos || colon == 0)
+		return (true);
+	std::string	name = line.substr(0, colon);
+	size_t		valueStart = line.find_first_not_of(" \t", colon + 1);
+	size_t		valueEnd = line.find_last_not_of(" \t");
+	std::string	value = (valueStart == std::string::npos) ? "" : line.substr(valueStart, valueEnd + 1 - valueStart);
+
+	if (strcasecmp(name.c_str(), "Status") == 0)
+	{
+		if (value.size() < 3 || !std::isdigit(value[0]) || !std::isdigit(value[1]) || !std::isdigit(value[2])
+			|| (value.size() > 3 && value[3] != ' '))
+			return (false);
+		this->statusCode = std::atoi(value.substr(0, 3).c_str());
+		if (this->statusCode < 100 || this->statusCode > 599)
+			return (false);
+		this->statusMessage = value.size() > 4 ? value.substr(4) : StatusCodes::getReason(this->statusCode);
+		this->hasStatus = true;
+	}
+	else if (strcasecmp(name.c_str(), "Content-Length") == 0)
+	{
+		const char	*end = value.data() + value.size();
+		if (value.empty() || std::from_chars(value.data(), end, this->contentLength).ptr != end)
+			return (false);
+		this->hasContentLength = true;
+	}
+	else if (strcasecmp(name.c_str(), "Date") != 0 && strcasecmp(name.c_str(), "Server") != 0
+		&& strcasecmp(name.c_str(), "Connection") != 0 && strcasecmp(name.c_str(), "Keep-Alive") != 0
+		&& strcasecmp(name.c_str(), "Transfer-Encoding") != 0)
+	{
+		if (strcasecmp(name.c_str(), "Location") == 0)
+			this->location = value;
+		this->headers.push_back(std::make_pair(name, value));
+	}
+	return (true);
+}
+
+/*
+	Position of the empty line that ends the header section, bodyStart is
+	set past it. npos while it was not received.
+*/
+size_t	CgiResponseHeaders::findHeaderEnd(const std::string &output, size_t &bodyStart)
+{
+	size_t	lineStart = 0;
+
+	while (lineStart < output.size())
+	{
+		if (output[lineStart] == '\n')
+		{
+			bodyStart = lineStart + 1;
+			return (lineStart);
+		}
+		if (output.compare(lineStart, 2, "\r\n") == 0)
+		{
+			bodyStart = lineStart + 2;
+			return (lineStart);
+		}
+		size_t lineEnd = output.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			break;
+		lineStart = lineEnd + 1;
+	}
+	return (std::string::npos);
+}
+
+/*
+	Whether the output starts with a header name and a colon, or with the
+	empty line of an empty header section. isDecided stays false while the
+	first line is all name characters and may still turn out to be either.
+*/
+bool	CgiResponseHeaders::startsWithHeader(const std::string &output, bool isComplete, bool &isDecided)
+{
+	isDecided = true;
+	if (output[0] == '\n' || output.compare(0, 2, "\r\n") == 0)
+		return (true);
+	if (output == "\r" && !isComplete)
+	{
+		isDecided = false;
+		return (false);
+	}
+	for (size_t i = 0; i < output.size(); i++)
+	{
+		if (output[i] == ':')
+			return (i > 0);
+		if (!std::isalnum(static_cast<unsigned char>(output[i])) && !std::strchr("!#$%&'*+-.^_`|~", output[i]))
+			return (false);
+	}
+	isDecided = isComplete;
+	return (false);
+}
+
+/*
+	Status line and headers of the response. The server's own Content-Type
+	is only a default the script's replaces.
+*/
+void	CgiResponseHeaders::apply(HttpResponse &response) const
+{
+	response.setVersion("HTTP/1.1");
+	response.setStatusCode(std::to_string(this->statusCode));
+	response.setStatusMessage(this->statusMessage);
+	response.setHeader("Content-Type", "text/html");
+	for (size_t i = 0; i < this->headers.size(); i++)
+		response.setHeader(this->headers[i].first, this->headers[i].second);
+	if (this->hasContentLength && allowsBody())
+		response.setContentLength(this->contentLength);
+}
+
+bool	CgiResponseHeaders::isLocalRedirect() const
+{
+	return (!this->hasStatus && this->location.size() > 0 && this->location[0] == '/'
+		&& this->location.compare(0, 2, "//") != 0);
+}
+
+const std::string	&CgiResponseHeaders::getLocation() const
+{
+	return (this->location);
+}
+
+// 1xx, 204 and 304 responses have no body whatever the script says
+bool	CgiResponseHeaders::allowsBody() const
+{
+	return (this->statusCode >= 200 && this->statusCode != 204 && this->statusCode != 304);
+}
+
+bool	CgiResponseHeaders::hasBodyLength() const
+{
+	return (this->hasContentLength || !allowsBody());
+}
+
+size_t	CgiResponseHeaders::getBodyLength() const
+{
+	return (allowsBody() ? this->contentLength : 0);
+}
+
+size_t	CgiResponseHeaders::getBodyStart() const
+{
+	return (this->bodyStart);
+}
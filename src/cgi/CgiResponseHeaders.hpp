@@ -0,0 +1,69 @@
+
+
+
+#pragma once
+#ifndef CGIRESPONSEHEADERS_HPP
+#define CGIRESPONSEHEADERS_HPP
+
+#include "../http/HttpResponse.hpp"
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// header section of a script's output beyond which it is answered with 502
+#define CGI_MAX_HEADERS_SIZE 16384 // 16 KB
+
+enum CgiHeaderStatus
+{
+	CGI_HEADERS_INCOMPLETE,
+	CGI_HEADERS_COMPLETE,
+	CGI_HEADERS_INVALID
+};
+
+/*
+	Header section of the output of a CGI script or FastCGI application
+	(RFC 3875, section 6): header lines ended by CRLF or a bare LF, up to an
+	empty line. "Status" sets the status line; a "Location" with a path and
+	no status is a local redirect the server follows itself, any other
+	"Location" without a status redirects the client with 302. A
+	Content-Length is kept so that a body of known size is passed on as is.
+	The headers the server writes itself (Date, Server, Connection,
+	Transfer-Encoding) are dropped, every other one is passed on.
+
+	Output that does not start with a header line is all body, sent as
+	text/html like scripts written for the earlier server expect.
+*/
+class CgiResponseHeaders
+{
+private:
+	int			statusCode;
+	std::string	statusMessage;
+	bool		hasStatus;
+	std::string	location;
+	bool		hasContentLength;
+	size_t		contentLength;
+	size_t		bodyStart;
+	std::vector<std::pair<std::string, std::string> >	headers;
+
+	bool		parseLine(const std::string &line);
+
+	static size_t	findHeaderEnd(const std::string &output, size_t &bodyStart);
+	static bool		startsWithHeader(const std::string &output, bool isComplete, bool &isDecided);
+
+public:
+	CgiResponseHeaders();
+
+	CgiHeaderStatus	parse(const std::string &output, bool isComplete);
+	void			apply(HttpResponse &response) const;
+
+	bool			isLocalRedirect() const;
+	bool			allowsBody() const;
+	const std::string	&getLocation() const;
+	bool			hasBodyLength() const;
+	size_t			getBodyLength() const;
+	size_t			getBodyStart() const;
+};
+
+
+#endif /* CGIRESPONSEHEADERS_HPP */
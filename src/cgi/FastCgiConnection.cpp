@@ -0,0 +1,249 @@
+#include "FastCgiConnection.hpp"
+#include "../logging/Logger.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+
+FastCgiConnection::FastCgiConnection(FastCgiPool *pool)
+	: fd(-1), pool(pool), connected(false), request(NULL), outputOffset(0), isBodySent(true), isReusable(false),
+	requestCount(0), hasAnswer(false), isOutputWatched(false) { }
+
+FastCgiConnection::~FastCgiConnection()
+{
+	if (fd != -1)
+		close(fd);
+	delete request;
+}
+
+/*
+	Starts connecting to the FastCGI server. The connection usually
+	completes later, sendRecords() finds out once the socket is writable.
+*/
+bool	FastCgiConnection::open(const FastCgiDirective &address)
+{
+	fd = socket(address.getSocketAddress()->sa_family, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		Logger::log(Logger::ERROR, "Failed to create a socket for FastCGI server " + address.getAddress() + ": " + std::string(strerror(errno)), "FastCgiConnection::open");
+		return (false);
+	}
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) < 0)
+	{
+		Logger::log(Logger::ERROR, "Failed to set FastCGI socket to non-blocking: " + std::string(strerror(errno)), "FastCgiConnection::open");
+		return (false);
+	}
+	if (connect(fd, address.getSocketAddress(), address.getSocketAddressLength()) == 0)
+		connected = true;
+	else if (errno != EINPROGRESS)
+	{
+		Logger::log(Logger::ERROR, "Failed to connect to FastCGI server " + address.getAddress() + ": " + std::string(strerror(errno)), "FastCgiConnection::open");
+		return (false);
+	}
+	Logger::log(Logger::DEBUG, "Connecting to FastCGI server " + address.getAddress() + " on fd " + std::to_string(fd), "FastCgiConnection::open");
+	return (true);
+}
+
+void	FastCgiConnection::start(FastCgiRequest *fastcgiRequest)
+{
+	this->request = fastcgiRequest;
+	this->output = fastcgiRequest->getRecords();
+	this->outputOffset = 0;
+	this->input.clear();
+	this->isBodySent = (fastcgiRequest->getBodyFd() == -1);
+	this->isReusable = false;
+	this->requestCount++;
+	this->hasAnswer = false;
+}
+
+bool	FastCgiConnection::checkConnected()
+{
+	int			error = 0;
+	socklen_t	length = sizeof(error);
+
+	if (connected)
+		return (true);
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0)
+		error = errno;
+	if (error != 0)
+	{
+		Logger::log(Logger::ERROR, "Failed to connect to FastCGI server: " + std::string(strerror(error)), "FastCgiConnection::checkConnected");
+		return (false);
+	}
+	connected = true;
+	return (true);
+}
+
+// next chunk of the body as a STDIN record, an empty record once it is all sent
+bool	FastCgiConnection::queueBody()
+{
+	char	buffer[FASTCGI_STDIN_CHUNK_SIZE];
+	ssize_t	bytesRead = request->readBody(buffer, sizeof(buffer));
+
+	if (bytesRead < 0)
+	{
+		Logger::log(Logger::ERROR, "Failed to read the request body: " + std::string(strerror(errno)), "FastCgiConnection::queueBody");
+		return (false);
+	}
+	FastCgiRequest::appendRecord(output, FASTCGI_STDIN, buffer, bytesRead);
+	if (bytesRead == 0)
+		isBodySent = true;
+	return (true);
+}
+
+FastCgiStatus	FastCgiConnection::sendRecords()
+{
+	if (request == NULL || !checkConnected())
+		return (FASTCGI_ERROR);
+	while (true)
+	{
+		if (outputOffset == output.size())
+		{
+			output.clear();
+			outputOffset = 0;
+			if (isBodySent)
+				return (FASTCGI_DONE);
+			if (!queueBody())
+				return (FASTCGI_ERROR);
+		}
+		ssize_t sent = send(fd, output.data() + outputOffset, output.size() - outputOffset, 0);
+		if (sent < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return (FASTCGI_AGAIN);
+			Logger::log(Logger::ERROR, "Failed to send to FastCGI server: " + std::string(strerror(errno)), "FastCgiConnection::sendRecords");
+			return (FASTCGI_ERROR);
+		}
+		outputOffset += sent;
+	}
+}
+
+FastCgiStatus	FastCgiConnection::receiveRecords()
+{
+	char	buffer[FASTCGI_READ_BUFFER_SIZE];
+	ssize_t	bytesRead = recv(fd, buffer, sizeof(buffer), 0);
+
+	if (bytesRead < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return (FASTCGI_AGAIN);
+		Logger::log(Logger::ERROR, "Failed to receive from FastCGI server: " + std::string(strerror(errno)), "FastCgiConnection::receiveRecords");
+		return (FASTCGI_ERROR);
+	}
+	// an idle connection closed by the server, or a response cut short
+	if (bytesRead == 0 || request == NULL)
+		return (FASTCGI_ERROR);
+	hasAnswer = true;
+	input.append(buffer, bytesRead);
+	return (parseRecords());
+}
+
+FastCgiStatus	FastCgiConnection::parseRecords()
+{
+	size_t	offset = 0;
+
+	while (input.size() - offset >= FASTCGI_HEADER_SIZE)
+	{
+		const unsigned char	*header = reinterpret_cast<const unsigned char *>(input.data() + offset);
+		size_t				contentLength = (header[4] << 8) | header[5];
+		size_t				recordSize = FASTCGI_HEADER_SIZE + contentLength + header[6];
+		int					requestId = (header[2] << 8) | header[3];
+
+		if (header[0] != FASTCGI_VERSION)
+		{
+			Logger::log(Logger::ERROR, "Unsupported FastCGI record version " + std::to_string(header[0]), "FastCgiConnection::parseRecords");
+			return (FASTCGI_ERROR);
+		}
+		if (input.size() - offset < recordSize)
+			break;
+		const char	*content = input.data() + offset + FASTCGI_HEADER_SIZE;
+		offset += recordSize;
+		// management records (id 0) are not expected, nothing is asked
+		if (requestId != FASTCGI_REQUEST_ID)
+			continue;
+		if (header[1] == FASTCGI_STDOUT)
+			request->appendOutput(content, contentLength);
+		else if (header[1] == FASTCGI_STDERR && contentLength > 0)
+			Logger::log(Logger::WARN, "FastCGI application: " + std::string(content, contentLength), "FastCgiConnection::parseRecords");
+		else if (header[1] == FASTCGI_END_REQUEST)
+		{
+			if (contentLength < 8 || content[4] != FASTCGI_REQUEST_COMPLETE)
+			{
+				Logger::log(Logger::ERROR, "The FastCGI server rejected the request", "FastCgiConnection::parseRecords");
+				return (FASTCGI_ERROR);
+			}
+			// a connection with unsent body or unread records is out of step, it is not reused
+			isReusable = (isBodySent && outputOffset == output.size() && offset == input.size());
+			input.clear();
+			return (FASTCGI_DONE);
+		}
+	}
+	input.erase(0, offset);
+	return (FASTCGI_AGAIN);
+}
+
+FastCgiRequest	*FastCgiConnection::detachRequest()
+{
+	FastCgiRequest	*fastcgiRequest = this->request;
+
+	this->request = NULL;
+	this->output.clear();
+	this->outputOffset = 0;
+	return (fastcgiRequest);
+}
+
+/*
+	A connection still sending the body keeps being read: with epoll both
+	directions are one registration, unwatching the output would stop the
+	body as well.
+*/
+void	FastCgiConnection::watchOutput(EventPoller *eventManager, bool watch)
+{
+	if (watch == this->isOutputWatched || (!watch && (!isBodySent || outputOffset < output.size())))
+		return;
+	if (watch)
+		eventManager->registerEvent(this->fd, READ);
+	else
+		eventManager->unregisterEvent(this->fd, READ);
+	this->isOutputWatched = watch;
+}
+
+bool	FastCgiConnection::isWatchingOutput() const
+{
+	return (this->isOutputWatched);
+}
+
+int	FastCgiConnection::getFd() const
+{
+	return (this->fd);
+}
+
+FastCgiPool	*FastCgiConnection::getPool() const
+{
+	return (this->pool);
+}
+
+FastCgiRequest	*FastCgiConnection::getRequest() const
+{
+	return (this->request);
+}
+
+bool	FastCgiConnection::canBeReused() const
+{
+	return (this->isReusable);
+}
+
+/*
+	The current request failed on a connection that served others before,
+	with nothing received for it: the server closed the connection while it
+	was idle and never saw the request.
+*/
+bool	FastCgiConnection::canRetryRequest() const
+{
+	return (this->request && this->requestCount > 1 && !this->hasAnswer);
+}
@@ -0,0 +1,87 @@
+
+
+
+#pragma once
+#ifndef FASTCGICONNECTION_HPP
+#define FASTCGICONNECTION_HPP
+
+#include "FastCgiRequest.hpp"
+#include "FastCgiDirective.hpp"
+#include "../event_polling/EventPoller.hpp"
+
+#include <string>
+#include <cstddef>
+
+// bytes read from a FastCGI connection per event
+#define FASTCGI_READ_BUFFER_SIZE 16384 // 16 KB
+
+// body bytes sent per STDIN record, the records are queued once the previous ones are sent
+#define FASTCGI_STDIN_CHUNK_SIZE 32768 // 32 KB
+
+// response bytes waiting for the client beyond which the connection is no longer read
+#define FASTCGI_MAX_BUFFERED_OUTPUT 65536 // 64 KB
+
+class FastCgiPool;
+
+enum FastCgiStatus
+{
+	FASTCGI_AGAIN, // waiting for the socket
+	FASTCGI_DONE, // everything was sent, or the response is complete
+	FASTCGI_ERROR
+};
+
+/*
+	Non-blocking connection to a FastCGI server, carrying one request at a
+	time and kept open between them (FCGI_KEEP_CONN). The records of the
+	request are written as the socket accepts them, the body is read from
+	its descriptor a chunk at a time so a large upload never sits in memory.
+	STDOUT is handed to the request, STDERR is logged and END_REQUEST
+	completes it. Reading stops while the client is too far behind, the
+	application then blocks on its output. A kept connection may be closed
+	by the server while it is idle, which is only noticed once the next
+	request fails on it.
+*/
+class FastCgiConnection
+{
+private:
+	int					fd;
+	FastCgiPool			*pool; // the connection is counted there until it is closed
+	bool				connected;
+	FastCgiRequest		*request;
+	std::string			output; // records not written yet
+	size_t				outputOffset;
+	std::string			input; // records not complete yet
+	bool				isBodySent;
+	bool				isReusable;
+	size_t				requestCount; // requests started on the connection, the current one included
+	bool				hasAnswer; // something was received for the current request
+	bool				isOutputWatched;
+
+	bool				checkConnected();
+	bool				queueBody();
+	FastCgiStatus		parseRecords();
+
+	FastCgiConnection(const FastCgiConnection &other);
+	FastCgiConnection	&operator=(const FastCgiConnection &other);
+
+public:
+	FastCgiConnection(FastCgiPool *pool);
+	~FastCgiConnection();
+
+	bool				open(const FastCgiDirective &address);
+	void				start(FastCgiRequest *fastcgiRequest);
+	FastCgiStatus		sendRecords();
+	FastCgiStatus		receiveRecords();
+	FastCgiRequest		*detachRequest();
+	void				watchOutput(EventPoller *eventManager, bool watch);
+	bool				isWatchingOutput() const;
+
+	int					getFd() const;
+	FastCgiPool			*getPool() const;
+	FastCgiRequest		*getRequest() const;
+	bool				canBeReused() const;
+	bool				canRetryRequest() const;
+};
+
+
+#endif /* FASTCGICONNECTION_HPP */
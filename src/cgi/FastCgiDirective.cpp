@@ -0,0 +1,82 @@
+#include "FastCgiDirective.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <netdb.h>
+#include <sys/un.h>
+
+FastCgiDirective::FastCgiDirective() : socketAddressLength(0), _isEnabled(false)
+{
+	memset(&socketAddress, 0, sizeof(socketAddress));
+}
+
+FastCgiDirective::~FastCgiDirective() { }
+
+void	FastCgiDirective::setAddress(const std::string &value)
+{
+	if (value.compare(0, sizeof(FASTCGI_UNIX_PREFIX) - 1, FASTCGI_UNIX_PREFIX) == 0)
+		setUnixAddress(value.substr(sizeof(FASTCGI_UNIX_PREFIX) - 1));
+	else
+		setInetAddress(value);
+	this->address = value;
+	_isEnabled = true;
+}
+
+void	FastCgiDirective::setUnixAddress(const std::string &path)
+{
+	struct sockaddr_un	*unixAddress = reinterpret_cast<struct sockaddr_un *>(&socketAddress);
+
+	if (path.empty() || path.size() >= sizeof(unixAddress->sun_path))
+		throw std::runtime_error("invalid socket path in \"fastcgi_pass\" directive: \"" + path + "\"");
+	memset(&socketAddress, 0, sizeof(socketAddress));
+	unixAddress->sun_family = AF_UNIX;
+	memcpy(unixAddress->sun_path, path.c_str(), path.size() + 1);
+	socketAddressLength = sizeof(struct sockaddr_un);
+}
+
+void	FastCgiDirective::setInetAddress(const std::string &hostAndPort)
+{
+	size_t		colon = hostAndPort.rfind(':');
+	std::string	host = hostAndPort.substr(0, colon == std::string::npos ? 0 : colon);
+	std::string	port = colon == std::string::npos ? "" : hostAndPort.substr(colon + 1);
+
+	if (host.empty() || port.empty() || port.size() > 5
+		|| port.find_first_not_of("0123456789") != std::string::npos
+		|| std::atoi(port.c_str()) == 0 || std::atoi(port.c_str()) > 65535)
+		throw std::runtime_error("invalid address in \"fastcgi_pass\" directive: \"" + hostAndPort + "\", expected \"host:port\" or \"unix:/path\"");
+
+	struct addrinfo	hints;
+	struct addrinfo	*result = NULL;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+	if (status != 0 || result == NULL)
+		throw std::runtime_error("host not found in \"fastcgi_pass\" directive: \"" + hostAndPort + "\"");
+	memset(&socketAddress, 0, sizeof(socketAddress));
+	memcpy(&socketAddress, result->ai_addr, result->ai_addrlen);
+	socketAddressLength = result->ai_addrlen;
+	freeaddrinfo(result);
+}
+
+const std::string	&FastCgiDirective::getAddress() const
+{
+	return (this->address);
+}
+
+const struct sockaddr	*FastCgiDirective::getSocketAddress() const
+{
+	return (reinterpret_cast<const struct sockaddr *>(&this->socketAddress));
+}
+
+socklen_t	FastCgiDirective::getSocketAddressLength() const
+{
+	return (this->socketAddressLength);
+}
+
+bool	FastCgiDirective::isEnabled() const
+{
+	return (this->_isEnabled);
+}
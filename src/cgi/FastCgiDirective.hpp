@@ -0,0 +1,44 @@
+
+
+
+#pragma once
+#ifndef FASTCGIDIRECTIVE_HPP
+# define FASTCGIDIRECTIVE_HPP
+
+
+#include <string>
+#include <sys/socket.h>
+
+#define FASTCGI_UNIX_PREFIX "unix:"
+
+/*
+	Address of the FastCGI server of a location, "fastcgi_pass unix:/path"
+	or "fastcgi_pass host:port". Host names are resolved once, when the
+	configuration is loaded, the event loop never waits for a resolver.
+*/
+class FastCgiDirective
+{
+private:
+	std::string				address; // as written in the configuration, names the connection pool
+	struct sockaddr_storage	socketAddress;
+	socklen_t				socketAddressLength;
+	bool					_isEnabled;
+
+	void	setUnixAddress(const std::string &path);
+	void	setInetAddress(const std::string &hostAndPort);
+
+public:
+	FastCgiDirective();
+	~FastCgiDirective();
+
+	void	setAddress(const std::string &value);
+
+
+	const std::string		&getAddress() const;
+	const struct sockaddr	*getSocketAddress() const;
+	socklen_t				getSocketAddressLength() const;
+	bool					isEnabled() const;
+};
+
+
+#endif /* FASTCGIDIRECTIVE_HPP */
@@ -0,0 +1,125 @@
+#include "FastCgiPool.hpp"
+
+#include <algorithm>
+
+FastCgiPool::FastCgiPool(const FastCgiDirective &address) : address(address), busyCount(0) { }
+
+// the connections belong to the Server, only the waiting requests are the pool's
+FastCgiPool::~FastCgiPool()
+{
+	for (size_t i = 0; i < queue.size(); i++)
+		delete queue[i];
+}
+
+bool	FastCgiPool::isSaturated() const
+{
+	return (idleConnections.empty() && busyCount >= FASTCGI_MAX_CONNECTIONS);
+}
+
+/*
+	The most recently released connection is reused first, it is the least
+	likely to have been closed by the server meanwhile; a retry skips them
+	for a new connection. NULL is returned when the pool is saturated or the
+	new connection could not be opened.
+*/
+FastCgiConnection	*FastCgiPool::acquire(bool &isNew, bool reuseIdle)
+{
+	isNew = false;
+	if (reuseIdle && !idleConnections.empty())
+	{
+		FastCgiConnection *connection = idleConnections.back();
+		idleConnections.pop_back();
+		busyCount++;
+		return (connection);
+	}
+	if (busyCount >= FASTCGI_MAX_CONNECTIONS)
+		return (NULL);
+	FastCgiConnection *connection = new FastCgiConnection(this);
+	if (!connection->open(address))
+	{
+		delete connection;
+		return (NULL);
+	}
+	isNew = true;
+	busyCount++;
+	return (connection);
+}
+
+void	FastCgiPool::release(FastCgiConnection *connection)
+{
+	busyCount--;
+	idleConnections.push_back(connection);
+}
+
+// a connection that is about to be closed, idle or busy
+void	FastCgiPool::remove(FastCgiConnection *connection)
+{
+	std::vector<FastCgiConnection *>::iterator it = std::find(idleConnections.begin(), idleConnections.end(), connection);
+
+	if (it != idleConnections.end())
+		idleConnections.erase(it);
+	else
+		busyCount--;
+}
+
+bool	FastCgiPool::enqueue(FastCgiRequest *request)
+{
+	if (queue.size() >= FASTCGI_MAX_QUEUED_REQUESTS)
+		return (false);
+	queue.push_back(request);
+	return (true);
+}
+
+FastCgiRequest	*FastCgiPool::dequeue()
+{
+	if (queue.empty())
+		return (NULL);
+	FastCgiRequest *request = queue.front();
+	queue.pop_front();
+	return (request);
+}
+
+// drops the waiting request of a client that went away
+void	FastCgiPool::cancel(int clientSocket)
+{
+	std::deque<FastCgiRequest *>::iterator it = queue.begin();
+	while (it != queue.end())
+	{
+		if ((*it)->getClientSocket() == clientSocket)
+		{
+			delete *it;
+			it = queue.erase(it);
+		}
+		else
+			it++;
+	}
+}
+
+bool	FastCgiPool::hasQueuedRequests() const
+{
+	return (!queue.empty());
+}
+
+// waiting requests older than the timeout, removed from the queue
+std::vector<FastCgiRequest *>	FastCgiPool::takeTimedOut(size_t timeout)
+{
+	std::vector<FastCgiRequest *>	timedOut;
+	std::deque<FastCgiRequest *>::iterator it = queue.begin();
+
+	while (it != queue.end())
+	{
+		if ((*it)->isTimedOut(timeout))
+		{
+			timedOut.push_back(*it);
+			it = queue.erase(it);
+		}
+		else
+			it++;
+	}
+	return (timedOut);
+}
+
+const std::string	&FastCgiPool::getAddress() const
+{
+	return (this->address.getAddress());
+}
@@ -0,0 +1,56 @@
+
+
+
+#pragma once
+#ifndef FASTCGIPOOL_HPP
+#define FASTCGIPOOL_HPP
+
+#include "FastCgiConnection.hpp"
+
+#include <vector>
+#include <deque>
+
+// connections opened to one FastCGI server, requests wait in the queue beyond it
+#define FASTCGI_MAX_CONNECTIONS 16
+
+// requests waiting for a connection before new ones are answered with 503
+#define FASTCGI_MAX_QUEUED_REQUESTS 256
+
+/*
+	Connections to one FastCGI server. A request takes an idle connection,
+	or opens a new one while fewer than FASTCGI_MAX_CONNECTIONS are busy,
+	and otherwise waits in the queue until a connection is released. The
+	pool only keeps track of the connections, they are owned and polled by
+	the Server.
+*/
+class FastCgiPool
+{
+private:
+	FastCgiDirective				address;
+	std::vector<FastCgiConnection *>	idleConnections;
+	size_t							busyCount;
+	std::deque<FastCgiRequest *>	queue;
+
+	FastCgiPool(const FastCgiPool &other);
+	FastCgiPool	&operator=(const FastCgiPool &other);
+
+public:
+	FastCgiPool(const FastCgiDirective &address);
+	~FastCgiPool();
+
+	bool				isSaturated() const;
+	FastCgiConnection	*acquire(bool &isNew, bool reuseIdle = true);
+	void				release(FastCgiConnection *connection);
+	void				remove(FastCgiConnection *connection);
+
+	bool				enqueue(FastCgiRequest *request);
+	FastCgiRequest		*dequeue();
+	void				cancel(int clientSocket);
+	bool				hasQueuedRequests() const;
+	std::vector<FastCgiRequest *>	takeTimedOut(size_t timeout);
+
+	const std::string	&getAddress() const;
+};
+
+
+#endif /* FASTCGIPOOL_HPP */
@@ -0,0 +1,250 @@
+#include "FastCgiRequest.hpp"
+#include "../config/ServerConfig.hpp"
+#include "../server/Clock.hpp"
+#include "../http/StatusCodes.hpp"
+
+#include <unistd.h>
+#include <strings.h>
+#include <cctype>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+
+FastCgiRequest::FastCgiRequest(int clientSocket, HttpRequest &request, const LocationConfig &location, const ServerConfig &serverConfig, int bodyFd)
+	: clientSocket(clientSocket), bodyFd(bodyFd), bodyOffset(0), isRetried(false), closeConnection(false), headerStatus(CGI_HEADERS_INCOMPLETE), isStreaming(false)
+{
+	const std::vector<std::string>	&queries = request.getQueries();
+	std::string						query;
+	std::string						params;
+	char							beginRequest[8] = { 0, FASTCGI_RESPONDER, FASTCGI_KEEP_CONN, 0, 0, 0, 0, 0 };
+
+	this->lastOutputTime = Clock::now();
+	for (size_t i = 0; i < queries.size(); i++)
+		query += (i > 0 ? "&" : "") + queries[i];
+
+	addParam(params, "GATEWAY_INTERFACE", "CGI/1.1");
+	addParam(params, "SERVER_SOFTWARE", SERVER_SOFTWARE);
+	addParam(params, "SERVER_PROTOCOL", request.getVersion());
+	addParam(params, "SERVER_NAME", request.getHost().substr(0, request.getHost().find(':')));
+	addParam(params, "SERVER_PORT", std::to_string(serverConfig.port));
+	addParam(params, "REMOTE_ADDR", request.getRemoteAddr());
+	addParam(params, "REQUEST_METHOD", request.getMethod());
+	addParam(params, "REQUEST_URI", query.empty() ? request.getUri() : request.getUri() + "?" + query);
+	addParam(params, "QUERY_STRING", query);
+	addParam(params, "DOCUMENT_ROOT", location.root);
+	addParam(params, "SCRIPT_NAME", request.getUri());
+	addParam(params, "SCRIPT_FILENAME", location.root + request.getUri());
+	addParam(params, "CONTENT_TYPE", request.getHeader("Content-Type"));
+	addParam(params, "CONTENT_LENGTH", request.getHeader("Content-Length"));
+	addHeaderParams(params, request);
+
+	appendRecord(records, FASTCGI_BEGIN_REQUEST, beginRequest, sizeof(beginRequest));
+	for (size_t offset = 0; offset < params.size(); offset += FASTCGI_MAX_CONTENT_LENGTH)
+		appendRecord(records, FASTCGI_PARAMS, params.data() + offset, std::min(params.size() - offset, static_cast<size_t>(FASTCGI_MAX_CONTENT_LENGTH)));
+	appendRecord(records, FASTCGI_PARAMS, NULL, 0);
+	// a request without a body ends its stream right away
+	if (bodyFd == -1)
+		appendRecord(records, FASTCGI_STDIN, NULL, 0);
+}
+
+FastCgiRequest::~FastCgiRequest()
+{
+	if (bodyFd != -1)
+		close(bodyFd);
+}
+
+// name-value pair, lengths below 128 take one byte, longer ones four
+void	FastCgiRequest::addParam(std::string &params, const std::string &name, const std::string &value)
+{
+	appendLength(params, name.size());
+	appendLength(params, value.size());
+	params += name;
+	params += value;
+}
+
+/*
+	Every request header becomes an HTTP_ variable, except the ones already
+	passed as CONTENT_TYPE and CONTENT_LENGTH, and Proxy, which applications
+	would mistake for the HTTP_PROXY environment variable.
+*/
+void	FastCgiRequest::addHeaderParams(std::string &params, HttpRequest &request)
+{
+	const std::map<std::string, std::string>	&headers = request.getHeaders();
+
+	for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); it++)
+	{
+		// "none" is the placeholder HttpRequest returns for missing headers
+		if (it->first == "content-type" || it->first == "content-length" || it->first == "proxy" || it->first == "none")
+			continue;
+		std::string name = "HTTP_" + it->first;
+		for (size_t i = 5; i < name.size(); i++)
+			name[i] = (name[i] == '-') ? '_' : std::toupper(static_cast<unsigned char>(name[i]));
+		addParam(params, name, it->second);
+	}
+}
+
+void	FastCgiRequest::appendLength(std::string &buffer, size_t length)
+{
+	if (length < 128)
+	{
+		buffer += static_cast<char>(length);
+		return;
+	}
+	buffer += static_cast<char>(((length >> 24) & 0x7f) | 0x80);
+	buffer += static_cast<char>((length >> 16) & 0xff);
+	buffer += static_cast<char>((length >> 8) & 0xff);
+	buffer += static_cast<char>(length & 0xff);
+}
+
+// record of at most FASTCGI_MAX_CONTENT_LENGTH bytes, padded to a multiple of 8 bytes
+void	FastCgiRequest::appendRecord(std::string &buffer, int type, const char *content, size_t length)
+{
+	size_t	padding = (8 - length % 8) % 8;
+	char	header[FASTCGI_HEADER_SIZE] = {
+		FASTCGI_VERSION, static_cast<char>(type),
+		0, FASTCGI_REQUEST_ID,
+		static_cast<char>((length >> 8) & 0xff), static_cast<char>(length & 0xff),
+		static_cast<char>(padding), 0
+	};
+
+	buffer.append(header, FASTCGI_HEADER_SIZE);
+	if (length > 0)
+		buffer.append(content, length);
+	buffer.append(padding, '\0');
+}
+
+int	FastCgiRequest::getClientSocket() const
+{
+	return (this->clientSocket);
+}
+
+const std::string	&FastCgiRequest::getRecords() const
+{
+	return (this->records);
+}
+
+int	FastCgiRequest::getBodyFd() const
+{
+	return (this->bodyFd);
+}
+
+ssize_t	FastCgiRequest::readBody(char *buffer, size_t size)
+{
+	ssize_t	bytesRead;
+
+	do
+		bytesRead = read(bodyFd, buffer, size);
+	while (bytesRead < 0 && errno == EINTR);
+	if (bytesRead > 0)
+		bodyOffset += bytesRead;
+	return (bytesRead);
+}
+
+// false when part of the body was read from a descriptor that cannot seek (a pipe)
+bool	FastCgiRequest::rewindBody()
+{
+	if (bodyFd == -1 || bodyOffset == 0)
+		return (true);
+	if (lseek(bodyFd, 0, SEEK_SET) < 0)
+		return (false);
+	bodyOffset = 0;
+	return (true);
+}
+
+// a new reader of the body, from its first byte
+void	FastCgiRequest::setBodyFd(int fd)
+{
+	if (bodyFd != -1)
+		close(bodyFd);
+	bodyFd = fd;
+	bodyOffset = 0;
+}
+
+void	FastCgiRequest::markRetried()
+{
+	this->isRetried = true;
+	this->lastOutputTime = Clock::now();
+}
+
+bool	FastCgiRequest::wasRetried() const
+{
+	return (this->isRetried);
+}
+
+void	FastCgiRequest::setCloseConnection(bool value)
+{
+	this->closeConnection = value;
+}
+
+bool	FastCgiRequest::closesConnection() const
+{
+	return (this->closeConnection);
+}
+
+// the rest of the output of a local redirect is not forwarded, it is dropped
+void	FastCgiRequest::appendOutput(const char *data, size_t length)
+{
+	if (this->headerStatus == CGI_HEADERS_COMPLETE && !this->isStreaming)
+		return;
+	this->output.append(data, length);
+}
+
+std::string	&FastCgiRequest::getOutput()
+{
+	return (this->output);
+}
+
+CgiHeaderStatus	FastCgiRequest::parseResponseHeaders(bool isComplete)
+{
+	this->headerStatus = this->responseHeaders.parse(this->output, isComplete);
+	return (this->headerStatus);
+}
+
+bool	FastCgiRequest::hasResponseHeaders() const
+{
+	return (this->headerStatus == CGI_HEADERS_COMPLETE);
+}
+
+const CgiResponseHeaders	&FastCgiRequest::getResponseHeaders() const
+{
+	return (this->responseHeaders);
+}
+
+/*
+	Head of the response, built once the header section of the output is
+	complete and valid. A body of unknown length is streamed in chunks.
+*/
+HttpResponse	FastCgiRequest::buildResponse() const
+{
+	HttpResponse	response;
+
+	response.setType(STREAM_RESPONSE);
+	this->responseHeaders.apply(response);
+	if (!this->responseHeaders.hasBodyLength())
+		response.setHeader("Transfer-Encoding", "chunked");
+	response.setHeader("Connection", "keep-alive");
+	return (response);
+}
+
+// the header section was forwarded, the output now only holds body data
+void	FastCgiRequest::startStreaming()
+{
+	this->isStreaming = true;
+	this->output.clear();
+}
+
+bool	FastCgiRequest::isStreamingOutput() const
+{
+	return (this->isStreaming);
+}
+
+// the timeout counts from the last output forwarded, a long download is not cut off
+void	FastCgiRequest::updateOutputTime()
+{
+	this->lastOutputTime = Clock::now();
+}
+
+bool	FastCgiRequest::isTimedOut(size_t timeout) const
+{
+	return (std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - lastOutputTime) > std::chrono::seconds(timeout));
+}
@@ -0,0 +1,99 @@
+
+
+
+#pragma once
+#ifndef FASTCGIREQUEST_HPP
+#define FASTCGIREQUEST_HPP
+
+#include "../http/HttpRequest.hpp"
+#include "../http/HttpResponse.hpp"
+#include "../config/LocationConfig.hpp"
+#include "CgiResponseHeaders.hpp"
+
+#include <chrono>
+
+#define FASTCGI_VERSION 1
+#define FASTCGI_HEADER_SIZE 8
+#define FASTCGI_MAX_CONTENT_LENGTH 65535
+
+// one request at a time on a connection, so every request has the same id
+#define FASTCGI_REQUEST_ID 1
+
+#define FASTCGI_RESPONDER 1
+#define FASTCGI_KEEP_CONN 1
+#define FASTCGI_REQUEST_COMPLETE 0
+
+enum FastCgiRecordType
+{
+	FASTCGI_BEGIN_REQUEST = 1,
+	FASTCGI_ABORT_REQUEST,
+	FASTCGI_END_REQUEST,
+	FASTCGI_PARAMS,
+	FASTCGI_STDIN,
+	FASTCGI_STDOUT,
+	FASTCGI_STDERR
+};
+
+/*
+	A request passed to a FastCGI server. The BEGIN_REQUEST and PARAMS
+	records are encoded when it is created, so it can wait in the queue of a
+	saturated pool without holding on to the client's HttpRequest. The body,
+	if any, is read from a descriptor and sent in STDIN records once the
+	request has a connection. It can be sent again from its first record as
+	long as its body can be read again.
+
+	STDOUT is collected until its header section is complete, then the
+	Server takes what arrived after each read and streams it to the client.
+*/
+class FastCgiRequest
+{
+private:
+	int													clientSocket;
+	std::string											records;
+	int													bodyFd;
+	size_t												bodyOffset; // body bytes read from bodyFd
+	bool												isRetried;
+	bool												closeConnection; // the client is closed after the response
+	std::string											output; // STDOUT not forwarded yet
+	CgiResponseHeaders									responseHeaders;
+	CgiHeaderStatus										headerStatus;
+	bool												isStreaming;
+	std::chrono::time_point<std::chrono::steady_clock>	lastOutputTime;
+
+	void	addParam(std::string &params, const std::string &name, const std::string &value);
+	void	addHeaderParams(std::string &params, HttpRequest &request);
+
+	FastCgiRequest(const FastCgiRequest &other);
+	FastCgiRequest	&operator=(const FastCgiRequest &other);
+
+public:
+	FastCgiRequest(int clientSocket, HttpRequest &request, const LocationConfig &location, const ServerConfig &serverConfig, int bodyFd = -1);
+	~FastCgiRequest();
+
+	int					getClientSocket() const;
+	const std::string	&getRecords() const;
+	int					getBodyFd() const;
+	ssize_t				readBody(char *buffer, size_t size);
+	bool				rewindBody();
+	void				setBodyFd(int fd);
+	void				markRetried();
+	bool				wasRetried() const;
+	void				setCloseConnection(bool value);
+	bool				closesConnection() const;
+	void				appendOutput(const char *data, size_t length);
+	std::string			&getOutput();
+	CgiHeaderStatus		parseResponseHeaders(bool isComplete);
+	bool				hasResponseHeaders() const;
+	const CgiResponseHeaders	&getResponseHeaders() const;
+	HttpResponse		buildResponse() const;
+	void				startStreaming();
+	bool				isStreamingOutput() const;
+	void				updateOutputTime();
+	bool				isTimedOut(size_t timeout) const;
+
+	static void			appendRecord(std::string &buffer, int type, const char *content, size_t length);
+	static void			appendLength(std::string &buffer, size_t length);
+};
+
+
+#endif /* FASTCGIREQUEST_HPP */
@@ -1,4 +1,5 @@
 #include "BaseConfig.hpp"
+#include "../http/HttpResponse.hpp"
 
 
 void	BaseConfig::setRoot(const std::string &rootValue)
@@ -33,6 +34,13 @@ void	BaseConfig::setAutoindex(const std::string &autoindexValue)
 	this->autoindex = autoindexValue;
 }
 
+void	BaseConfig::setCreateFullPutPath(const std::string &createFullPutPathValue)
+{
+	if (createFullPutPathValue != "on" && createFullPutPathValue != "off")
+		throw (std::runtime_error("invalid value \"" + createFullPutPathValue + "\" in \"create_full_put_path\" directive, it must be \"on\" or \"off\""));
+	this->createFullPutPath = createFullPutPathValue;
+}
+
 void	BaseConfig::setErrorPage(const std::string &statusCode, const std::string &uri, const std::string &currentContext)
 {
 	if (statusCode.empty() || statusCode.size() > 3)
@@ -45,21 +53,29 @@ void	BaseConfig::setErrorPage(const std::string &statusCode, const std::string &
 	int codeInt = std::stoi(statusCode);
 	if (codeInt < 300 || codeInt > 599)
 		throw std::runtime_error("invalid code in \"error_page\" directive: \"" + statusCode + "\"" + " (must be between 300 and 599)");
-	if (errorPages.find(codeInt) == errorPages.end())
-	{
-		errorPages[codeInt] = uri;
-		errorPagesContext[codeInt] = currentContext;
-	}
-	else
+	// copied on the first write, the enclosing context keeps its own pages
+	if (!errorPages)
+		errorPages = std::make_shared<ErrorPages>();
+	else if (errorPages.use_count() > 1)
+		errorPages = std::make_shared<ErrorPages>(*errorPages);
+	std::map<int, std::string>::iterator it = errorPages->contexts.find(codeInt);
+	if (it == errorPages->contexts.end() || it->second != currentContext)
 	{
-		if (errorPagesContext[codeInt] != currentContext)
-		{
-			errorPages[codeInt] = uri;
-			errorPagesContext[codeInt] = currentContext;
-		}
+		errorPages->pages[codeInt] = VariableTemplate(uri, "error_page");
+		errorPages->contexts[codeInt] = currentContext;
 	}
 }
 
+const VariableTemplate	*BaseConfig::findErrorPage(int statusCode) const
+{
+	if (!errorPages)
+		return (NULL);
+	std::map<int, VariableTemplate>::const_iterator it = errorPages->pages.find(statusCode);
+	if (it == errorPages->pages.end())
+		return (NULL);
+	return (&it->second);
+}
+
 void	BaseConfig::setErrorPage(const std::vector<std::string> &errorPageValues, const std::string &currentContext)
 {
 	const std::string &fileOrUri = errorPageValues.back();
@@ -79,7 +95,7 @@ void	BaseConfig::splitValueAndUnit(const std::string &bodySize, std::string &val
 		value = bodySize;
 }
 
-size_t	BaseConfig::safeStringToSizeT(const std::string &bodySize, const std::string value)
+size_t	BaseConfig::safeStringToSizeT(const std::string &sizeValue, const std::string value, const std::string &directive)
 {
 	try
 	{
@@ -88,23 +104,22 @@ size_t	BaseConfig::safeStringToSizeT(const std::string &bodySize, const std::str
 	}
 	catch (const std::exception &e)
 	{
-		throw (std::runtime_error("invalid value \"" + bodySize + "\" in \"client_max_body_size\" directive"));
+		throw (std::runtime_error("invalid value \"" + sizeValue + "\" in \"" + directive + "\" directive"));
 	}
 }
 
-
-void	BaseConfig::setClientMaxBodySize(const std::string &bodySize)
+size_t	BaseConfig::parseSize(const std::string &sizeValue, const std::string &directive)
 {
 	size_t multiplier = 1; // in case there is no unit (bytes by default)
 	size_t numericValue, totalSize;
 	std::string value, unit;
 
-	splitValueAndUnit(bodySize, value, unit);
+	splitValueAndUnit(sizeValue, value, unit);
 
 	if (value.empty() || unit.size() > 1)
-		throw (std::runtime_error("invalid value \"" + bodySize + "\" in \"client_max_body_size\" directive"));
+		throw (std::runtime_error("invalid value \"" + sizeValue + "\" in \"" + directive + "\" directive"));
 	if (unit.size() == 1 && unit.find_first_not_of("kKmMgG") != std::string::npos)
-		throw (std::runtime_error("invalid value \"" + bodySize + "\" in \"client_max_body_size\" directive"));
+		throw (std::runtime_error("invalid value \"" + sizeValue + "\" in \"" + directive + "\" directive"));
 	if (unit == "k" || unit == "K")
 		multiplier = 1024;
 	else if (unit == "m" || unit == "M")
@@ -112,12 +127,25 @@ void	BaseConfig::setClientMaxBodySize(const std::string &bodySize)
 	else if (unit == "g" || unit == "G")
 		multiplier = 1073741824;
 	
-	numericValue = safeStringToSizeT(bodySize, value);
+	numericValue = safeStringToSizeT(sizeValue, value, directive);
 	totalSize = numericValue * multiplier;
 	// check for overflow
 	if (totalSize / multiplier != numericValue)
-		throw (std::runtime_error("invalid value \"" + bodySize + "\" in \"client_max_body_size\" directive"));
-	this->clientMaxBodySize = totalSize;
+		throw (std::runtime_error("invalid value \"" + sizeValue + "\" in \"" + directive + "\" directive"));
+	return (totalSize);
+}
+
+void	BaseConfig::setClientMaxBodySize(const std::string &bodySize)
+{
+	this->clientMaxBodySize = parseSize(bodySize, "client_max_body_size");
+}
+
+void	BaseConfig::setClientBodyBufferSize(const std::string &bufferSize)
+{
+	size_t size = parseSize(bufferSize, "client_body_buffer_size");
+	if (size > MAX_CLIENT_BODY_BUFFER_SIZE)
+		throw (std::runtime_error("invalid value \"" + bufferSize + "\" in \"client_body_buffer_size\" directive, it must not exceed 64k"));
+	this->clientBodyBufferSize = size;
 }
 
 void	BaseConfig::processFallbackStatusCode(const std::string &statusCode)
@@ -164,3 +192,13 @@ void	BaseConfig::setReturn(const std::vector<std::string> &returnValues)
 		throw std::runtime_error("invalid code in \"return\" directive: \"" + code + "\"" + " (must be between 100 and 599)");
 	this->returnDirective.setStatusCode(codeInt);
 }
+
+void	BaseConfig::addRewrite(const std::vector<std::string> &rewriteValues)
+{
+	this->rewrites.push_back(RewriteDirective(rewriteValues));
+}
+
+void	BaseConfig::formatConstantHeaders()
+{
+	this->constantHeaders = DEFAULT_CONSTANT_HEADERS;
+}
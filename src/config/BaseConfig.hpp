@@ -9,9 +9,22 @@
 #include "../parsing/DirectiveNode.hpp"
 #include "TryFilesDirective.hpp"
 #include "ReturnDirective.hpp"
+#include "RewriteDirective.hpp"
+#include "RequestPipeline.hpp"
 
 #include <sstream>
+#include <memory>
 
+// bodies kept in memory are handed to CGI through a pipe, which holds at least 64 KB without blocking
+#define MAX_CLIENT_BODY_BUFFER_SIZE 65536 // 64 KB
+
+
+// error pages and the context each one was set in, a nested context overrides them
+struct ErrorPages
+{
+	std::map<int, VariableTemplate>		pages;
+	std::map<int, std::string>			contexts;
+};
 
 class BaseConfig
 {
@@ -21,17 +34,22 @@ private:
 	bool					isValidAutoindex(const std::string &autoindexValue);
 	void					processFallbackStatusCode(const std::string &statusCode);
 	void					splitValueAndUnit(const std::string &bodySize, std::string &value, std::string &unit);
-	size_t					safeStringToSizeT(const std::string &bodySize, const std::string value);
+	size_t					safeStringToSizeT(const std::string &sizeValue, const std::string value, const std::string &directive);
+	size_t					parseSize(const std::string &sizeValue, const std::string &directive);
 
 public:
 	std::string								root;
 	std::vector<std::string>				index;
 	std::string								autoindex;
-	std::map<int, std::string>				errorPages;
-	std::map<int, std::string>				errorPagesContext;
+	std::shared_ptr<ErrorPages>				errorPages; // shared with the enclosing context until a page is set here
 	size_t									clientMaxBodySize;
+	size_t									clientBodyBufferSize;
+	std::string								createFullPutPath;
 	TryFilesDirective						tryFiles;
 	ReturnDirective							returnDirective;
+	std::vector<RewriteDirective>			rewrites; // in configuration order, not inherited
+	std::string								constantHeaders; // header lines sent with every response, formatted once
+	RequestPipeline							pipeline; // compiled by the Server once the configuration is final
 
 	void					setRoot(const std::string &rootValue);
 	void					setIndex(const std::vector<std::string> &indexValues);
@@ -39,8 +57,15 @@ public:
 	void					setErrorPage(const std::string &statusCode, const std::string &uri, const std::string &context);
 	void					setErrorPage(const std::vector<std::string> &errorPageValues, const std::string &context);
 	void					setClientMaxBodySize(const std::string &bodySize);
+	void					setClientBodyBufferSize(const std::string &bufferSize);
+	void					setCreateFullPutPath(const std::string &createFullPutPathValue);
 	void					setTryFiles(const std::vector<std::string> &tryFilesValues);
 	void					setReturn(const std::vector<std::string> &returnValues);
+	void					addRewrite(const std::vector<std::string> &rewriteValues);
+
+	const VariableTemplate	*findErrorPage(int statusCode) const;
+
+	void					formatConstantHeaders();
 
 };
 
@@ -12,8 +12,13 @@ LocationConfig::LocationConfig(const std::string &path, const ServerConfig &serv
 	this->index = serverConfig.index;
 	this->autoindex = serverConfig.autoindex;
 	this->errorPages = serverConfig.errorPages;
-	this->errorPagesContext = serverConfig.errorPagesContext;
 	this->clientMaxBodySize = serverConfig.clientMaxBodySize;
+	this->clientBodyBufferSize = serverConfig.clientBodyBufferSize;
+	this->createFullPutPath = serverConfig.createFullPutPath;
+	if (path.compare(0, 3, "~* ") == 0)
+		this->regex.compile(path.substr(3), true, "location");
+	else if (path.compare(0, 2, "~ ") == 0)
+		this->regex.compile(path.substr(2), false, "location");
 }
 
 void	LocationConfig::setAllowedMethods(const std::vector<std::string> &limitExceptValues)
@@ -39,19 +44,68 @@ void	LocationConfig::setAllowedMethods(const std::vector<std::string> &limitExce
 	}
 }
 
+void	LocationConfig::setUploadStore(const std::string &directory)
+{
+	this->uploadStore = directory;
+	// uploaded file names are appended to it
+	while (this->uploadStore.size() > 1 && this->uploadStore[this->uploadStore.size() - 1] == '/')
+		this->uploadStore.erase(this->uploadStore.size() - 1);
+}
+
+void	LocationConfig::setFastCgiPass(const std::string &address)
+{
+	this->fastcgiPass.setAddress(address);
+}
+
 const std::string	&LocationConfig::getPath() const
 {
 	return (this->path);
 }
 
 
+/*
+	Without limit_except every method is allowed, except PUT: it writes into
+	the document root, so it has to be listed explicitly.
+*/
 bool	LocationConfig::isMethodAllowed(const std::string &method) const
 {
 	std::string	currentMethod;
 
 	currentMethod.resize(method.size());
 	std::transform(method.begin(), method.end(), currentMethod.begin(), ::tolower);
+	if (currentMethod == "put")
+		return (this->allowedMethods.find(currentMethod) != this->allowedMethods.end());
 	if (this->allowedMethods.empty() || this->allowedMethods.find(currentMethod) != this->allowedMethods.end())
 		return (true);
 	return (false);
 }
+
+const std::string	&LocationConfig::getUploadStore() const
+{
+	return (this->uploadStore);
+}
+
+bool	LocationConfig::hasUploadStore() const
+{
+	return (!this->uploadStore.empty());
+}
+
+const FastCgiDirective	&LocationConfig::getFastCgiPass() const
+{
+	return (this->fastcgiPass);
+}
+
+bool	LocationConfig::hasFastCgiPass() const
+{
+	return (this->fastcgiPass.isEnabled());
+}
+
+bool	LocationConfig::isRegex() const
+{
+	return (this->regex.isCompiled());
+}
+
+const RegexPattern	&LocationConfig::getRegex() const
+{
+	return (this->regex);
+}
@@ -6,6 +6,8 @@
 
 #include "BaseConfig.hpp"
 #include "ServerConfig.hpp"
+#include "RegexPattern.hpp"
+#include "../cgi/FastCgiDirective.hpp"
 #include <set>
 
 
@@ -14,16 +16,27 @@ class LocationConfig : public BaseConfig
 private:
 	std::string				path;
 	std::set<std::string>	allowedMethods;
+	std::string				uploadStore;
+	RegexPattern			regex; // "~" and "~*" locations
+	FastCgiDirective		fastcgiPass;
 
 public:
 	LocationConfig();
 	LocationConfig(const std::string &path, const ServerConfig &serverConfig);
 
 	void				setAllowedMethods(const std::vector<std::string> &limitExceptValues);
+	void				setUploadStore(const std::string &directory);
+	void				setFastCgiPass(const std::string &address);
 
 
 	const std::string			&getPath() const;
 	bool						isMethodAllowed(const std::string &method) const;
+	const std::string			&getUploadStore() const;
+	bool						hasUploadStore() const;
+	const FastCgiDirective		&getFastCgiPass() const;
+	bool						hasFastCgiPass() const;
+	bool						isRegex() const;
+	const RegexPattern			&getRegex() const;
 
 
 };
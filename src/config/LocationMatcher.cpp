@@ -0,0 +1,194 @@
+#include "LocationMatcher.hpp"
+#include "LocationConfig.hpp"
+
+LocationMatcher::LocationMatcher()
+{
+	clear();
+}
+
+LocationMatcher::LocationMatcher(const LocationMatcher &other)
+{
+	(void)other;
+	clear();
+}
+
+LocationMatcher	&LocationMatcher::operator=(const LocationMatcher &other)
+{
+	(void)other;
+	clear();
+	return (*this);
+}
+
+LocationMatcher::~LocationMatcher() { }
+
+void	LocationMatcher::clear()
+{
+	nodes.clear();
+	exactLocations.clear();
+	regexLocations.clear();
+	recentUris.clear();
+	recentIndex.clear();
+	addNode("", NULL);
+	isCompiled = false;
+}
+
+bool	LocationMatcher::compiled() const
+{
+	return (this->isCompiled);
+}
+
+size_t	LocationMatcher::addNode(const std::string &label, LocationConfig *location)
+{
+	Node	node;
+
+	node.label = label;
+	node.location = location;
+	nodes.push_back(node);
+	return (nodes.size() - 1);
+}
+
+// children of a node start with distinct characters, 0 (the root) means none
+size_t	LocationMatcher::findChild(size_t node, char firstChar) const
+{
+	const std::vector<size_t>	&children = nodes[node].children;
+
+	for (size_t i = 0; i < children.size(); i++)
+	{
+		if (nodes[children[i]].label[0] == firstChar)
+			return (children[i]);
+	}
+	return (0);
+}
+
+void	LocationMatcher::insert(const std::string &path, LocationConfig *location)
+{
+	size_t	node = 0;
+	size_t	pos = 0;
+
+	while (pos < path.size())
+	{
+		size_t child = findChild(node, path[pos]);
+		if (child == 0)
+		{
+			size_t leaf = addNode(path.substr(pos), location);
+			nodes[node].children.push_back(leaf);
+			return;
+		}
+
+		const std::string	&label = nodes[child].label;
+		size_t				common = 0;
+		while (common < label.size() && pos + common < path.size() && label[common] == path[pos + common])
+			common++;
+		if (common < label.size())
+		{
+			// the edge is split, the new node takes over the common part of the label
+			size_t middle = addNode(nodes[child].label.substr(0, common), NULL);
+			nodes[child].label.erase(0, common);
+			nodes[middle].children.push_back(child);
+			std::vector<size_t> &siblings = nodes[node].children;
+			for (size_t i = 0; i < siblings.size(); i++)
+			{
+				if (siblings[i] == child)
+					siblings[i] = middle;
+			}
+			child = middle;
+		}
+		node = child;
+		pos += common;
+	}
+	nodes[node].location = location;
+}
+
+void	LocationMatcher::compile(std::map<std::string, LocationConfig> &locations, const std::vector<std::string> &regexPaths)
+{
+	clear();
+	std::map<std::string, LocationConfig>::iterator it = locations.begin();
+	for (; it != locations.end(); it++)
+	{
+		if (it->second.isRegex())
+			continue;
+		if (it->first[0] == '=') // exact matching
+			exactLocations[it->first.substr(1)] = &(it->second);
+		else
+			insert(it->first, &(it->second));
+	}
+	for (size_t i = 0; i < regexPaths.size(); i++)
+	{
+		it = locations.find(regexPaths[i]);
+		if (it != locations.end())
+			regexLocations.push_back(&(it->second));
+	}
+	isCompiled = true;
+}
+
+void	LocationMatcher::remember(const std::string &uri, LocationConfig *location)
+{
+	if (recentUris.size() < LOCATION_CACHE_SIZE)
+		recentUris.push_front(std::make_pair(uri, location));
+	else
+	{
+		// the least recently used entry is reused for the new URI
+		recentIndex.erase(recentUris.back().first);
+		recentUris.splice(recentUris.begin(), recentUris, --recentUris.end());
+		recentUris.front().first = uri;
+		recentUris.front().second = location;
+	}
+	recentIndex[uri] = recentUris.begin();
+}
+
+/*
+	Returns the exact location of the URI, or else the first regex location
+	matching it, or else the location with the longest path the URI starts
+	with, or NULL.
+*/
+LocationConfig	*LocationMatcher::match(const std::string &uri)
+{
+	if (!exactLocations.empty())
+	{
+		std::unordered_map<std::string, LocationConfig *>::const_iterator exact = exactLocations.find(uri);
+		if (exact != exactLocations.end())
+			return (exact->second);
+	}
+	if (regexLocations.empty())
+		return (matchPrefix(uri));
+
+	std::unordered_map<std::string, RecentList::iterator>::iterator recent = recentIndex.find(uri);
+	if (recent != recentIndex.end())
+	{
+		recentUris.splice(recentUris.begin(), recentUris, recent->second);
+		return (recent->second->second);
+	}
+
+	LocationConfig	*location = NULL;
+	for (size_t i = 0; i < regexLocations.size() && location == NULL; i++)
+	{
+		if (regexLocations[i]->getRegex().match(uri))
+			location = regexLocations[i];
+	}
+	if (location == NULL)
+		location = matchPrefix(uri);
+	remember(uri, location);
+	return (location);
+}
+
+LocationConfig	*LocationMatcher::matchPrefix(const std::string &uri) const
+{
+	LocationConfig	*location = NULL;
+	size_t			node = 0;
+	size_t			pos = 0;
+
+	while (pos < uri.size())
+	{
+		size_t child = findChild(node, uri[pos]);
+		if (child == 0)
+			break;
+		const std::string &label = nodes[child].label;
+		if (uri.compare(pos, label.size(), label) != 0)
+			break;
+		pos += label.size();
+		node = child;
+		if (nodes[node].location)
+			location = nodes[node].location;
+	}
+	return (location);
+}
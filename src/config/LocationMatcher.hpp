@@ -0,0 +1,70 @@
+
+
+
+#pragma once
+#ifndef LOCATIONMATCHER_HPP
+#define LOCATIONMATCHER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <list>
+
+// URIs whose routing decision is remembered when there are regex locations
+#define LOCATION_CACHE_SIZE 256
+
+class LocationConfig;
+
+/*
+	Location lookup compiled from the locations of a server. Exact ("=")
+	locations are kept in a hash table, prefix locations in a radix trie, so
+	the longest matching prefix is found in a single walk over the URI,
+	without copying it. Regex ("~", "~*") locations are then tried in
+	configuration order, the first one matching wins over the prefix. Their
+	decisions are kept in a small LRU cache, most URIs of a site are asked for
+	again and again.
+
+	The matcher points into the location map it was compiled from, copying it
+	gives an empty matcher that has to be compiled again.
+*/
+class LocationMatcher
+{
+private:
+	struct Node
+	{
+		std::string			label;
+		LocationConfig		*location;
+		std::vector<size_t>	children;
+	};
+
+	std::vector<Node>									nodes; // nodes[0] is the root
+	std::unordered_map<std::string, LocationConfig *>	exactLocations;
+	std::vector<LocationConfig *>						regexLocations;
+	bool												isCompiled;
+
+	typedef std::list<std::pair<std::string, LocationConfig *> >	RecentList;
+	RecentList											recentUris; // most recent first
+	std::unordered_map<std::string, RecentList::iterator>	recentIndex;
+
+	size_t			findChild(size_t node, char firstChar) const;
+	size_t			addNode(const std::string &label, LocationConfig *location);
+	void			insert(const std::string &path, LocationConfig *location);
+	LocationConfig	*matchPrefix(const std::string &uri) const;
+	void			remember(const std::string &uri, LocationConfig *location);
+
+public:
+	LocationMatcher();
+	LocationMatcher(const LocationMatcher &other);
+	LocationMatcher	&operator=(const LocationMatcher &other);
+	~LocationMatcher();
+
+	void			compile(std::map<std::string, LocationConfig> &locations, const std::vector<std::string> &regexPaths);
+	void			clear();
+	bool			compiled() const;
+
+	LocationConfig	*match(const std::string &uri);
+};
+
+
+#endif /* LOCATIONMATCHER_HPP */
@@ -1,27 +1,227 @@
 #include "MimeTypeConfig.hpp"
 
-MimeTypeConfig::MimeTypeConfig() { }
+#include <cctype>
+
+static constexpr MimeTypeEntry	defaultMimeTypes[] = {
+	{"html",     "text/html"},
+	{"htm",      "text/html"},
+	{"shtml",    "text/html"},
+	{"css",      "text/css"},
+	{"xml",      "text/xml"},
+	{"gif",      "image/gif"},
+	{"jpeg",     "image/jpeg"},
+	{"jpg",      "image/jpeg"},
+	{"js",       "application/javascript"},
+	{"atom",     "application/atom+xml"},
+	{"rss",      "application/rss+xml"},
+	{"mml",      "text/mathml"},
+	{"txt",      "text/plain"},
+	{"jad",      "text/vnd.sun.j2me.app-descriptor"},
+	{"wml",      "text/vnd.wap.wml"},
+	{"htc",      "text/x-component"},
+	{"avif",     "image/avif"},
+	{"png",      "image/png"},
+	{"svg",      "image/svg+xml"},
+	{"svgz",     "image/svg+xml"},
+	{"tif",      "image/tiff"},
+	{"tiff",     "image/tiff"},
+	{"wbmp",     "image/vnd.wap.wbmp"},
+	{"webp",     "image/webp"},
+	{"ico",      "image/x-icon"},
+	{"jng",      "image/x-jng"},
+	{"bmp",      "image/x-ms-bmp"},
+	{"woff",     "font/woff"},
+	{"woff2",    "font/woff2"},
+	{"jar",      "application/java-archive"},
+	{"war",      "application/java-archive"},
+	{"ear",      "application/java-archive"},
+	{"json",     "application/json"},
+	{"hqx",      "application/mac-binhex40"},
+	{"doc",      "application/msword"},
+	{"pdf",      "application/pdf"},
+	{"ps",       "application/postscript"},
+	{"eps",      "application/postscript"},
+	{"ai",       "application/postscript"},
+	{"rtf",      "application/rtf"},
+	{"m3u8",     "application/vnd.apple.mpegurl"},
+	{"kml",      "application/vnd.google-earth.kml+xml"},
+	{"kmz",      "application/vnd.google-earth.kmz"},
+	{"xls",      "application/vnd.ms-excel"},
+	{"eot",      "application/vnd.ms-fontobject"},
+	{"ppt",      "application/vnd.ms-powerpoint"},
+	{"odg",      "application/vnd.oasis.opendocument.graphics"},
+	{"odp",      "application/vnd.oasis.opendocument.presentation"},
+	{"ods",      "application/vnd.oasis.opendocument.spreadsheet"},
+	{"odt",      "application/vnd.oasis.opendocument.text"},
+	{"pptx",     "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+	{"xlsx",     "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+	{"docx",     "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+	{"wmlc",     "application/vnd.wap.wmlc"},
+	{"wasm",     "application/wasm"},
+	{"7z",       "application/x-7z-compressed"},
+	{"cco",      "application/x-cocoa"},
+	{"jardiff",  "application/x-java-archive-diff"},
+	{"jnlp",     "application/x-java-jnlp-file"},
+	{"run",      "application/x-makeself"},
+	{"pl",       "application/x-perl"},
+	{"pm",       "application/x-perl"},
+	{"prc",      "application/x-pilot"},
+	{"pdb",      "application/x-pilot"},
+	{"rar",      "application/x-rar-compressed"},
+	{"rpm",      "application/x-redhat-package-manager"},
+	{"sea",      "application/x-sea"},
+	{"swf",      "application/x-shockwave-flash"},
+	{"sit",      "application/x-stuffit"},
+	{"tcl",      "application/x-tcl"},
+	{"tk",       "application/x-tcl"},
+	{"der",      "application/x-x509-ca-cert"},
+	{"pem",      "application/x-x509-ca-cert"},
+	{"crt",      "application/x-x509-ca-cert"},
+	{"xpi",      "application/x-xpinstall"},
+	{"xhtml",    "application/xhtml+xml"},
+	{"xspf",     "application/xspf+xml"},
+	{"zip",      "application/zip"},
+	{"bin",      "application/octet-stream"},
+	{"exe",      "application/octet-stream"},
+	{"dll",      "application/octet-stream"},
+	{"deb",      "application/octet-stream"},
+	{"dmg",      "application/octet-stream"},
+	{"iso",      "application/octet-stream"},
+	{"img",      "application/octet-stream"},
+	{"msi",      "application/octet-stream"},
+	{"msp",      "application/octet-stream"},
+	{"msm",      "application/octet-stream"},
+	{"mid",      "audio/midi"},
+	{"midi",     "audio/midi"},
+	{"kar",      "audio/midi"},
+	{"mp3",      "audio/mpeg"},
+	{"ogg",      "audio/ogg"},
+	{"m4a",      "audio/x-m4a"},
+	{"ra",       "audio/x-realaudio"},
+	{"3gpp",     "video/3gpp"},
+	{"3gp",      "video/3gpp"},
+	{"ts",       "video/mp2t"},
+	{"mp4",      "video/mp4"},
+	{"mpeg",     "video/mpeg"},
+	{"mpg",      "video/mpeg"},
+	{"mov",      "video/quicktime"},
+	{"webm",     "video/webm"},
+	{"flv",      "video/x-flv"},
+	{"m4v",      "video/x-m4v"},
+	{"mng",      "video/x-mng"},
+	{"asx",      "video/x-ms-asf"},
+	{"asf",      "video/x-ms-asf"},
+	{"wmv",      "video/x-ms-wmv"},
+	{"avi",      "video/x-msvideo"},
+};
+
+#define INITIAL_MIME_TYPE_SLOTS 256
+
+MimeTypeConfig::MimeTypeConfig() : slots(INITIAL_MIME_TYPE_SLOTS), count(0) { }
 
 MimeTypeConfig::~MimeTypeConfig() { }
 
+// FNV-1a over the lowercased characters
+size_t	MimeTypeConfig::hashExtension(std::string_view extension)
+{
+	size_t	hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < extension.size(); i++)
+	{
+		hash ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(extension[i])));
+		hash *= 1099511628211ULL;
+	}
+	return (hash);
+}
+
+bool	MimeTypeConfig::equalsIgnoreCase(std::string_view extension, const std::string &lowercase)
+{
+	if (extension.size() != lowercase.size())
+		return (false);
+	for (size_t i = 0; i < extension.size(); i++)
+	{
+		if (std::tolower(static_cast<unsigned char>(extension[i])) != lowercase[i])
+			return (false);
+	}
+	return (true);
+}
+
+void	MimeTypeConfig::grow()
+{
+	std::vector<Slot>	oldSlots(slots.size() * 2);
+
+	oldSlots.swap(slots);
+	count = 0;
+	for (size_t i = 0; i < oldSlots.size(); i++)
+	{
+		if (!oldSlots[i].extension.empty())
+			addMimeType(oldSlots[i].extension, oldSlots[i].mimeType);
+	}
+}
 
+// a later definition of an extension replaces the previous one
 void	MimeTypeConfig::addMimeType(const std::string &extension, const std::string &mimeType)
 {
-	mimeTypeMap[extension] = mimeType;
+	if (extension.empty())
+		return;
+	if ((count + 1) * 2 > slots.size())
+		grow();
+
+	size_t mask = slots.size() - 1;
+	size_t i = hashExtension(extension) & mask;
+	while (!slots[i].extension.empty() && !equalsIgnoreCase(extension, slots[i].extension))
+		i = (i + 1) & mask;
+	if (slots[i].extension.empty())
+	{
+		slots[i].extension = extension;
+		for (size_t j = 0; j < slots[i].extension.size(); j++)
+			slots[i].extension[j] = std::tolower(static_cast<unsigned char>(slots[i].extension[j]));
+		count++;
+	}
+	slots[i].mimeType = mimeType;
+}
+
+void	MimeTypeConfig::addDefaultMimeTypes()
+{
+	for (size_t i = 0; i < sizeof(defaultMimeTypes) / sizeof(defaultMimeTypes[0]); i++)
+		addMimeType(defaultMimeTypes[i].extension, defaultMimeTypes[i].mimeType);
 }
 
-std::string	MimeTypeConfig::getMimeType(const std::string &filePath)
+std::string_view	MimeTypeConfig::getMimeType(std::string_view filePath) const
 {
-	std::string	extension;
-	size_t		pos = filePath.find_last_of('.');
-	if (pos != std::string::npos)
-		extension = filePath.substr(pos + 1);
-	else
-		return ("application/octet-stream");
-	// convert extension to lowercase
-	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
-	std::map<std::string, std::string>::iterator it = mimeTypeMap.find(extension);
-	if (it != mimeTypeMap.end())
-		return (it->second);
-	return ("text/plain");
+	size_t	pos = filePath.find_last_of("./");
+
+	if (pos == std::string_view::npos || filePath[pos] == '/')
+		return (NO_EXTENSION_MIME_TYPE);
+	std::string_view extension = filePath.substr(pos + 1);
+
+	size_t mask = slots.size() - 1;
+	size_t i = hashExtension(extension) & mask;
+	while (!slots[i].extension.empty())
+	{
+		if (equalsIgnoreCase(extension, slots[i].extension))
+			return (slots[i].mimeType);
+		i = (i + 1) & mask;
+	}
+	return (DEFAULT_MIME_TYPE);
+}
+
+size_t	MimeTypeConfig::size() const
+{
+	return (this->count);
+}
+
+std::vector<MimeTypeEntry>	MimeTypeConfig::getEntries() const
+{
+	std::vector<MimeTypeEntry>	entries;
+
+	entries.reserve(this->count);
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].extension.empty())
+			continue;
+		MimeTypeEntry entry = { slots[i].extension.c_str(), slots[i].mimeType.c_str() };
+		entries.push_back(entry);
+	}
+	return (entries);
 }
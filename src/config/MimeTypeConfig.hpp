@@ -5,25 +5,58 @@
 #ifndef MIMETYPECONFIG_HPP
 #define MIMETYPECONFIG_HPP
 
-#include <map>
-#include <iostream>
-#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
 
+// read when the configuration has no "types" directive, optional
+#define DEFAULT_MIME_TYPES_FILE "conf/mime.types"
+
+#define DEFAULT_MIME_TYPE "text/plain"
+#define NO_EXTENSION_MIME_TYPE "application/octet-stream"
+
+struct MimeTypeEntry
+{
+	const char	*extension;
+	const char	*mimeType;
+};
+
+/*
+	Extension to MIME type table, an open addressing hash table with linear
+	probing filled when the configuration is loaded. It starts with a
+	built-in table so a missing types file still gives the common types.
+	Extensions are stored in lowercase and looked up case-insensitively
+	without copying them.
+*/
 class MimeTypeConfig
 {
 private:
-	std::map<std::string, std::string>	mimeTypeMap;
+	struct Slot
+	{
+		std::string	extension;
+		std::string	mimeType;
+	};
+
+	std::vector<Slot>	slots; // size is a power of two, at most half full
+	size_t				count;
+
+	static size_t	hashExtension(std::string_view extension);
+	static bool		equalsIgnoreCase(std::string_view extension, const std::string &lowercase);
+	void			grow();
 
 public:
 	MimeTypeConfig();
 	~MimeTypeConfig();
 
-	void	addMimeType(const std::string &extension, const std::string &mimeType);
+	void				addMimeType(const std::string &extension, const std::string &mimeType);
+	void				addDefaultMimeTypes();
 
-	std::string	getMimeType(const std::string &filePath);
+	std::string_view	getMimeType(std::string_view filePath) const;
+	size_t				size() const;
 
+	// the entries point into the table and are valid until it is modified
+	std::vector<MimeTypeEntry>	getEntries() const;
 };
 
 
 #endif /* MIMETYPECONFIG_HPP */
-
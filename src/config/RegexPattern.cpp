@@ -0,0 +1,59 @@
+#include "RegexPattern.hpp"
+
+#include <stdexcept>
+
+namespace
+{
+	void	freeRegex(regex_t *regex)
+	{
+		regfree(regex);
+		delete regex;
+	}
+}
+
+RegexPattern::RegexPattern() { }
+
+RegexPattern::~RegexPattern() { }
+
+void	RegexPattern::compile(const std::string &pattern, bool caseless, const std::string &directive)
+{
+	regex_t	*regex = new regex_t;
+	int		flags = REG_EXTENDED;
+
+	if (caseless)
+		flags |= REG_ICASE;
+	int error = regcomp(regex, pattern.c_str(), flags);
+	if (error != 0)
+	{
+		char	message[256];
+		regerror(error, regex, message, sizeof(message));
+		delete regex;
+		throw std::runtime_error("invalid regular expression \"" + pattern + "\" in \"" + directive + "\" directive: " + message);
+	}
+	this->compiled = std::shared_ptr<regex_t>(regex, freeRegex);
+	this->source = pattern;
+}
+
+bool	RegexPattern::isCompiled() const
+{
+	return (this->compiled != NULL);
+}
+
+const std::string	&RegexPattern::getSource() const
+{
+	return (this->source);
+}
+
+/*
+	Matches the pattern anywhere in the subject. The positions of the whole
+	match and of the groups are stored in "captures" when it is given, unused
+	entries are set to -1.
+*/
+bool	RegexPattern::match(const std::string &subject, regmatch_t *captures, size_t captureCount) const
+{
+	if (!this->compiled)
+		return (false);
+	if (captures == NULL || captureCount == 0)
+		return (regexec(this->compiled.get(), subject.c_str(), 0, NULL, 0) == 0);
+	return (regexec(this->compiled.get(), subject.c_str(), captureCount, captures, 0) == 0);
+}
@@ -0,0 +1,40 @@
+
+
+
+#pragma once
+#ifndef REGEXPATTERN_HPP
+#define REGEXPATTERN_HPP
+
+#include <string>
+#include <memory>
+#include <regex.h>
+
+// whole match plus $1 to $9
+#define MAX_REGEX_CAPTURES 10
+
+/*
+	POSIX extended regular expression compiled once when the configuration is
+	loaded. The compiled pattern is shared between copies of the configuration.
+	Unlike std::regex, the C library matches extended expressions with an
+	automaton instead of backtracking, so a pattern cannot blow up on a
+	crafted URI.
+*/
+class RegexPattern
+{
+private:
+	std::shared_ptr<regex_t>	compiled;
+	std::string					source;
+
+public:
+	RegexPattern();
+	~RegexPattern();
+
+	void				compile(const std::string &pattern, bool caseless, const std::string &directive);
+
+	bool				isCompiled() const;
+	const std::string	&getSource() const;
+	bool				match(const std::string &subject, regmatch_t *captures = NULL, size_t captureCount = 0) const;
+};
+
+
+#endif /* REGEXPATTERN_HPP */
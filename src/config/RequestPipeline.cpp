@@ -0,0 +1,60 @@
+#include "RequestPipeline.hpp"
+#include "ServerConfig.hpp"
+#include "LocationConfig.hpp"
+
+RequestPipeline::RequestPipeline()
+{
+	for (int i = 0; i < METHOD_COUNT; i++)
+		handlers[i] = HANDLER_NOT_ALLOWED;
+}
+
+RequestPipeline::~RequestPipeline() { }
+
+void	RequestPipeline::compile(const ServerConfig &server, const LocationConfig *location)
+{
+	const BaseConfig	&config = location ? static_cast<const BaseConfig &>(*location) : server;
+	bool				serverReturn = server.returnDirective.isEnabled();
+
+	// GET
+	if (serverReturn)
+		handlers[METHOD_GET] = HANDLER_SERVER_RETURN;
+	else if (location && !location->isMethodAllowed("GET"))
+		handlers[METHOD_GET] = HANDLER_NOT_ALLOWED;
+	else if (config.returnDirective.isEnabled())
+		handlers[METHOD_GET] = HANDLER_RETURN;
+	else if (location && location->hasFastCgiPass())
+		handlers[METHOD_GET] = HANDLER_FASTCGI;
+	else if (config.tryFiles.isEnabled())
+		handlers[METHOD_GET] = HANDLER_TRY_FILES;
+	else
+		handlers[METHOD_GET] = HANDLER_SERVE_PATH;
+
+	// POST, a server level "return" does not apply
+	if (location && !location->isMethodAllowed("POST"))
+		handlers[METHOD_POST] = HANDLER_NOT_ALLOWED;
+	else if (location && location->hasFastCgiPass())
+		handlers[METHOD_POST] = HANDLER_FASTCGI;
+	else
+		handlers[METHOD_POST] = HANDLER_POST;
+
+	// DELETE
+	if (serverReturn)
+		handlers[METHOD_DELETE] = HANDLER_SERVER_RETURN;
+	else if (location && !location->isMethodAllowed("DELETE"))
+		handlers[METHOD_DELETE] = HANDLER_NOT_ALLOWED;
+	else if (config.returnDirective.isEnabled())
+		handlers[METHOD_DELETE] = HANDLER_RETURN;
+	else
+		handlers[METHOD_DELETE] = HANDLER_DELETE_PATH;
+}
+
+ContentHandler	RequestPipeline::getHandler(const std::string &method) const
+{
+	if (method == "GET")
+		return (handlers[METHOD_GET]);
+	if (method == "POST")
+		return (handlers[METHOD_POST]);
+	if (method == "DELETE")
+		return (handlers[METHOD_DELETE]);
+	return (HANDLER_NOT_ALLOWED);
+}
@@ -0,0 +1,53 @@
+
+
+
+#pragma once
+#ifndef REQUESTPIPELINE_HPP
+#define REQUESTPIPELINE_HPP
+
+#include <string>
+
+class ServerConfig;
+class LocationConfig;
+
+enum RequestMethod
+{
+	METHOD_GET,
+	METHOD_POST,
+	METHOD_DELETE,
+	METHOD_COUNT
+};
+
+enum ContentHandler
+{
+	HANDLER_NOT_ALLOWED,
+	HANDLER_SERVER_RETURN,
+	HANDLER_RETURN,
+	HANDLER_TRY_FILES,
+	HANDLER_SERVE_PATH,
+	HANDLER_DELETE_PATH,
+	HANDLER_POST,
+	HANDLER_FASTCGI
+};
+
+/*
+	Handler answering each method in a location (or in the server when no
+	location matches), decided when the configuration is loaded. The access
+	phase (limit_except) and the precedence of a server level "return" are
+	resolved here, so a request only looks up its method.
+*/
+class RequestPipeline
+{
+private:
+	ContentHandler	handlers[METHOD_COUNT];
+
+public:
+	RequestPipeline();
+	~RequestPipeline();
+
+	void			compile(const ServerConfig &server, const LocationConfig *location);
+	ContentHandler	getHandler(const std::string &method) const;
+};
+
+
+#endif /* REQUESTPIPELINE_HPP */
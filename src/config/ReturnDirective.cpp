@@ -15,7 +15,7 @@ void	ReturnDirective::setResponseTextOrUrl(const std::string &responseTextOrUrlV
 {
 	_isEnabled = true;
 	// url if status code is 301 or 302, otherwise response text
-	this->responseTextOrUrl = responseTextOrUrlValue;
+	this->responseTextOrUrl = VariableTemplate(responseTextOrUrlValue, "return");
 }
 
 bool	ReturnDirective::isEnabled() const
@@ -29,6 +29,11 @@ int	ReturnDirective::getStatusCode() const
 }
 
 const std::string	&ReturnDirective::getResponseTextOrUrl() const
+{
+	return (responseTextOrUrl.getSource());
+}
+
+const VariableTemplate	&ReturnDirective::getResponseTemplate() const
 {
 	return (responseTextOrUrl);
 }
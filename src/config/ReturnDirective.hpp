@@ -7,12 +7,13 @@
 
 
 #include <string>
+#include "VariableTemplate.hpp"
 
 class ReturnDirective
 {
 private:
 	int			statusCode;
-	std::string	responseTextOrUrl;
+	VariableTemplate	responseTextOrUrl;
 	bool		_isEnabled;
 
 public:
@@ -25,6 +26,7 @@ public:
 
 	int					getStatusCode() const;
 	const std::string	&getResponseTextOrUrl() const;
+	const VariableTemplate	&getResponseTemplate() const;
 	bool				isEnabled() const;
 
 	
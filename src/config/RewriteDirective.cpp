@@ -0,0 +1,65 @@
+#include "RewriteDirective.hpp"
+
+#include <stdexcept>
+#include <cctype>
+
+RewriteDirective::RewriteDirective(const std::vector<std::string> &values)
+	: flag(REWRITE_NONE)
+{
+	pattern.compile(values[0], false, "rewrite");
+	replacement = values[1];
+	if (values.size() < 3)
+		return;
+	if (values[2] == "last")
+		flag = REWRITE_LAST;
+	else if (values[2] == "break")
+		flag = REWRITE_BREAK;
+	else if (values[2] == "redirect")
+		flag = REWRITE_REDIRECT;
+	else if (values[2] == "permanent")
+		flag = REWRITE_PERMANENT;
+	else
+		throw std::runtime_error("invalid parameter \"" + values[2] + "\" in \"rewrite\" directive");
+}
+
+RewriteDirective::~RewriteDirective() { }
+
+/*
+	Builds the new URI into "result" if the regex matches the URI.
+*/
+bool	RewriteDirective::apply(const std::string &uri, std::string &result) const
+{
+	regmatch_t	captures[MAX_REGEX_CAPTURES];
+
+	if (!pattern.match(uri, captures, MAX_REGEX_CAPTURES))
+		return (false);
+	result.clear();
+	for (size_t i = 0; i < replacement.size(); i++)
+	{
+		if (replacement[i] == '$' && i + 1 < replacement.size() && std::isdigit(static_cast<unsigned char>(replacement[i + 1])))
+		{
+			int group = replacement[++i] - '0';
+			if (group < MAX_REGEX_CAPTURES && captures[group].rm_so != -1)
+				result.append(uri, captures[group].rm_so, captures[group].rm_eo - captures[group].rm_so);
+		}
+		else
+			result += replacement[i];
+	}
+	return (true);
+}
+
+RewriteFlag	RewriteDirective::getFlag() const
+{
+	return (this->flag);
+}
+
+bool	RewriteDirective::isRedirect() const
+{
+	return (flag == REWRITE_REDIRECT || flag == REWRITE_PERMANENT
+		|| replacement.compare(0, 7, "http://") == 0 || replacement.compare(0, 8, "https://") == 0);
+}
+
+int	RewriteDirective::getRedirectStatusCode() const
+{
+	return (flag == REWRITE_PERMANENT ? 301 : 302);
+}
@@ -0,0 +1,46 @@
+
+
+
+#pragma once
+#ifndef REWRITEDIRECTIVE_HPP
+# define REWRITEDIRECTIVE_HPP
+
+#include "RegexPattern.hpp"
+
+#include <string>
+#include <vector>
+
+enum RewriteFlag
+{
+	REWRITE_NONE,		// continue with the next rewrite directive
+	REWRITE_LAST,		// stop and search the location of the new URI
+	REWRITE_BREAK,		// stop and stay in the current location
+	REWRITE_REDIRECT,	// answer with a 302 redirect
+	REWRITE_PERMANENT	// answer with a 301 redirect
+};
+
+/*
+	rewrite <regex> <replacement> [last | break | redirect | permanent];
+	"$1" to "$9" in the replacement are the groups of the regex. A replacement
+	starting with "http://" or "https://" is always a redirect.
+*/
+class RewriteDirective
+{
+private:
+	RegexPattern	pattern;
+	std::string		replacement;
+	RewriteFlag		flag;
+
+public:
+	RewriteDirective(const std::vector<std::string> &values);
+	~RewriteDirective();
+
+	bool			apply(const std::string &uri, std::string &result) const;
+
+	RewriteFlag		getFlag() const;
+	bool			isRedirect() const;
+	int				getRedirectStatusCode() const;
+};
+
+
+#endif /* REWRITEDIRECTIVE_HPP */
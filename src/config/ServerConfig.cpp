@@ -1,12 +1,16 @@
 #include "ServerConfig.hpp"
 #include "LocationConfig.hpp"
 
+#include <algorithm>
 
-ServerConfig::ServerConfig() { }
+
+ServerConfig::ServerConfig() : hasLocationRewrites(false) { }
 
 ServerConfig::ServerConfig(const std::string &rootValue, const std::vector<std::string> &indexValues,
 				const std::string &autoindexValue, const std::string &keepaliveValue, const std::string &client_max_body_size,
+				const std::string &client_body_buffer_size, const std::string &createFullPutPathValue,
 				const std::vector<DirectiveNode *> &errorPagesDirectives)
+	: hasLocationRewrites(false)
 {
 	setDefaultValues();
 	setRoot(rootValue);
@@ -14,6 +18,8 @@ ServerConfig::ServerConfig(const std::string &rootValue, const std::vector<std::
 	setAutoindex(autoindexValue);
 	setKeepaliveTimeout(keepaliveValue);
 	setClientMaxBodySize(client_max_body_size);
+	setClientBodyBufferSize(client_body_buffer_size);
+	setCreateFullPutPath(createFullPutPathValue);
 	for (size_t i = 0; i < errorPagesDirectives.size(); i++)
 		setErrorPage(errorPagesDirectives[i]->getValues(), "Http");
 }
@@ -24,9 +30,10 @@ void	ServerConfig::setDefaultValues()
 	this->ipAddress = DEFAULT_SERVER_IP;
 	this->root = DEFAULT_SERVER_ROOT;
 	this->index.push_back(DEFAULT_SERVER_INDEX);
-	this->serverName = DEFAULT_SERVER_NAME;
 	this->autoindex = DEFAULT_SERVER_AUTOINDEX;
 	this->clientMaxBodySize = DEFAULT_CLIENT_MAX_BODY_SIZE;
+	this->clientBodyBufferSize = DEFAULT_CLIENT_BODY_BUFFER_SIZE;
+	this->createFullPutPath = DEFAULT_CREATE_FULL_PUT_PATH;
 }
 
 
@@ -85,9 +92,18 @@ void	ServerConfig::setListen(const std::string &listenValue)
 		throw std::runtime_error("invalid port in \"" + listenValue + "\" of the \"listen\" directive");
 }
 
-void	ServerConfig::setServerName(const std::string &serverNameValue)
+void	ServerConfig::addServerNames(const std::vector<std::string> &serverNameValues)
 {
-	this->serverName = serverNameValue;
+	for (size_t i = 0; i < serverNameValues.size(); i++)
+	{
+		std::string name = serverNameValues[i];
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		// only a leading "*." is a wildcard
+		if (name.find('*', name.compare(0, 2, "*.") == 0 ? 1 : 0) != std::string::npos
+			|| name == "*." || name.find('/') != std::string::npos)
+			throw std::runtime_error("invalid server name \"" + serverNameValues[i] + "\" in \"server_name\" directive");
+		this->serverNames.push_back(name);
+	}
 }
 
 void	ServerConfig::setKeepaliveTimeout(const std::string &keepaliveTimeoutValue)
@@ -110,12 +126,28 @@ void	ServerConfig::setKeepaliveTimeout(const std::string &keepaliveTimeoutValue)
 		throw std::runtime_error("invalid value in \"keepalive_timeout\" directive: \"" + keepaliveTimeoutValue + "\", it must be between 5s and 300s");
 }
 
-void	ServerConfig::addLocation(const std::string &path, const LocationConfig &locationConfig)
+/*
+	Creates a location inheriting the values of the server, in place: it is
+	filled through the returned reference instead of being copied in.
+*/
+LocationConfig	&ServerConfig::addLocation(const std::string &path)
 {
-	if (locations.find(path) != locations.end())
+	std::pair<std::map<std::string, LocationConfig>::iterator, bool> inserted = locations.try_emplace(path, path, *this);
+	if (!inserted.second)
 		throw std::runtime_error("duplicate location \"" + path + "\" in Config file");
-	locations[path] = locationConfig;
+	if (inserted.first->second.isRegex())
+		regexLocationPaths.push_back(path);
+	locationMatcher.clear();
+	return (inserted.first->second);
+}
+
+// called once a location is filled, its rewrites make the server run the rewrite phase
+void	ServerConfig::addLocationRewrites(const LocationConfig &locationConfig)
+{
+	if (!locationConfig.rewrites.empty())
+		hasLocationRewrites = true;
 }
+
 void	ServerConfig::setCgiExtension(const std::vector<std::string> &extensionsValue)
 {
 	if (extensionsValue.empty())
@@ -137,27 +169,78 @@ std::map<std::string, LocationConfig>	&ServerConfig::getLocations()
 
 LocationConfig	*ServerConfig::matchLocation(const std::string &uri)
 {
-	LocationConfig	*location = NULL;
-	std::string		path;
+	if (!locationMatcher.compiled())
+		locationMatcher.compile(locations, regexLocationPaths);
+	return (locationMatcher.match(uri));
+}
 
-	std::map<std::string, LocationConfig>::iterator it = locations.begin();
-	
-	for (; it != locations.end(); it++)
+bool	ServerConfig::hasRewrites() const
+{
+	return (!this->rewrites.empty() || this->hasLocationRewrites);
+}
+
+/*
+	Runs a list of rewrite directives on the URI. A "?" in the new URI starts
+	new query arguments, the original ones are appended to them unless the
+	replacement ends with the "?".
+*/
+RewriteFlag	ServerConfig::applyRewrites(const std::vector<RewriteDirective> &rules, std::string &uri, std::string &query,
+										bool &changed, int &redirectCode)
+{
+	std::string	result;
+
+	for (size_t i = 0; i < rules.size(); i++)
 	{
-		std::string locationPath = it->first;
-		if (locationPath[0] == '=') // exact matching
+		if (!rules[i].apply(uri, result))
+			continue;
+		size_t queryStart = result.find('?');
+		if (queryStart != std::string::npos)
 		{
-			if (uri == locationPath.substr(1))
-				return &(it->second);
+			std::string newQuery = result.substr(queryStart + 1);
+			if (!newQuery.empty() && !query.empty())
+				newQuery += "&" + query;
+			query = newQuery;
+			result.erase(queryStart);
 		}
-		else if (uri.substr(0, locationPath.length()) == locationPath) // prefix matching
+		if (rules[i].isRedirect())
 		{
-			if (location == NULL || locationPath.length() > path.length())
-			{
-				location = &(it->second);
-				path = locationPath;
-			}
+			redirectCode = rules[i].getRedirectStatusCode();
+			uri = query.empty() ? result : result + "?" + query;
+			return (REWRITE_REDIRECT);
 		}
+		uri = result;
+		changed = true;
+		if (rules[i].getFlag() == REWRITE_LAST || rules[i].getFlag() == REWRITE_BREAK)
+			return (rules[i].getFlag());
+	}
+	return (REWRITE_NONE);
+}
+
+/*
+	Runs the rewrite directives of the server, then those of the location the
+	URI maps to, and searches the location again as long as they change it.
+	For a redirect, "uri" becomes the target and "redirectCode" its status.
+*/
+RewriteStatus	ServerConfig::rewriteUri(std::string &uri, std::string &query, int &redirectCode)
+{
+	bool	changed = false;
+
+	if (applyRewrites(this->rewrites, uri, query, changed, redirectCode) == REWRITE_REDIRECT)
+		return (REWRITE_REDIRECTED);
+	for (int cycle = 0; ; cycle++)
+	{
+		LocationConfig *location = matchLocation(uri);
+		if (location == NULL || location->rewrites.empty())
+			break;
+		bool		locationChanged = false;
+		RewriteFlag	flag = applyRewrites(location->rewrites, uri, query, locationChanged, redirectCode);
+		if (flag == REWRITE_REDIRECT)
+			return (REWRITE_REDIRECTED);
+		changed = changed || locationChanged;
+		if (!locationChanged || flag == REWRITE_BREAK)
+			break;
+		if (cycle + 1 >= MAX_REWRITE_CYCLES)
+			return (REWRITE_CYCLE);
 	}
-	return (location);
+	return (changed ? REWRITE_CHANGED : REWRITE_UNCHANGED);
 }
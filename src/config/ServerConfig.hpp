@@ -6,21 +6,36 @@
 # define SERVERCONFIG_HPP
 
 #include "BaseConfig.hpp"
+#include "LocationMatcher.hpp"
 #include "../cgi/CgiDirective.hpp"
+#include "../cgi/CgiEnvironment.hpp"
+#include "../http/ResponseCache.hpp"
 
 // Default configuration values
 #define DEFAULT_SERVER_PORT 80
 #define DEFAULT_SERVER_IP "0.0.0.0"
 #define DEFAULT_SERVER_ROOT "/var/www/html"
 #define DEFAULT_SERVER_INDEX "index.html"
-#define DEFAULT_SERVER_NAME ""
 #define DEFAULT_SERVER_AUTOINDEX "off"
 #define DEFAULT_CLIENT_MAX_BODY_SIZE 1048576  // 1MB
+#define DEFAULT_CLIENT_BODY_BUFFER_SIZE 16384  // 16KB
+#define DEFAULT_CREATE_FULL_PUT_PATH "off"
 
 
 #define MIN_KEEPALIVE_TIMEOUT 5 // 5 seconds
 #define MAX_KEEPALIVE_TIMEOUT 300 // 5 minutes
 
+// location searches caused by rewrite directives before giving up on a request
+#define MAX_REWRITE_CYCLES 10
+
+enum RewriteStatus
+{
+	REWRITE_UNCHANGED,
+	REWRITE_CHANGED,
+	REWRITE_REDIRECTED,
+	REWRITE_CYCLE
+};
+
 class LocationConfig;
 
 class ServerConfig : public BaseConfig
@@ -28,34 +43,45 @@ class ServerConfig : public BaseConfig
 private:
 	bool					isValidPort(const std::string &port);
 	bool					isValidIPv4();
+	bool					hasLocationRewrites;
+	RewriteFlag				applyRewrites(const std::vector<RewriteDirective> &rules, std::string &uri, std::string &query,
+										bool &changed, int &redirectCode);
 
 public:
 
 	int										port;
 	std::string								ipAddress;
-	std::string								serverName;
+	std::vector<std::string>				serverNames; // lowercase, "*.example.com" for a wildcard
 	size_t									keepalive_timeout;
 	std::map<std::string, LocationConfig>	locations;
+	std::vector<std::string>				regexLocationPaths; // in configuration order
+	LocationMatcher							locationMatcher; // compiled from locations on first use
 	CgiDirective							cgiExtension;
+	CgiEnvironment							cgiEnvironment; // built by the Server once the configuration is final
+	ResponseCache							responseCache; // built by the Server once the configuration is final
 
 	ServerConfig();
 	ServerConfig(const std::string &rootValue, const std::vector<std::string> &indexValues,
 				const std::string &autoindexValue, const std::string &keepaliveValue, const std::string &client_max_body_size,
+				const std::string &client_body_buffer_size, const std::string &createFullPutPathValue,
 				const std::vector<DirectiveNode *> &errorPagesDirectives);
 
 	// setters
 	void					setDefaultValues();
 	void					setListen(const std::string &listenValue);
-	void					setServerName(const std::string &serverNameValue);
+	void					addServerNames(const std::vector<std::string> &serverNameValues);
 	void					setKeepaliveTimeout(const std::string &keepaliveTimeoutValue);
 	void					setCgiExtension(const std::vector<std::string> &extensionsValue);
 
 
-	void					addLocation(const std::string &path, const LocationConfig &locationConfig);
+	LocationConfig			&addLocation(const std::string &path);
+	void					addLocationRewrites(const LocationConfig &locationConfig);
 
 	std::map<std::string, LocationConfig>	&getLocations();
 
 	LocationConfig			*matchLocation(const std::string &uri);
+	bool					hasRewrites() const;
+	RewriteStatus			rewriteUri(std::string &uri, std::string &query, int &redirectCode);
 };
 
 
@@ -8,13 +8,13 @@ TryFilesDirective::~TryFilesDirective() { }
 void	TryFilesDirective::addPath(const std::string &path)
 {
 	_isEnabled = true;
-	this->paths.push_back(path);
+	this->paths.push_back(VariableTemplate(path, "try_files"));
 }
 
 void	TryFilesDirective::setFallBackUri(const std::string &uri)
 {
 	_isEnabled = true;
-	this->fallBackUri = uri;
+	this->fallBackUri = VariableTemplate(uri, "try_files");
 	this->fallBackStatusCode = 0;
 }
 
@@ -22,7 +22,7 @@ void	TryFilesDirective::setFallBackStatusCode(int code)
 {
 	_isEnabled = true;
 	this->fallBackStatusCode = code;
-	fallBackUri.clear();
+	fallBackUri = VariableTemplate();
 }
 
 bool	TryFilesDirective::isEnabled() const
@@ -30,7 +30,7 @@ bool	TryFilesDirective::isEnabled() const
 	return (this->_isEnabled);
 }
 
-const std::string	&TryFilesDirective::getFallBackUri()const
+const VariableTemplate	&TryFilesDirective::getFallBackUri()const
 {
 	return (this->fallBackUri);
 }
@@ -40,7 +40,7 @@ int		TryFilesDirective::getFallBackStatusCode() const
 	return (this->fallBackStatusCode);
 }
 
-const std::vector<std::string>	&TryFilesDirective::getPaths() const
+const std::vector<VariableTemplate>	&TryFilesDirective::getPaths() const
 {
 	return (this->paths);
 }
@@ -6,13 +6,14 @@
 
 #include <vector>
 #include <string>
+#include "VariableTemplate.hpp"
 
 class TryFilesDirective
 {
 private:
 	
-	std::vector<std::string>	paths;
-	std::string					fallBackUri;
+	std::vector<VariableTemplate>	paths;
+	VariableTemplate				fallBackUri;
 	int							fallBackStatusCode;
 	bool						_isEnabled;
 
@@ -25,8 +26,8 @@ public:
 	void					setFallBackStatusCode(int code);
 	bool					isEnabled() const;
 
-	const std::vector<std::string>		&getPaths() const;
-	const std::string					&getFallBackUri()const;
+	const std::vector<VariableTemplate>	&getPaths() const;
+	const VariableTemplate				&getFallBackUri()const;
 	int									getFallBackStatusCode() const;
 
 };
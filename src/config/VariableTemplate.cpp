@@ -0,0 +1,119 @@
+#include "VariableTemplate.hpp"
+#include "../http/RequestVariables.hpp"
+
+#include <stdexcept>
+#include <cctype>
+
+VariableTemplate::VariableTemplate() : _hasVariables(false) { }
+
+VariableTemplate::VariableTemplate(const std::string &sourceValue, const std::string &directive)
+	: source(sourceValue), _hasVariables(false)
+{
+	size_t	literalStart = 0;
+	size_t	pos = 0;
+
+	while ((pos = source.find('$', pos)) != std::string::npos)
+	{
+		bool	braced = (pos + 1 < source.size() && source[pos + 1] == '{');
+		size_t	nameStart = pos + (braced ? 2 : 1);
+		size_t	nameEnd = nameStart;
+
+		if (nameEnd >= source.size() || !std::isalpha(static_cast<unsigned char>(source[nameEnd])))
+		{
+			pos++;
+			continue;
+		}
+		while (nameEnd < source.size() && (std::isalnum(static_cast<unsigned char>(source[nameEnd])) || source[nameEnd] == '_'))
+			nameEnd++;
+		if (braced && (nameEnd >= source.size() || source[nameEnd] != '}'))
+			throw std::runtime_error("the closing bracket in \"" + source + "\" variable is missing in \"" + directive + "\" directive");
+		addLiteral(source.substr(literalStart, pos - literalStart));
+		addVariable(source.substr(nameStart, nameEnd - nameStart), directive);
+		pos = nameEnd + (braced ? 1 : 0);
+		literalStart = pos;
+	}
+	addLiteral(source.substr(literalStart));
+}
+
+VariableTemplate::~VariableTemplate() { }
+
+void	VariableTemplate::addLiteral(const std::string &text)
+{
+	if (text.empty())
+		return;
+	TemplateSegment	segment;
+	segment.isVariable = false;
+	segment.variable = VARIABLE_URI;
+	segment.text = text;
+	segments.push_back(segment);
+}
+
+void	VariableTemplate::addVariable(const std::string &name, const std::string &directive)
+{
+	TemplateSegment	segment;
+
+	segment.isVariable = true;
+	if (name == "uri")
+		segment.variable = VARIABLE_URI;
+	else if (name == "args" || name == "query_string")
+		segment.variable = VARIABLE_ARGS;
+	else if (name == "host")
+		segment.variable = VARIABLE_HOST;
+	else if (name == "remote_addr")
+		segment.variable = VARIABLE_REMOTE_ADDR;
+	else if (name == "request_method")
+		segment.variable = VARIABLE_REQUEST_METHOD;
+	else if (name == "server_protocol")
+		segment.variable = VARIABLE_SERVER_PROTOCOL;
+	else if (name.compare(0, 5, "http_") == 0 && name.size() > 5)
+	{
+		segment.variable = VARIABLE_HTTP;
+		// $http_user_agent is the User-Agent header
+		segment.text = name.substr(5);
+		for (size_t i = 0; i < segment.text.size(); i++)
+		{
+			if (segment.text[i] == '_')
+				segment.text[i] = '-';
+		}
+	}
+	else if (name.compare(0, 7, "cookie_") == 0 && name.size() > 7)
+	{
+		segment.variable = VARIABLE_COOKIE;
+		segment.text = name.substr(7);
+	}
+	else
+		throw std::runtime_error("unknown \"" + name + "\" variable in \"" + directive + "\" directive");
+	segments.push_back(segment);
+	_hasVariables = true;
+}
+
+const std::string	&VariableTemplate::getSource() const
+{
+	return (this->source);
+}
+
+bool	VariableTemplate::empty() const
+{
+	return (this->source.empty());
+}
+
+bool	VariableTemplate::hasVariables() const
+{
+	return (this->_hasVariables);
+}
+
+std::string	VariableTemplate::evaluate(RequestVariables &variables) const
+{
+	if (!_hasVariables)
+		return (source);
+
+	std::string	result;
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (segments[i].isVariable)
+			result += variables.get(segments[i].variable, segments[i].text);
+		else
+			result += segments[i].text;
+	}
+	return (result);
+}
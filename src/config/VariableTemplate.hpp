@@ -0,0 +1,60 @@
+
+
+
+#pragma once
+#ifndef VARIABLETEMPLATE_HPP
+#define VARIABLETEMPLATE_HPP
+
+#include <string>
+#include <vector>
+
+class RequestVariables;
+
+enum VariableId
+{
+	VARIABLE_URI,
+	VARIABLE_ARGS,
+	VARIABLE_HOST,
+	VARIABLE_REMOTE_ADDR,
+	VARIABLE_REQUEST_METHOD,
+	VARIABLE_SERVER_PROTOCOL,
+	VARIABLE_HTTP, // $http_<header>, the name of the segment is the header
+	VARIABLE_COOKIE // $cookie_<name>, the name of the segment is the cookie
+};
+
+struct TemplateSegment
+{
+	bool		isVariable;
+	VariableId	variable;
+	std::string	text; // literal text, or the header or cookie name of the variable
+};
+
+/*
+	Directive value containing variables ("$uri", "${host}"...), split into
+	literal and variable segments when the configuration is loaded so a
+	request only has to concatenate them. A "$" that does not start a
+	variable name is kept as it is.
+*/
+class VariableTemplate
+{
+private:
+	std::string						source;
+	std::vector<TemplateSegment>	segments;
+	bool							_hasVariables;
+
+	void	addLiteral(const std::string &text);
+	void	addVariable(const std::string &name, const std::string &directive);
+
+public:
+	VariableTemplate();
+	VariableTemplate(const std::string &sourceValue, const std::string &directive);
+	~VariableTemplate();
+
+	const std::string	&getSource() const;
+	bool				empty() const;
+	bool				hasVariables() const;
+	std::string			evaluate(RequestVariables &variables) const;
+};
+
+
+#endif /* VARIABLETEMPLATE_HPP */
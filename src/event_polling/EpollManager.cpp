@@ -3,6 +3,8 @@
 #include "EpollManager.hpp"
 #include "EventPoller.hpp"
 
+#include <cerrno>
+
 EpollManager::EpollManager()
 {
 	epfd = epoll_create1(EPOLL_CLOEXEC);
@@ -57,7 +59,14 @@ void	EpollManager::registerEvent(int fd, EventType event)
 			filterType = "WRITE EVENT";
 		}
 	}
-	if (epoll_ctl(epfd, op, fd, &epollEvent) < 0)
+	int result = epoll_ctl(epfd, op, fd, &epollEvent);
+	// the fd may have been closed and reused since it was registered, epoll already forgot it
+	if (result < 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+	{
+		epollEvent.events = (event == WRITE) ? EPOLLOUT : (EPOLLIN | EPOLLHUP | EPOLLRDHUP);
+		result = epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &epollEvent);
+	}
+	if (result < 0)
 			Logger::log(Logger::ERROR, "Failed to register a new event for fd " + std::to_string(fd) + ": " + filterType, "EpollManager::registerEvent");
 		else
 	Logger::log(Logger::DEBUG, "Registered a new event for fd " + std::to_string(fd) + ": " + filterType, "EpollManager::registerEvent");
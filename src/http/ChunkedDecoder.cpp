@@ -0,0 +1,157 @@
+#include "ChunkedDecoder.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+ChunkedDecoder::ChunkedDecoder(size_t maxBodySize)
+{
+	reset(maxBodySize);
+}
+
+ChunkedDecoder::~ChunkedDecoder() { }
+
+void	ChunkedDecoder::reset(size_t maxBodySizeValue)
+{
+	this->state = SIZE_LINE;
+	this->status = CHUNKED_IN_PROGRESS;
+	this->maxBodySize = maxBodySizeValue;
+	this->chunkSize = 0;
+	this->chunkSizeDigits = 0;
+	this->decodedSize = 0;
+}
+
+ChunkedStatus	ChunkedDecoder::fail(ChunkedStatus failureStatus)
+{
+	this->status = failureStatus;
+	return (failureStatus);
+}
+
+bool	ChunkedDecoder::processSizeDigit(char ch)
+{
+	size_t	digit;
+
+	if (std::isdigit(static_cast<unsigned char>(ch)))
+		digit = ch - '0';
+	else
+		digit = std::tolower(static_cast<unsigned char>(ch)) - 'a' + 10;
+	// skip leading zeros so they do not count against the digit limit
+	if (chunkSize == 0 && digit == 0 && chunkSizeDigits > 0)
+		return (true);
+	if (++chunkSizeDigits > MAX_CHUNK_SIZE_DIGITS)
+		return (false);
+	chunkSize = (chunkSize << 4) | digit;
+	return (true);
+}
+
+ChunkedStatus	ChunkedDecoder::decode(const char *input, size_t length, std::string &output, size_t &consumed)
+{
+	size_t	i = 0;
+
+	consumed = 0;
+	if (status != CHUNKED_IN_PROGRESS)
+		return (status);
+	while (i < length && state != DONE)
+	{
+		char	ch = input[i];
+		switch (state)
+		{
+			case SIZE_LINE:
+				if (std::isxdigit(static_cast<unsigned char>(ch)))
+				{
+					if (!processSizeDigit(ch))
+						return (fail(CHUNKED_ERROR));
+				}
+				else if (chunkSizeDigits == 0)
+					return (fail(CHUNKED_ERROR));
+				else if (ch == ';' || ch == ' ' || ch == '\t')
+					state = SIZE_EXTENSION;
+				else if (ch == '\r')
+					state = SIZE_LF;
+				else
+					return (fail(CHUNKED_ERROR));
+				i++;
+				break;
+			case SIZE_EXTENSION: // chunk extensions are ignored
+				if (ch == '\r')
+					state = SIZE_LF;
+				i++;
+				break;
+			case SIZE_LF:
+				if (ch != '\n')
+					return (fail(CHUNKED_ERROR));
+				if (chunkSize == 0)
+					state = TRAILER_LINE_START;
+				else if (maxBodySize != 0 && chunkSize > maxBodySize - decodedSize)
+					return (fail(CHUNKED_TOO_LARGE));
+				else
+					state = DATA;
+				i++;
+				break;
+			case DATA:
+			{
+				size_t	available = std::min(length - i, chunkSize);
+				output.append(input + i, available);
+				i += available;
+				chunkSize -= available;
+				decodedSize += available;
+				if (chunkSize == 0)
+					state = DATA_CR;
+				break;
+			}
+			case DATA_CR:
+				if (ch != '\r')
+					return (fail(CHUNKED_ERROR));
+				state = DATA_LF;
+				i++;
+				break;
+			case DATA_LF:
+				if (ch != '\n')
+					return (fail(CHUNKED_ERROR));
+				state = SIZE_LINE;
+				chunkSizeDigits = 0;
+				i++;
+				break;
+			case TRAILER_LINE_START: // trailer fields are discarded
+				state = (ch == '\r') ? FINAL_LF : TRAILER_LINE;
+				i++;
+				break;
+			case TRAILER_LINE:
+				if (ch == '\r')
+					state = TRAILER_LF;
+				i++;
+				break;
+			case TRAILER_LF:
+				if (ch != '\n')
+					return (fail(CHUNKED_ERROR));
+				state = TRAILER_LINE_START;
+				i++;
+				break;
+			case FINAL_LF:
+				if (ch != '\n')
+					return (fail(CHUNKED_ERROR));
+				state = DONE;
+				status = CHUNKED_COMPLETE;
+				i++;
+				break;
+			case DONE:
+				break;
+		}
+	}
+	consumed = i;
+	return (status);
+}
+
+ChunkedStatus	ChunkedDecoder::getStatus() const
+{
+	return (this->status);
+}
+
+size_t	ChunkedDecoder::getDecodedSize() const
+{
+	return (this->decodedSize);
+}
+
+bool	ChunkedDecoder::isComplete() const
+{
+	return (this->status == CHUNKED_COMPLETE);
+}
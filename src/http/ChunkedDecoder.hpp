@@ -0,0 +1,70 @@
+
+
+
+#pragma once
+#ifndef CHUNKEDDECODER_HPP
+#define CHUNKEDDECODER_HPP
+
+#include <string>
+#include <cstddef>
+
+// maximum number of hex digits accepted in a chunk-size line (64-bit size)
+#define MAX_CHUNK_SIZE_DIGITS 16
+
+enum ChunkedStatus
+{
+	CHUNKED_IN_PROGRESS,
+	CHUNKED_COMPLETE,
+	CHUNKED_TOO_LARGE,
+	CHUNKED_ERROR
+};
+
+/*
+	Incremental decoder for "Transfer-Encoding: chunked" request bodies.
+	Input can be fed in arbitrary pieces (as received from the socket), the
+	decoder keeps its position between calls and never buffers chunk data:
+	decoded bytes are appended to the caller's output buffer for each call only.
+*/
+class ChunkedDecoder
+{
+private:
+	enum State
+	{
+		SIZE_LINE,
+		SIZE_EXTENSION,
+		SIZE_LF,
+		DATA,
+		DATA_CR,
+		DATA_LF,
+		TRAILER_LINE_START,
+		TRAILER_LINE,
+		TRAILER_LF,
+		FINAL_LF,
+		DONE
+	};
+
+	State			state;
+	ChunkedStatus	status;
+	size_t			maxBodySize;
+	size_t			chunkSize;
+	size_t			chunkSizeDigits;
+	size_t			decodedSize;
+
+	ChunkedStatus	fail(ChunkedStatus failureStatus);
+	bool			processSizeDigit(char ch);
+
+public:
+	ChunkedDecoder(size_t maxBodySize = 0);
+	~ChunkedDecoder();
+
+	void			reset(size_t maxBodySizeValue);
+
+	ChunkedStatus	decode(const char *input, size_t length, std::string &output, size_t &consumed);
+
+	ChunkedStatus	getStatus() const;
+	size_t			getDecodedSize() const;
+	bool			isComplete() const;
+};
+
+
+#endif /* CHUNKEDDECODER_HPP */
@@ -213,7 +213,7 @@ bool	HttpRequest::loadRequestContent(const std::vector<std::string> &requestVec)
 		return (this->setStatus(400), false);
 	this->setHost((this->headers.find("host"))->second);
 	this->headers.insert(std::pair<std::string, std::string>("none", ""));	
-	if (this->getMethod() == "POST")
+	if (this->getMethod() == "POST" || this->getMethod() == "PUT")
 		if (!validatePostRequirements())
 			return (false);
 	return (true);
@@ -221,16 +221,70 @@ bool	HttpRequest::loadRequestContent(const std::vector<std::string> &requestVec)
 
 bool		HttpRequest::validatePostRequirements()
 {
-	if (this->headers.find("content-length") == this->headers.end() && (this->headers.find("transfer-encoding") == this->headers.end() || this->headers.find("transfer-encoding")->second != "chunked"))
+	if (this->headers.find("transfer-encoding") != this->headers.end() && !validateTransferEncoding())
+		return (false);
+	if (this->headers.find("content-length") == this->headers.end() && !this->isChunked())
 		return (this->setStatus(411), false);
 	if (this->headers.find("content-length") != this->headers.end())
 	{
 		if (this->getHeader("content-length").find_first_not_of("0987654321") != std::string::npos)
 			return (this->setStatus(400), false);
+		// a message carrying both framings is ambiguous (request smuggling), reject it
+		if (this->headers.find("transfer-encoding") != this->headers.end())
+			return (this->setStatus(400), false);
 	}
 	return (true);
 }
 
+/*
+	chunked is the only transfer coding the server decodes, and it has to
+	be the final one or the end of the body cannot be found (RFC 9112,
+	section 6.1): 400 when it is not last, 501 when it was applied on top
+	of another coding.
+*/
+bool		HttpRequest::validateTransferEncoding()
+{
+	std::vector<std::string>	codings = this->getTransferCodings();
+
+	if (codings.empty() || codings.back() != "chunked")
+		return (this->setStatus(400), false);
+	for (size_t i = 0; i + 1 < codings.size(); i++)
+	{
+		if (codings[i] == "chunked")
+			return (this->setStatus(400), false);
+	}
+	if (codings.size() > 1)
+		return (this->setStatus(501), false);
+	return (true);
+}
+
+// transfer codings of the request in the order they were applied, lowercased
+std::vector<std::string>	HttpRequest::getTransferCodings() const
+{
+	std::vector<std::string>	codings;
+	std::stringstream			ss(this->getHeader("transfer-encoding"));
+	std::string					token;
+	size_t						start;
+
+	while (std::getline(ss, token, ','))
+	{
+		start = token.find_first_not_of(" \t");
+		if (start == std::string::npos)
+			continue;
+		token = token.substr(start, token.find_last_not_of(" \t") - start + 1);
+		std::transform(token.begin(), token.end(), token.begin(), ::tolower);
+		codings.push_back(token);
+	}
+	return (codings);
+}
+
+bool	HttpRequest::isChunked() const
+{
+	std::vector<std::string>	codings = this->getTransferCodings();
+
+	return (!codings.empty() && codings.back() == "chunked");
+}
+
 bool			HttpRequest::validateHost(std::string &hostName)
 {
 	std::string		value;
@@ -303,11 +357,36 @@ bool	HttpRequest::checkVersionNumber(const std::string &str)
 	return false;
 }
 
+void	HttpRequest::setQueryString(const std::string &queryString)
+{
+	this->queries = parseQueryString("?" + queryString);
+}
+
+const std::string	&HttpRequest::getRemoteAddr() const
+{
+	return (this->remoteAddr);
+}
+
+void	HttpRequest::setRemoteAddr(const std::string &address)
+{
+	this->remoteAddr = address;
+}
+
 const std::vector<std::string>	&HttpRequest::getQueries() const
 {
 	return (this->queries);
 }
 
+void	HttpRequest::addFormField(const std::string &name, const std::string &value)
+{
+	this->formFields.push_back(std::make_pair(name, value));
+}
+
+const std::vector<std::pair<std::string, std::string> >	&HttpRequest::getFormFields() const
+{
+	return (this->formFields);
+}
+
 const std::map<std::string, std::string>	&HttpRequest::getHeaders() const
 {
 	return (this->headers);
@@ -387,6 +466,24 @@ const std::string	&HttpRequest::getHeader(const std::string &key) const
 	return (this->headers.find("none")->second);
 }
 
+void	HttpRequest::setHeader(const std::string &key, const std::string &value)
+{
+	std::string		lowerKey;
+
+	lowerKey.resize(key.size());
+	std::transform(key.begin(), key.end(), lowerKey.begin(), ::tolower);
+	this->headers[lowerKey] = value;
+}
+
+void	HttpRequest::removeHeader(const std::string &key)
+{
+	std::string		lowerKey;
+
+	lowerKey.resize(key.size());
+	std::transform(key.begin(), key.end(), lowerKey.begin(), ::tolower);
+	if (lowerKey != "none")
+		this->headers.erase(lowerKey);
+}
 
 void	HttpRequest::setVersion(const std::string &str)
 {
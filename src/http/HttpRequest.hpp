@@ -30,12 +30,13 @@ private:
 		std::map<std::string, std::string>	headers;
 		std::string							body;
 		std::vector<std::string>			queries;
+		std::vector<std::pair<std::string, std::string> >	formFields;
+		std::string							remoteAddr;
 		
 		int									status;
 
 		int 								recursionDepth;
 		
-		void				setMethod(const std::string &str);
 		void				setVersion(const std::string &str);
 		void				setHost(const std::string &hostName);
 
@@ -46,6 +47,8 @@ private:
 		void						checkArgsNumber(const std::string &arg);
 		bool						searchForHost();
 		bool						validatePostRequirements();
+		bool						validateTransferEncoding();
+		std::vector<std::string>	getTransferCodings() const;
 		bool						checkVersionNumber(const std::string &str);
 		bool						validateVersion(const std::string &versionValue);
 		bool						requestTokenizer(const std::string &requestString);
@@ -66,11 +69,20 @@ public:
 	const std::string	&getMethod() const;
 	std::string			&getUri();
 	void				setUri(const std::string &str);
+	void				setMethod(const std::string &str);
 	const std::string	&getVersion() const;
 	const std::string	&getHost() const;
 	const std::string	&getHeader(const std::string &key) const;
+	void				setHeader(const std::string &key, const std::string &value);
+	void				removeHeader(const std::string &key);
 	const std::vector<std::string>	&getQueries() const;
+	void							setQueryString(const std::string &queryString);
+	const std::string				&getRemoteAddr() const;
+	void							setRemoteAddr(const std::string &address);
+	void							addFormField(const std::string &name, const std::string &value);
+	const std::vector<std::pair<std::string, std::string> >	&getFormFields() const;
 	const std::map<std::string, std::string>	&getHeaders() const;
+	bool										isChunked() const;
 
 	int				getRecursionDepth() const;
 	void			incrementRecursionDepth();
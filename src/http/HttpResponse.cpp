@@ -1,36 +1,130 @@
 #include "HttpResponse.hpp"
+#include "StatusCodes.hpp"
+#include "../server/Clock.hpp"
 
+#include <charconv>
+#include <cstring>
+#include <strings.h>
 
-HttpResponse::HttpResponse(): type(SMALL_RESPONSE) { }
+
+namespace
+{
+	const char	*knownHeaderNames[HEADER_COUNT] =
+	{
+		"Content-Type",
+		"Content-Length",
+		"Transfer-Encoding",
+		"Connection",
+		"Location",
+		"Accept-Ranges",
+		"Content-Range"
+	};
+
+	const std::string	defaultConstantHeaders = DEFAULT_CONSTANT_HEADERS;
+
+	// longest decimal representation of a size_t
+	const size_t		MAX_NUMBER_LENGTH = 20;
+
+	size_t	formatNumber(char *output, size_t value)
+	{
+		std::to_chars_result result = std::to_chars(output, output + MAX_NUMBER_LENGTH, value);
+		return (result.ptr - output);
+	}
+}
+
+HttpResponse::HttpResponse()
+	: type(SMALL_RESPONSE), contentLength(0), hasContentLength(false), constantHeaders(NULL),
+	fileSize(0), cachedResponse(NULL) { }
 
 
+int	HttpResponse::findKnownHeader(const std::string &key)
+{
+	for (int i = 0; i < HEADER_COUNT; i++)
+	{
+		if (strcasecmp(key.c_str(), knownHeaderNames[i]) == 0)
+			return (i);
+	}
+	return (-1);
+}
+
 void	HttpResponse::setType(ResponseType typeValue)
 {
+	materialize();
 	this->type = typeValue;
 }
 
 void	HttpResponse::setVersion(const std::string& versionValue)
 {
+	materialize();
 	this->version = versionValue;
 }
 
 void	HttpResponse::setStatusCode(const std::string& statusCodeValue)
 {
+	materialize();
 	this->statusCode = statusCodeValue;
 }
 
 void	HttpResponse::setStatusMessage(const std::string& statusMessageValue)
 {
+	materialize();
 	this->statusMessage = statusMessageValue;
 }
 
+void	HttpResponse::setContentType(std::string_view contentTypeValue)
+{
+	materialize();
+	this->knownHeaders[HEADER_CONTENT_TYPE].assign(contentTypeValue.data(), contentTypeValue.size());
+}
+
 void	HttpResponse::setHeader(const std::string& key, const std::string& value)
 {
-	this->headers[key] = value;
+	materialize();
+	int	knownHeader = findKnownHeader(key);
+	if (knownHeader == HEADER_CONTENT_LENGTH)
+	{
+		size_t	length = 0;
+		std::from_chars(value.data(), value.data() + value.size(), length);
+		setContentLength(length);
+		return;
+	}
+	if (knownHeader != -1)
+	{
+		this->knownHeaders[knownHeader] = value;
+		return;
+	}
+	for (size_t i = 0; i < otherHeaders.size(); i++)
+	{
+		if (strcasecmp(otherHeaders[i].first.c_str(), key.c_str()) == 0)
+		{
+			otherHeaders[i].second = value;
+			return;
+		}
+	}
+	otherHeaders.push_back(std::make_pair(key, value));
+}
+
+void	HttpResponse::setContentLength(size_t contentLengthValue)
+{
+	materialize();
+	this->contentLength = contentLengthValue;
+	this->hasContentLength = true;
+}
+
+/*
+	Pre-formatted header lines of the location that produced the response,
+	written right after the status line.
+*/
+void	HttpResponse::setConstantHeaders(const std::string *constantHeadersValue)
+{
+	if (this->cachedResponse)
+		return;
+	this->constantHeaders = constantHeadersValue;
 }
 
 void	HttpResponse::setBody(const std::string& bodyValue)
 {
+	materialize();
 	this->body = bodyValue;
 }
 
@@ -51,26 +145,46 @@ ResponseType	HttpResponse::getType() const
 
 std::string	HttpResponse::getVersion() const
 {
+	if (this->cachedResponse)
+		return materialized().getVersion();
 	return this->version;
 }
 
 std::string	HttpResponse::getStatusCode() const
 {
+	if (this->cachedResponse)
+		return this->cachedResponse->substr(9, 3);
 	return this->statusCode;
 }
 
 std::string	HttpResponse::getStatusMessage() const
 {
+	if (this->cachedResponse)
+		return materialized().getStatusMessage();
 	return this->statusMessage;
 }
 
 std::string	HttpResponse::getHeader(const std::string& key) const
 {
-	return this->headers.at(key);
+	if (this->cachedResponse)
+		return materialized().getHeader(key);
+	int	knownHeader = findKnownHeader(key);
+	if (knownHeader == HEADER_CONTENT_LENGTH)
+		return (this->hasContentLength ? std::to_string(this->contentLength) : "");
+	if (knownHeader != -1)
+		return this->knownHeaders[knownHeader];
+	for (size_t i = 0; i < otherHeaders.size(); i++)
+	{
+		if (strcasecmp(otherHeaders[i].first.c_str(), key.c_str()) == 0)
+			return otherHeaders[i].second;
+	}
+	return "";
 }
 
 std::string	HttpResponse::getBody() const
 {
+	if (this->cachedResponse)
+		return materialized().getBody();
 	return this->body;
 }
 
@@ -84,29 +198,194 @@ size_t	HttpResponse::getFileSize() const
 	return this->fileSize;
 }
 
-std::string	HttpResponse::getStatusLine() const
+size_t	HttpResponse::getHeadSize() const
 {
-	return this->version + " " + this->statusCode + " " + this->statusMessage;
+	const std::string	&constant = this->constantHeaders ? *this->constantHeaders : defaultConstantHeaders;
+	size_t				size = version.size() + statusCode.size() + statusMessage.size() + 4
+		+ Clock::getHttpDate().size() + 8 + constant.size() + 2;
+
+	for (int i = 0; i < HEADER_COUNT; i++)
+	{
+		if (!knownHeaders[i].empty())
+			size += strlen(knownHeaderNames[i]) + knownHeaders[i].size() + 4;
+	}
+	if (hasContentLength)
+		size += strlen(knownHeaderNames[HEADER_CONTENT_LENGTH]) + MAX_NUMBER_LENGTH + 4;
+	for (size_t i = 0; i < otherHeaders.size(); i++)
+		size += otherHeaders[i].first.size() + otherHeaders[i].second.size() + 4;
+	return (size);
 }
 
-std::string	HttpResponse::getHeadersAsString() const
+/*
+	Appends the status line and the headers, in canonical order, to the buffer.
+	The buffer is grown once, so nothing else is allocated. The Date header is
+	never stored, it is taken from the clock when the response is written.
+*/
+void	HttpResponse::writeHead(std::string &buffer) const
 {
-	std::string headersAsString;
+	if (this->cachedResponse)
+	{
+		size_t	statusLineEnd = this->cachedResponse->find("\r\n") + 2;
+		buffer.reserve(buffer.size() + this->cachedResponse->size() + Clock::getHttpDate().size() + 8);
+		buffer.append(*this->cachedResponse, 0, statusLineEnd);
+		buffer.append("Date: ").append(Clock::getHttpDate()).append("\r\n");
+		buffer.append(*this->cachedResponse, statusLineEnd, this->cachedResponse->find("\r\n\r\n") + 4 - statusLineEnd);
+		return;
+	}
+	buffer.reserve(buffer.size() + getHeadSize());
+	buffer.append(version).append(1, ' ').append(statusCode).append(1, ' ').append(statusMessage).append("\r\n");
+	buffer.append("Date: ").append(Clock::getHttpDate()).append("\r\n");
+	buffer.append(this->constantHeaders ? *this->constantHeaders : defaultConstantHeaders);
+	for (int i = 0; i < HEADER_COUNT; i++)
+	{
+		if (i == HEADER_CONTENT_LENGTH && hasContentLength)
+		{
+			char	digits[MAX_NUMBER_LENGTH];
+			buffer.append(knownHeaderNames[i]).append(": ");
+			buffer.append(digits, formatNumber(digits, contentLength)).append("\r\n");
+		}
+		else if (!knownHeaders[i].empty())
+			buffer.append(knownHeaderNames[i]).append(": ").append(knownHeaders[i]).append("\r\n");
+	}
+	for (size_t i = 0; i < otherHeaders.size(); i++)
+		buffer.append(otherHeaders[i].first).append(": ").append(otherHeaders[i].second).append("\r\n");
+	buffer.append("\r\n");
+}
 
-	std::map<std::string, std::string>::const_iterator it = headers.begin();
-	while (it != headers.end())
+void	HttpResponse::writeResponse(std::string &buffer) const
+{
+	if (this->cachedResponse)
 	{
-		headersAsString += it->first + ": " + it->second + "\r\n";
-		it++;
+		writeHead(buffer);
+		buffer.append(*this->cachedResponse, this->cachedResponse->find("\r\n\r\n") + 4, std::string::npos);
+		return;
 	}
-	return headersAsString;
+	buffer.reserve(buffer.size() + getHeadSize() + body.size());
+	writeHead(buffer);
+	buffer.append(body);
 }
 
 std::string HttpResponse::buildResponse() const
 {
-	return this->getStatusLine() + "\r\n" + this->getHeadersAsString() + "\r\n" + this->getBody();
+	std::string	response;
+
+	writeResponse(response);
+	return response;
+}
+
+/*
+	Serialization without the Date header, to be stored and sent later through
+	setCachedResponse(), which adds the current date back.
+*/
+std::string HttpResponse::buildCacheableResponse() const
+{
+	std::string	response = buildResponse();
+	size_t		dateStart = response.find("\r\n") + 2;
+
+	response.erase(dateStart, response.find("\r\n", dateStart) + 2 - dateStart);
+	return response;
+}
+
+
+void	HttpResponse::setCachedResponse(const std::string *serializedResponse)
+{
+	this->cachedResponse = serializedResponse;
+}
+
+bool	HttpResponse::isCached() const
+{
+	return (this->cachedResponse != NULL);
+}
+
+/*
+	Turns a cached response back into separate fields before it is modified.
+*/
+void	HttpResponse::materialize()
+{
+	if (!this->cachedResponse)
+		return;
+	const std::string	&raw = *this->cachedResponse;
+	this->cachedResponse = NULL;
+
+	size_t lineEnd = raw.find("\r\n");
+	size_t headersEnd = raw.find("\r\n\r\n");
+	size_t firstSpace = raw.find(' ');
+	size_t secondSpace = raw.find(' ', firstSpace + 1);
+	this->version = raw.substr(0, firstSpace);
+	this->statusCode = raw.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+	this->statusMessage = (secondSpace < lineEnd) ? raw.substr(secondSpace + 1, lineEnd - secondSpace - 1) : "";
+	for (size_t pos = lineEnd + 2; pos < headersEnd + 2; )
+	{
+		size_t end = raw.find("\r\n", pos);
+		size_t colon = raw.find(": ", pos);
+		std::string key = raw.substr(pos, colon - pos);
+		// written again from the clock and the constant headers
+		if (key != "Date" && key != "Server")
+			this->setHeader(key, raw.substr(colon + 2, end - colon - 2));
+		pos = end + 2;
+	}
+	this->body = raw.substr(headersEnd + 4);
 }
 
+HttpResponse	HttpResponse::materialized() const
+{
+	HttpResponse	copy(*this);
+
+	copy.materialize();
+	return (copy);
+}
+
+/*
+	Default response of a status code, with an HTML body for errors.
+*/
+void	HttpResponse::generateStatusResponse(int statusCodeValue)
+{
+	const char	*reason = StatusCodes::getReason(statusCodeValue);
+
+	this->setVersion("HTTP/1.1");
+	this->setStatusCode(std::to_string(statusCodeValue));
+	this->setHeader("Content-Type", "text/plain");
+	if (*reason != '\0')
+	{
+		this->setStatusMessage(reason);
+		if (statusCodeValue >= 400 && statusCodeValue < 600) // Client Response Error or Server Response Error
+		{
+			this->setHeader("Content-Type", "text/html");
+			std::string message = std::to_string(statusCodeValue) + " " + reason;
+			this->setBody("<html><head><title>" + message + "</title></head>"
+						"<body><center><h1>" + message + "</h1></center>"
+						"<hr><center>nginx 2.0</center></body></html>");
+		}
+	}
+	this->setContentLength(this->body.length());
+	this->setHeader("Connection", "keep-alive");
+	if (statusCodeValue >= 500 && statusCodeValue < 600 && statusCodeValue != 503)
+		this->setHeader("Connection", "close");
+	if (statusCodeValue == 416)
+		this->setHeader("Connection", "close");
+}
+
+void	HttpResponse::generateTextResponse(int statusCodeValue, const std::string &text)
+{
+	this->setVersion("HTTP/1.1");
+	this->setStatusCode(std::to_string(statusCodeValue));
+	this->setStatusMessage(StatusCodes::getReason(statusCodeValue));
+	this->setBody(text);
+	this->setContentLength(text.length());
+	this->setHeader("Content-Type", "text/plain");
+	this->setHeader("Connection", "keep-alive");
+}
+
+void	HttpResponse::generateRedirectResponse(int statusCodeValue, const std::string &location)
+{
+	this->setVersion("HTTP/1.1");
+	this->setStatusCode(std::to_string(statusCodeValue));
+	this->setStatusMessage(StatusCodes::getReason(statusCodeValue));
+	this->setHeader("Location", location);
+	this->setContentLength(0);
+	this->setHeader("Content-Type", "text/html");
+	this->setHeader("Connection", "keep-alive");
+}
 
 void	HttpResponse::generateStandardErrorResponse(const std::string &statusCodeValue, const std::string &statusMessageValue, const std::string &title, const std::string &detail)
 {
@@ -119,8 +398,7 @@ void	HttpResponse::generateStandardErrorResponse(const std::string &statusCodeVa
                            "<body><center><h1>" + statusCodeValue + " " + statusMessageValue + "</h1></center>"
                            "<center>" + detail + "</center><hr><center>nginx 2.0</center></body></html>";
 	this->setBody(htmlBody);
-	this->setHeader("Content-Length", std::to_string(htmlBody.length()));
+	this->setContentLength(htmlBody.length());
 	this->setHeader("Connection", "close");
-	this->setHeader("Server", "nginx 2.0");
 }
 
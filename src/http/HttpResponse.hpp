@@ -1,14 +1,41 @@
 
 
+
 #pragma once
 #ifndef HTTPRESPONSE_HPP
 #define HTTPRESPONSE_HPP
 
 #include <fstream>
 #include <string>
-#include <map>
+#include <vector>
+#include <utility>
+#include <string_view>
+
+#define SERVER_SOFTWARE "Nginx 2.0"
+
+// header lines every response starts with, unless a location formatted its own
+#define DEFAULT_CONSTANT_HEADERS "Server: " SERVER_SOFTWARE "\r\n"
 
-enum	ResponseType { SMALL_RESPONSE, LARGE_RESPONSE };
+// STREAM_RESPONSE: only the head is known, the body is forwarded from a pipe as it is produced
+// FASTCGI_RESPONSE: none yet, an internal redirect ended in a location the Server passes to a FastCGI server
+enum	ResponseType { SMALL_RESPONSE, LARGE_RESPONSE, STREAM_RESPONSE, FASTCGI_RESPONSE };
+
+/*
+	Headers the server sets itself, in the order they are written after the
+	Date header and the constant headers. Any other header follows them in
+	insertion order.
+*/
+enum	ResponseHeader
+{
+	HEADER_CONTENT_TYPE,
+	HEADER_CONTENT_LENGTH,
+	HEADER_TRANSFER_ENCODING,
+	HEADER_CONNECTION,
+	HEADER_LOCATION,
+	HEADER_ACCEPT_RANGES,
+	HEADER_CONTENT_RANGE,
+	HEADER_COUNT
+};
 
 class HttpResponse
 {
@@ -18,22 +45,38 @@ class HttpResponse
 		std::string							version;
 		std::string							statusCode;
 		std::string							statusMessage;
-		std::map<std::string, std::string>	headers;
+		std::string							knownHeaders[HEADER_COUNT];
+		size_t								contentLength;
+		bool								hasContentLength;
+		std::vector<std::pair<std::string, std::string> >	otherHeaders;
+		const std::string					*constantHeaders;
 		std::string							body;
 
 		std::string							filePath;
 		size_t								fileSize;
 
+		// pre-serialized response shared with a ResponseCache, copied into fields only if modified
+		const std::string					*cachedResponse;
+
+		void			materialize();
+		HttpResponse	materialized() const;
+		size_t			getHeadSize() const;
+
+		static int		findKnownHeader(const std::string &key);
+
 	public:
 		HttpResponse();
 
-		
+
 
 		void			setType(ResponseType typeValue);
 		void			setVersion(const std::string& versionValue);
 		void			setStatusCode(const std::string& statusCodeValue);
 		void			setStatusMessage(const std::string& statusMessageValue);
 		void			setHeader(const std::string& key, const std::string& value);
+		void			setContentLength(size_t contentLengthValue);
+		void			setContentType(std::string_view contentTypeValue);
+		void			setConstantHeaders(const std::string *constantHeadersValue);
 		void			setBody(const std::string& bodyValue);
 		void			setFilePath(const std::string& filePathValue);
 		void			setFileSize(size_t fileSizeValue);
@@ -49,11 +92,17 @@ class HttpResponse
 		size_t			getFileSize() const;
 
 
-		std::string getStatusLine() const;
-		std::string getHeadersAsString() const;
+		void		writeHead(std::string &buffer) const; // status line, headers and the empty line
+		void		writeResponse(std::string &buffer) const;
+		std::string	buildResponse() const; // for small files
+		std::string	buildCacheableResponse() const;
 
-		std::string buildResponse() const; // for small files
+		void	setCachedResponse(const std::string *serializedResponse);
+		bool	isCached() const;
 
+		void	generateStatusResponse(int statusCodeValue);
+		void	generateTextResponse(int statusCodeValue, const std::string &text);
+		void	generateRedirectResponse(int statusCodeValue, const std::string &location);
 		void	generateStandardErrorResponse(const std::string &statusCodeValue, const std::string &statusMessageValue, const std::string &title, const std::string &detail = "");
 
 };
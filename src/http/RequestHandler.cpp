@@ -1,38 +1,11 @@
 #include "RequestHandler.hpp"
+#include "StatusCodes.hpp"
 
 RequestHandler::RequestHandler(ServerConfig &serverConfig, MimeTypeConfig &mimeTypeConfig)
 	: serverConfig(serverConfig), mimeTypeConfig(mimeTypeConfig) { }
 
 RequestHandler::~RequestHandler() { }
 
-void	RequestHandler::initStatusCodeMessages()
-{
-	statusCodeMessages[200] = "OK";
-	statusCodeMessages[201] = "Created";
-	statusCodeMessages[202] = "Accepted";
-	statusCodeMessages[204] = "No Content";
-	statusCodeMessages[301] = "Moved Permanently";
-	statusCodeMessages[302] = "Found";
-	statusCodeMessages[303] = "See Other";
-	statusCodeMessages[304] = "Not Modified";
-	statusCodeMessages[307] = "Temporary Redirect";
-	statusCodeMessages[308] = "Permanent Redirect";
-	statusCodeMessages[400] = "Bad Request";
-	statusCodeMessages[401] = "Unauthorized";
-	statusCodeMessages[403] = "Forbidden";
-	statusCodeMessages[404] = "Not Found";
-	statusCodeMessages[405] = "Method Not Allowed";
-	statusCodeMessages[413] = "Payload Too Large";
-	statusCodeMessages[414] = "URI Too Long";
-	statusCodeMessages[415] = "Unsupported Media Type";
-	statusCodeMessages[416] = "Range Not Satisfiable";
-	statusCodeMessages[500] = "Internal Server Error";
-	statusCodeMessages[501] = "Not Implemented";
-	statusCodeMessages[503] = "Service Unavailable";
-	statusCodeMessages[505] = "HTTP Version Not Supported";
-}
-
-
 bool	RequestHandler::fileExists(const std::string &path)
 {
 	struct stat fileStat;
@@ -98,19 +71,6 @@ bool	RequestHandler::isRedirectStatusCode(int statusCode)
 	return (false);
 }
 
-void	RequestHandler::replaceUri(std::string &str, const std::string &replace, const std::string &to)
-{
-	size_t	i = 0;
-
-	i = str.find(replace, i);
-	while (i != std::string::npos)
-	{
-		str.replace(i, replace.length(), to);
-		i += to.length();
-		i = str.find(replace, i);
-	}
-}
-
 std::string	RequestHandler::generateDirectoryListing(const std::string &uri, const std::string &path)
 {
 	std::string htmlContent = "<html><head><title>Index of " + uri + "</title></head><body><h1>Index of " + uri + "</h1><hr><pre>";
@@ -138,62 +98,34 @@ HttpResponse	RequestHandler::serveError(int statusCode)
 {
 	HttpResponse	response;
 
-	initStatusCodeMessages();
-
-	response.setVersion("HTTP/1.1");
-	response.setStatusCode(std::to_string(statusCode));
-	response.setHeader("Content-Type", "text/plain");
-	if (statusCodeMessages.find(statusCode) != statusCodeMessages.end())
-	{
-		response.setStatusMessage(statusCodeMessages[statusCode]);
-		if (statusCode >= 400 && statusCode < 600) // Client Response Error or Server Response Error
-		{
-			response.setHeader("Content-Type", "text/html");
-			// response.setBody("<html><body><h1>" + std::to_string(statusCode)
-			// 	+ " " + statusCodeMessages[statusCode] + "</h1></body></html>");
-			std::string code = std::to_string(statusCode);
-			std::string message = code + " " + statusCodeMessages[statusCode];
-			std::string htmlBody = "<html><head><title>" + message + "</title></head>"
-                           "<body><center><h1>" + message + "</h1></center>"
-                           "<hr><center>nginx 2.0</center></body></html>";
-			response.setBody(htmlBody);
-		}
-	}
-	response.setHeader("Content-Length", std::to_string(response.getBody().length()));
-	response.setHeader("Server", "Nginx 2.0");
-	response.setHeader("Connection", "keep-alive");
-	if (statusCode >= 500 && statusCode < 600 && statusCode != 503)
-		response.setHeader("Connection", "close");
-	if (statusCode == 416)
-		response.setHeader("Connection", "close");
+	const std::string *cachedResponse = serverConfig.responseCache.getStatusResponse(statusCode);
+	if (cachedResponse)
+		response.setCachedResponse(cachedResponse);
+	else
+		response.generateStatusResponse(statusCode);
 	return (response);
 }
 
 HttpResponse	RequestHandler::handleErrorPage(HttpRequest &request, BaseConfig *config, int statusCode)
 {
-	if (config->errorPages.find(statusCode) == config->errorPages.end())
+	const VariableTemplate	*errorPage = config->findErrorPage(statusCode);
+	if (!errorPage)
 		return serveError(statusCode);
 
-	const std::string &errorPageFileOrUrl = config->errorPages[statusCode];
+	std::string errorPageFileOrUrl = errorPage->evaluate(variables);
+	// the target is made of variables that were not set, the default page is served
+	if (errorPageFileOrUrl.empty())
+		return serveError(statusCode);
 	if (errorPageFileOrUrl[0] != '/')
 	{
 		HttpResponse	response;
 
-		response.setVersion("HTTP/1.1");
-		response.setStatusCode(std::to_string(302));
-		response.setStatusMessage("Found");
-		response.setHeader("Location", errorPageFileOrUrl);
-		response.setHeader("Content-Length", "0");
-		response.setHeader("Content-Type", "text/html");
-		response.setHeader("Server", "Nginx 2.0");
-		response.setHeader("Connection", "keep-alive");
+		response.generateRedirectResponse(302, errorPageFileOrUrl);
 		return (response);
 	}
 	else
 	{
 		// internal redirection
-		// config->errorPages.clear();
-		// config->errorPagesContext.clear();
 		return (handleFallbackUri(request, errorPageFileOrUrl));
 	}
 }
@@ -206,9 +138,8 @@ HttpResponse	RequestHandler::serveDirectoryListing(const std::string &uri, const
 	response.setStatusCode("200");
 	response.setStatusMessage("OK");
 	response.setBody(generateDirectoryListing(uri, path));
-	response.setHeader("Content-Length", std::to_string(response.getBody().length()));
+	response.setContentLength(response.getBody().length());
 	response.setHeader("Content-Type", "text/html");
-	response.setHeader("Server", "Nginx 2.0");
 	response.setHeader("Connection", "keep-alive");
 	return (response);
 }
@@ -217,24 +148,20 @@ HttpResponse	RequestHandler::sendRedirect(HttpRequest &request, const std::strin
 {
 	HttpResponse	response;
 
-	std::string locationHeader = "http://" + request.getHeader("Host") + url;
-	response.setVersion("HTTP/1.1");
-	response.setStatusCode("301");
-	response.setStatusMessage("Moved Permanently");
-	response.setHeader("Location", locationHeader);
-	response.setHeader("Content-Length", "0");
-	response.setHeader("Content-Type", "text/html");
-	response.setHeader("Server", "Nginx 2.0");
-	response.setHeader("Connection", "keep-alive");
+	response.generateRedirectResponse(301, "http://" + request.getHeader("Host") + url);
 	return (response);
 }
 
 HttpResponse	RequestHandler::handleFallbackUri(HttpRequest &request, const std::string &fallback)
 {
-	if (request.getRecursionDepth() >= MAX_RECURSION_DEPTH)
+	if (request.getRecursionDepth() >= MAX_RECURSION_DEPTH || fallback.empty())
 		return (serveError(500));
 	request.incrementRecursionDepth();
-	request.setUri(fallback);
+	// arguments given with the fallback replace the ones of the request
+	size_t queryStart = fallback.find('?');
+	if (queryStart != std::string::npos)
+		request.setQueryString(fallback.substr(queryStart + 1));
+	request.setUri(fallback.substr(0, queryStart));
 	return (handleRequest(request));
 }
 
@@ -253,9 +180,8 @@ HttpResponse	RequestHandler::serverSmallFile(const std::string &path)
 	}
 	std::string content = std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 	response.setBody(content);
-	response.setHeader("Content-Length", std::to_string(response.getBody().length()));
-	response.setHeader("Content-Type", mimeTypeConfig.getMimeType(path));
-	response.setHeader("Server", "Nginx 2.0");
+	response.setContentLength(response.getBody().length());
+	response.setContentType(mimeTypeConfig.getMimeType(path));
 	response.setHeader("Connection", "keep-alive");
 	file.close();
 	return (response);
@@ -271,11 +197,10 @@ HttpResponse	RequestHandler::serveChunkedResponse(const std::string &path, size_
 	response.setVersion("HTTP/1.1");
 	response.setStatusCode("200");
 	response.setStatusMessage("OK");
-	response.setHeader("Server", "Nginx 2.0");
 	response.setHeader("Connection", "keep-alive");
 	response.setHeader("Accept-Ranges", "bytes");
-	response.setHeader("Content-Type", mimeTypeConfig.getMimeType(path));
-	response.setHeader("Content-Length", std::to_string(fileSize));
+	response.setContentType(mimeTypeConfig.getMimeType(path));
+	response.setContentLength(fileSize);
 	response.setHeader("Transfer-Encoding", "chunked");
 
 	return (response);
@@ -334,9 +259,8 @@ HttpResponse	RequestHandler::handleRangeRequest(HttpRequest& request, const std:
 	response.setStatusCode("206");
 	response.setStatusMessage("Partial Content");
 	response.setBody(std::string(buffer.begin(), buffer.end()));
-	response.setHeader("Content-Length", std::to_string(contentLength));
+	response.setContentLength(contentLength);
 	response.setHeader("Content-Type", "text/plain");
-	response.setHeader("Server", "Nginx 2.0");
 	response.setHeader("Connection", "keep-alive");
 	response.setHeader("Content-Range", "bytes " + std::to_string(startByte) + "-" + std::to_string(endByte) + "/" + std::to_string(fileSize));
 	
@@ -446,38 +370,37 @@ HttpResponse	RequestHandler::handleReturnDirective(HttpRequest &request, BaseCon
 {
 	HttpResponse	response;
 
-	initStatusCodeMessages();
+	// responses that do not depend on the request are serialized when the configuration is loaded
+	std::string locationPath = (config == &serverConfig) ? "" : static_cast<LocationConfig *>(config)->getPath();
+	const std::string *cachedResponse = serverConfig.responseCache.getReturnResponse(locationPath);
+	if (cachedResponse)
+	{
+		response.setCachedResponse(cachedResponse);
+		return (response);
+	}
+
 	int statusCode = config->returnDirective.getStatusCode();
-	const std::string &responseTextOrUrl = config->returnDirective.getResponseTextOrUrl();
+	std::string responseTextOrUrl = config->returnDirective.getResponseTemplate().evaluate(variables);
 
 	if (isRedirectStatusCode(statusCode))
 	{
 		std::string httpScheme = "http://";
 		std::string locationHeader = responseTextOrUrl;
 
+		if (responseTextOrUrl.empty())
+		{
+			Logger::log(Logger::ERROR, "Redirect target of the return directive is empty", "RequestHandler::handleReturnDirective");
+			return (serveError(500));
+		}
 		if (responseTextOrUrl[0] == '/')
 			locationHeader = httpScheme + request.getHeader("Host") + responseTextOrUrl;
-		response.setVersion("HTTP/1.1");
-		response.setStatusCode(std::to_string(statusCode));
-		response.setStatusMessage(statusCodeMessages[statusCode]);
-		response.setHeader("Location", locationHeader);
-		response.setHeader("Content-Length", "0");
-		response.setHeader("Content-Type", "text/html");
-		response.setHeader("Server", "Nginx 2.0");
-		response.setHeader("Connection", "keep-alive");
+		response.generateRedirectResponse(statusCode, locationHeader);
 	}
 	else
 	{
 		if (responseTextOrUrl.empty())
 			return handleErrorPage(request, config, statusCode);
-		response.setVersion("HTTP/1.1");
-		response.setStatusCode(std::to_string(statusCode));
-		response.setStatusMessage(statusCodeMessages[statusCode]);
-		response.setBody(responseTextOrUrl);
-		response.setHeader("Content-Length", std::to_string(response.getBody().length()));
-		response.setHeader("Content-Type", "text/plain");
-		response.setHeader("Server", "Nginx 2.0");
-		response.setHeader("Connection", "keep-alive");
+		response.generateTextResponse(statusCode, responseTextOrUrl);
 	}
 	return (response);
 }
@@ -486,78 +409,35 @@ HttpResponse RequestHandler::handleTryFilesDirective(HttpRequest &request, BaseC
 {
 	std::string				tryFilesPath;
 	std::string				expandedUri;
-	const std::vector<std::string> &tryFilesParameters = config->tryFiles.getPaths();
+	const std::vector<VariableTemplate> &tryFilesParameters = config->tryFiles.getPaths();
 
+	// a path ending with a slash matches a directory, any other one a file
 	for (size_t i = 0; i < tryFilesParameters.size(); i++)
 	{
-		if (tryFilesParameters[i] == "$uri")
+		expandedUri = tryFilesParameters[i].evaluate(variables);
+		if (expandedUri.empty())
 			continue;
-		expandedUri = tryFilesParameters[i];
-		replaceUri(expandedUri, "$uri", request.getUri());
 		tryFilesPath = config->root + expandedUri;
-		if (tryFilesParameters[i] == "$uri/")
+		if (expandedUri.back() == '/')
 		{
-			if (i > 0 && tryFilesParameters[i - 1] == "$uri")
+			if (!isDirectory(tryFilesPath))
+				continue;
+			if (expandedUri == request.getUri() || expandedUri == request.getUri() + "/")
 				return (handleDirectory(request, config));
-			if (request.getUri().back() != '/')
-				return sendRedirect(request, expandedUri);
-		}
-		else if (isDirectory(tryFilesPath))
-		{
-			if (tryFilesPath.back() == '/')
-				return sendRedirect(request, expandedUri);
+			return sendRedirect(request, expandedUri);
 		}
-		else if (fileExists(tryFilesPath))
+		else if (fileExists(tryFilesPath) && !isDirectory(tryFilesPath))
 			return (serveFile(request, config, tryFilesPath));
 	}
 	if(config->tryFiles.getFallBackUri().empty())
 		return (handleErrorPage(request, config, config->tryFiles.getFallBackStatusCode()));
 	else
-	{
-		std::string fallbackUri = config->tryFiles.getFallBackUri();
-		replaceUri(fallbackUri, "$uri", request.getUri());
-		return (handleFallbackUri(request, fallbackUri));
-	}
-}
-
-HttpResponse	RequestHandler::handleGetRequest(HttpRequest &request)
-{
-	if (serverConfig.returnDirective.isEnabled())
-		return handleReturnDirective(request, &serverConfig);
-
-	BaseConfig		*config = &serverConfig;
-	LocationConfig	*locationConfig = serverConfig.matchLocation(request.getUri());
-
-	if (locationConfig)
-	{
-		config = locationConfig;
-		if (locationConfig->isMethodAllowed(request.getMethod()) == false)
-			return (serveError(405));
-	}
-
-	if (config->returnDirective.isEnabled())
-			return handleReturnDirective(request, config);
-
-	if (config->tryFiles.isEnabled())
-		return (handleTryFilesDirective(request, config));
-
-	return (servePath(request, config));
+		return (handleFallbackUri(request, config->tryFiles.getFallBackUri().evaluate(variables)));
 }
 
 HttpResponse	RequestHandler::handlePostRequest(HttpRequest &request)
 {
-	BaseConfig		*config = &serverConfig;
-	LocationConfig	*locationConfig = serverConfig.matchLocation(request.getUri());
-
-	if (locationConfig)
-	{
-		config = locationConfig;
-		if (locationConfig->isMethodAllowed(request.getMethod()) == false)
-			return (serveError(405));
-	}
-	
 	(void)request;
-	(void)config;
 	HttpResponse response;
 
 	response.setVersion("HTTP/1.1");
@@ -565,48 +445,128 @@ HttpResponse	RequestHandler::handlePostRequest(HttpRequest &request)
 	response.setStatusMessage("OK");
 	std::string body = "<h2>Your Post request was successful received and handled</h2>";
 	response.setBody(body);
-	response.setHeader("Content-Length", std::to_string(body.length()));
+	response.setContentLength(body.length());
 	response.setHeader("Content-Type", "text/html");
-	response.setHeader("Server", "Nginx 2.0");
 	response.setHeader("Connection", "keep-alive");
 
 	return (response);
 }
 
-HttpResponse	RequestHandler::handleDeleteRequest(HttpRequest &request)
+/*
+	Answers a body stored by "upload_store": the new files are announced under
+	the request URI, followed by their generated file names, one per line. The
+	Location header points to the first one.
+*/
+HttpResponse	RequestHandler::handleUploadedFiles(HttpRequest &request, const std::vector<std::string> &filePaths)
 {
-	if (serverConfig.returnDirective.isEnabled())
-		return handleReturnDirective(request, &serverConfig);
+	HttpResponse	response;
+	std::string		baseUri = request.getUri();
+	std::string		body;
 
-	BaseConfig		*config = &serverConfig;
-	LocationConfig	*locationConfig = serverConfig.matchLocation(request.getUri());
+	if (baseUri.empty() || baseUri[baseUri.size() - 1] != '/')
+		baseUri += "/";
+	for (size_t i = 0; i < filePaths.size(); i++)
+		body += baseUri + filePaths[i].substr(filePaths[i].find_last_of('/') + 1) + "\n";
+
+	response.setVersion("HTTP/1.1");
+	response.setStatusCode("201");
+	response.setStatusMessage(StatusCodes::getReason(201));
+	if (!filePaths.empty())
+		response.setHeader("Location", body.substr(0, body.find('\n')));
+	response.setBody(body);
+	response.setContentLength(body.length());
+	response.setHeader("Content-Type", "text/plain");
+	response.setHeader("Connection", "keep-alive");
+	attachConstantHeaders(response, request.getUri());
+	return (response);
+}
+
+HttpResponse	RequestHandler::handleStoredPutRequest(HttpRequest &request, bool replaced)
+{
+	HttpResponse	response;
+
+	if (replaced)
+		return (serveError(204));
+	response.setVersion("HTTP/1.1");
+	response.setStatusCode("201");
+	response.setStatusMessage(StatusCodes::getReason(201));
+	response.setHeader("Location", request.getUri());
+	response.setContentLength(0);
+	response.setHeader("Connection", "keep-alive");
+	attachConstantHeaders(response, request.getUri());
+	return (response);
+}
+
+void	RequestHandler::attachConstantHeaders(HttpResponse &response, const std::string &uri)
+{
+	LocationConfig	*locationConfig = serverConfig.matchLocation(uri);
 
 	if (locationConfig)
+		response.setConstantHeaders(&locationConfig->constantHeaders);
+	else
+		response.setConstantHeaders(&serverConfig.constantHeaders);
+}
+
+/*
+	Runs the handler compiled for the method in the configuration the URI
+	maps to.
+*/
+HttpResponse	RequestHandler::dispatchRequest(HttpRequest &request, BaseConfig *config)
+{
+	switch (config->pipeline.getHandler(request.getMethod()))
 	{
-		config = locationConfig;
-		if (locationConfig->isMethodAllowed(request.getMethod()) == false)
-			return (serveError(405));
+		case HANDLER_SERVER_RETURN:
+			return (handleReturnDirective(request, &serverConfig));
+		case HANDLER_RETURN:
+			return (handleReturnDirective(request, config));
+		case HANDLER_TRY_FILES:
+			return (handleTryFilesDirective(request, config));
+		case HANDLER_SERVE_PATH:
+			return (servePath(request, config));
+		case HANDLER_DELETE_PATH:
+			return (deletePath(request, config));
+		case HANDLER_POST:
+			return (handlePostRequest(request));
+		case HANDLER_FASTCGI:
+			// the Server passes these requests on before they get here, only an internal redirect can
+			return (passToFastCgi(request));
+		case HANDLER_NOT_ALLOWED:
+			break;
 	}
+	return (serveError(405));
+}
 
-	if (config->returnDirective.isEnabled())
-			return handleReturnDirective(request, config);
-
-	return (deletePath(request, config));
+// the rewritten request is left to the Server, which passes it to the FastCGI server of its location
+HttpResponse	RequestHandler::passToFastCgi(HttpRequest &request)
+{
+	HttpResponse	response;
 
+	Logger::log(Logger::DEBUG, "Internal redirect of '" + request.getUri() + "' to a FastCGI location", "RequestHandler::passToFastCgi");
+	response.setType(FASTCGI_RESPONSE);
+	return (response);
 }
 
 HttpResponse	RequestHandler::handleRequest(HttpRequest &request)
 {
+	HttpResponse	response;
+
+	// internal redirects come back here with a new URI
+	variables.reset(request);
 	if (request.getStatus() != 200)
-		return (serveError(request.getStatus()));
-
-	if (request.getMethod() == "GET")
-		return (handleGetRequest(request));
-	else if (request.getMethod() == "POST")
-		return (handlePostRequest(request));
-	else if (request.getMethod() == "DELETE")
-		return (handleDeleteRequest(request));
-	else
-		return (serveError(405));
-}
+	{
+		response = serveError(request.getStatus());
+		response.setConstantHeaders(&serverConfig.constantHeaders);
+		return (response);
+	}
 
+	LocationConfig	*locationConfig = serverConfig.matchLocation(request.getUri());
+	BaseConfig		*config = locationConfig ? static_cast<BaseConfig *>(locationConfig) : &serverConfig;
+
+	int				recursionDepth = request.getRecursionDepth();
+
+	response = dispatchRequest(request, config);
+	// after an internal redirect the response already has the headers of the final location
+	if (request.getRecursionDepth() == recursionDepth)
+		response.setConstantHeaders(&config->constantHeaders);
+	return (response);
+}
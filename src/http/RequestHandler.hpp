@@ -6,6 +6,7 @@
 
 #include "HttpRequest.hpp"
 #include "HttpResponse.hpp"
+#include "RequestVariables.hpp"
 #include "../config/ServerConfig.hpp"
 #include "../config/LocationConfig.hpp"
 #include "../parsing/MimeTypeParser.hpp"
@@ -29,17 +30,18 @@ private:
 
 	ServerConfig						&serverConfig;
 	MimeTypeConfig						&mimeTypeConfig;
-	std::map<int, std::string>			statusCodeMessages;
+	RequestVariables					variables;
 
-	void			initStatusCodeMessages();
 	bool			fileExists(const std::string &path);
 	bool			pathExists(std::string path);
 	bool			isDirectory(const std::string& path);
 	size_t			getFileSize(const std::string& path);
 	bool			fileExistsAndAccessible(const std::string &path);
 	bool			isRedirectStatusCode(int statusCode);
-	void			replaceUri(std::string &str, const std::string &replace, const std::string &to);
 	bool			parseRangeHeader(HttpRequest &request, size_t &startByte, size_t &endByte, size_t fileSize);
+	void			attachConstantHeaders(HttpResponse &response, const std::string &uri);
+	HttpResponse	dispatchRequest(HttpRequest &request, BaseConfig *config);
+	HttpResponse	passToFastCgi(HttpRequest &request);
 	
 
 public:
@@ -77,9 +79,9 @@ public:
 	HttpResponse	handleTryFilesDirective(HttpRequest &request, BaseConfig *config);
 
 	HttpResponse	handleRequest(HttpRequest &request);
-	HttpResponse	handleGetRequest(HttpRequest &request);
 	HttpResponse	handlePostRequest(HttpRequest &request);
-	HttpResponse	handleDeleteRequest(HttpRequest &request);
+	HttpResponse	handleStoredPutRequest(HttpRequest &request, bool replaced);
+	HttpResponse	handleUploadedFiles(HttpRequest &request, const std::vector<std::string> &filePaths);
 };
 
 	
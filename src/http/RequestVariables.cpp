@@ -0,0 +1,105 @@
+#include "RequestVariables.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+RequestVariables::RequestVariables() : request(NULL), cookiesParsed(false)
+{
+	std::fill(evaluated, evaluated + VARIABLE_HTTP, false);
+}
+
+RequestVariables::RequestVariables(HttpRequest &requestValue) : request(NULL), cookiesParsed(false)
+{
+	reset(requestValue);
+}
+
+RequestVariables::~RequestVariables() { }
+
+void	RequestVariables::reset(HttpRequest &requestValue)
+{
+	this->request = &requestValue;
+	std::fill(evaluated, evaluated + VARIABLE_HTTP, false);
+	cookies.clear();
+	cookiesParsed = false;
+}
+
+void	RequestVariables::evaluate(VariableId variable)
+{
+	std::string	&value = values[variable];
+
+	value.clear();
+	switch (variable)
+	{
+		case VARIABLE_ARGS:
+		{
+			const std::vector<std::string> &queries = request->getQueries();
+			for (size_t i = 0; i < queries.size(); i++)
+				value += (i > 0 ? "&" : "") + queries[i];
+			break;
+		}
+		case VARIABLE_HOST:
+			// without the port, in lowercase
+			value = request->getHeader("Host").substr(0, request->getHeader("Host").find(':'));
+			std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+			break;
+		case VARIABLE_REMOTE_ADDR:
+			value = request->getRemoteAddr();
+			break;
+		case VARIABLE_REQUEST_METHOD:
+			value = request->getMethod();
+			break;
+		case VARIABLE_SERVER_PROTOCOL:
+			value = request->getVersion();
+			break;
+		default:
+			break;
+	}
+	evaluated[variable] = true;
+}
+
+void	RequestVariables::parseCookies()
+{
+	const std::string	&header = request->getHeader("Cookie");
+	size_t				pos = 0;
+
+	while (pos < header.size())
+	{
+		size_t end = header.find(';', pos);
+		if (end == std::string::npos)
+			end = header.size();
+		size_t equal = header.find('=', pos);
+		if (equal != std::string::npos && equal < end)
+		{
+			size_t nameStart = header.find_first_not_of(" \t", pos);
+			std::string name = header.substr(nameStart, equal - nameStart);
+			name.erase(name.find_last_not_of(" \t") + 1);
+			// the first cookie of a name wins, like in browsers
+			if (cookies.find(name) == cookies.end())
+				cookies[name] = header.substr(equal + 1, end - equal - 1);
+		}
+		pos = end + 1;
+	}
+	cookiesParsed = true;
+}
+
+const std::string	&RequestVariables::get(VariableId variable, const std::string &name)
+{
+	static const std::string	empty;
+
+	if (request == NULL)
+		return (empty);
+	if (variable == VARIABLE_URI)
+		return (request->getUri());
+	if (variable == VARIABLE_HTTP)
+		return (request->getHeader(name));
+	if (variable == VARIABLE_COOKIE)
+	{
+		if (!cookiesParsed)
+			parseCookies();
+		std::map<std::string, std::string>::const_iterator it = cookies.find(name);
+		return (it == cookies.end() ? empty : it->second);
+	}
+	if (!evaluated[variable])
+		evaluate(variable);
+	return (values[variable]);
+}
@@ -0,0 +1,42 @@
+
+
+
+#pragma once
+#ifndef REQUESTVARIABLES_HPP
+#define REQUESTVARIABLES_HPP
+
+#include "HttpRequest.hpp"
+#include "../config/VariableTemplate.hpp"
+
+#include <string>
+#include <map>
+
+/*
+	Values of the variables of a request, computed the first time a template
+	asks for them. $uri and the headers are read from the request directly,
+	the others are kept until the request is reset (internal redirects change
+	the URI and the arguments).
+*/
+class RequestVariables
+{
+private:
+	HttpRequest							*request;
+	std::string							values[VARIABLE_HTTP];
+	bool								evaluated[VARIABLE_HTTP];
+	std::map<std::string, std::string>	cookies;
+	bool								cookiesParsed;
+
+	void				evaluate(VariableId variable);
+	void				parseCookies();
+
+public:
+	RequestVariables();
+	explicit RequestVariables(HttpRequest &requestValue);
+	~RequestVariables();
+
+	void				reset(HttpRequest &requestValue);
+	const std::string	&get(VariableId variable, const std::string &name = "");
+};
+
+
+#endif /* REQUESTVARIABLES_HPP */
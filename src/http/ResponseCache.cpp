@@ -0,0 +1,98 @@
+#include "ResponseCache.hpp"
+#include "HttpResponse.hpp"
+#include "StatusCodes.hpp"
+#include "../config/ServerConfig.hpp"
+#include "../config/LocationConfig.hpp"
+
+ResponseCache::ResponseCache() { }
+
+ResponseCache::~ResponseCache() { }
+
+void	ResponseCache::build(ServerConfig &serverConfig)
+{
+	size_t						count;
+	const StatusCodes::Entry	*entries = StatusCodes::getEntries(count);
+
+	serverConfig.formatConstantHeaders();
+	std::map<std::string, LocationConfig>::iterator it = serverConfig.locations.begin();
+	for (; it != serverConfig.locations.end(); it++)
+		it->second.formatConstantHeaders();
+
+	statusResponses.assign(MAX_STATUS_CODE + 1, std::string());
+	closingErrorResponses.assign(MAX_STATUS_CODE + 1, std::string());
+	returnResponses.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		HttpResponse	statusResponse;
+		statusResponse.setConstantHeaders(&serverConfig.constantHeaders);
+		statusResponse.generateStatusResponse(entries[i].code);
+		statusResponses[entries[i].code] = statusResponse.buildCacheableResponse();
+
+		if (entries[i].code < 400)
+			continue;
+		HttpResponse	errorResponse;
+		errorResponse.setConstantHeaders(&serverConfig.constantHeaders);
+		std::string		code = std::to_string(entries[i].code);
+		errorResponse.generateStandardErrorResponse(code, entries[i].reason, code + " " + entries[i].reason);
+		closingErrorResponses[entries[i].code] = errorResponse.buildCacheableResponse();
+	}
+
+	buildReturnResponse("", serverConfig);
+	for (it = serverConfig.locations.begin(); it != serverConfig.locations.end(); it++)
+		buildReturnResponse(it->first, it->second);
+}
+
+/*
+	Only a text response, or a redirect to a full URL, is the same for every
+	request. Redirects to a path need the request's Host header, an empty
+	text falls back to the error pages and variables are request specific.
+*/
+void	ResponseCache::buildReturnResponse(const std::string &key, const BaseConfig &config)
+{
+	if (!config.returnDirective.isEnabled() || config.returnDirective.getResponseTemplate().hasVariables())
+		return;
+
+	int					statusCode = config.returnDirective.getStatusCode();
+	const std::string	&textOrUrl = config.returnDirective.getResponseTextOrUrl();
+	HttpResponse		response;
+
+	response.setConstantHeaders(&config.constantHeaders);
+	if (statusCode == 301 || statusCode == 302 || statusCode == 303
+		|| statusCode == 307 || statusCode == 308)
+	{
+		if (textOrUrl.empty() || textOrUrl[0] == '/')
+			return;
+		response.generateRedirectResponse(statusCode, textOrUrl);
+	}
+	else
+	{
+		if (textOrUrl.empty())
+			return;
+		response.generateTextResponse(statusCode, textOrUrl);
+	}
+	returnResponses[key] = response.buildCacheableResponse();
+}
+
+const std::string	*ResponseCache::getStatusResponse(int statusCode) const
+{
+	if (statusCode < 0 || static_cast<size_t>(statusCode) >= statusResponses.size()
+		|| statusResponses[statusCode].empty())
+		return (NULL);
+	return (&statusResponses[statusCode]);
+}
+
+const std::string	*ResponseCache::getClosingErrorResponse(int statusCode) const
+{
+	if (statusCode < 0 || static_cast<size_t>(statusCode) >= closingErrorResponses.size()
+		|| closingErrorResponses[statusCode].empty())
+		return (NULL);
+	return (&closingErrorResponses[statusCode]);
+}
+
+const std::string	*ResponseCache::getReturnResponse(const std::string &locationPath) const
+{
+	std::map<std::string, std::string>::const_iterator it = returnResponses.find(locationPath);
+	if (it == returnResponses.end())
+		return (NULL);
+	return (&it->second);
+}
@@ -0,0 +1,44 @@
+
+
+
+#pragma once
+#ifndef RESPONSECACHE_HPP
+#define RESPONSECACHE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+
+class ServerConfig;
+class BaseConfig;
+
+/*
+	Fully serialized responses that only depend on the configuration, built
+	once per server when the configuration is loaded (along with the constant
+	headers of every location): the default response of
+	every known status code, the closing error responses sent for rejected
+	requests and the responses of "return" directives that do not depend on
+	the request. Serving one of them is a copy of the cached bytes.
+*/
+class ResponseCache
+{
+private:
+	std::vector<std::string>			statusResponses;
+	std::vector<std::string>			closingErrorResponses;
+	std::map<std::string, std::string>	returnResponses; // by location path, "" for the server
+
+	void	buildReturnResponse(const std::string &key, const BaseConfig &config);
+
+public:
+	ResponseCache();
+	~ResponseCache();
+
+	void				build(ServerConfig &serverConfig);
+
+	const std::string	*getStatusResponse(int statusCode) const;
+	const std::string	*getClosingErrorResponse(int statusCode) const;
+	const std::string	*getReturnResponse(const std::string &locationPath) const;
+};
+
+
+#endif /* RESPONSECACHE_HPP */
@@ -0,0 +1,63 @@
+#include "StatusCodes.hpp"
+
+#include <algorithm>
+
+const StatusCodes::Entry	StatusCodes::entries[] =
+{
+	{ 100, "Continue" },
+	{ 200, "OK" },
+	{ 201, "Created" },
+	{ 202, "Accepted" },
+	{ 204, "No Content" },
+	{ 206, "Partial Content" },
+	{ 301, "Moved Permanently" },
+	{ 302, "Found" },
+	{ 303, "See Other" },
+	{ 304, "Not Modified" },
+	{ 307, "Temporary Redirect" },
+	{ 308, "Permanent Redirect" },
+	{ 400, "Bad Request" },
+	{ 401, "Unauthorized" },
+	{ 403, "Forbidden" },
+	{ 404, "Not Found" },
+	{ 405, "Method Not Allowed" },
+	{ 409, "Conflict" },
+	{ 411, "Length Required" },
+	{ 413, "Request Entity Too Large" },
+	{ 414, "Request-URI Too Large" },
+	{ 415, "Unsupported Media Type" },
+	{ 416, "Range Not Satisfiable" },
+	{ 417, "Expectation Failed" },
+	{ 500, "Internal Server Error" },
+	{ 501, "Not Implemented" },
+	{ 502, "Bad Gateway" },
+	{ 503, "Service Unavailable" },
+	{ 504, "Gateway Timeout" },
+	{ 505, "HTTP Version Not Supported" }
+};
+
+const size_t	StatusCodes::entryCount = sizeof(StatusCodes::entries) / sizeof(StatusCodes::entries[0]);
+
+static bool	compareEntryCode(const StatusCodes::Entry &entry, int statusCode)
+{
+	return (entry.code < statusCode);
+}
+
+/*
+	Returns the reason phrase of a status code, an empty string for unknown codes.
+*/
+const char	*StatusCodes::getReason(int statusCode)
+{
+	const Entry	*end = entries + entryCount;
+	const Entry	*entry = std::lower_bound(entries, end, statusCode, compareEntryCode);
+
+	if (entry == end || entry->code != statusCode)
+		return ("");
+	return (entry->reason);
+}
+
+const StatusCodes::Entry	*StatusCodes::getEntries(size_t &count)
+{
+	count = entryCount;
+	return (entries);
+}
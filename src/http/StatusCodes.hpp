@@ -0,0 +1,35 @@
+
+
+
+#pragma once
+#ifndef STATUSCODES_HPP
+#define STATUSCODES_HPP
+
+#include <cstddef>
+
+// highest status code a response can carry
+#define MAX_STATUS_CODE 599
+
+/*
+	Reason phrases of the status codes the server sends, kept in a static table
+	sorted by code so a lookup never allocates.
+*/
+class StatusCodes
+{
+public:
+	struct Entry
+	{
+		int			code;
+		const char	*reason;
+	};
+
+	static const char	*getReason(int statusCode);
+	static const Entry	*getEntries(size_t &count);
+
+private:
+	static const Entry	entries[];
+	static const size_t	entryCount;
+};
+
+
+#endif /* STATUSCODES_HPP */
@@ -1,4 +1,5 @@
 #include "Logger.hpp"
+#include "../server/Clock.hpp"
 
 
 void	Logger::setLevel(Level level)
@@ -45,16 +46,6 @@ std::string	Logger::levelToString(Level level)
 	}
 }
 
-std::string	Logger::getCurrentTimeFormatted()
-{
-	std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-	std::time_t now_c = std::chrono::system_clock::to_time_t(now);
-
-	std::stringstream ss;
-	ss << std::put_time(std::localtime(&now_c), "%Y/%m/%d %X");
-	return ss.str();
-}
-
 void	Logger::init(Logger::Level logLevel, const std::string &logFilePath)
 {
 	currentLevel = logLevel;
@@ -85,7 +76,7 @@ void	Logger::log(Level level, const std::string& message, const std::string& sou
 	if (level < currentLevel) return;
 
 	std::ostringstream logLine;
-	logLine << getCurrentTimeFormatted() << levelToString(level) << " [" << source << "] " << message;
+	logLine << Clock::getLogTimestamp() << levelToString(level) << " [" << source << "] " << message;
 	if (isStandardOutput)
 		logLine << "\033[0m";
 
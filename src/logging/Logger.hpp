@@ -42,7 +42,6 @@ private:
 	
 
 	static std::string levelToString(Level level);
-	static std::string getCurrentTimeFormatted();
 
 
 };
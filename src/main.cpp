@@ -6,17 +6,38 @@
 #include "server/ServerManager.hpp"
 #include "logging/Logger.hpp"
 
+#include <memory>
+
 static void	signalHandler(int signum)
 {
-	if (signum == SIGINT || signum == SIGTERM)
+	if (signum == SIGINT)
 	{
 		ServerManager::running = 0;
 	}
+	else if (signum == SIGTERM || signum == SIGQUIT)
+	{
+		ServerManager::gracefulShutdownRequested = 1;
+	}
+	else if (signum == SIGHUP)
+	{
+		ServerManager::reloadRequested = 1;
+	}
+	else if (signum == SIGUSR2)
+	{
+		ServerManager::upgradeRequested = 1;
+	}
 	else if (signum == SIGCHLD)
 	{
 		int status;
 		pid_t pid;
-		while ((pid = waitpid(-1, &status, WNOHANG)) > 0) { }
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+		{
+			if (pid == ServerManager::upgradePid)
+			{
+				ServerManager::upgradePid = 0;
+				ServerManager::upgradeExited = 1;
+			}
+		}
 	}
 }
 
@@ -33,44 +54,55 @@ static void	setupSignalHandlers()
 	sigaction(SIGINT, &sa, NULL);
 	sigaction(SIGTERM, &sa, NULL);
 	sigaction(SIGCHLD, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+	sigaction(SIGUSR2, &sa, NULL);
+	sigaction(SIGQUIT, &sa, NULL);
 }
 
-static void	initializeConfigFile(int argc, char **argv, std::string &configFile)
+static void	printUsage(const char *programName)
 {
-	if (argc == 1)
-	{
-		configFile = "conf/nginx.conf";
-	}
-	else if (argc == 2)
-	{
-		configFile = argv[1];
-	}
-	else
+	std::cerr << "Usage: " << programName << " [config file | snapshot file]" << std::endl;
+	std::cerr << "       " << programName << " -c compile [config file] [snapshot file]" << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+/*
+	"-c compile" loads the configuration and writes it as a binary snapshot
+	instead of starting the server, the snapshot is then given in place of
+	the configuration file.
+*/
+static void	initializeConfigFile(int argc, char **argv, std::string &configFile, std::string &snapshotFile)
+{
+	int	argIndex = 1;
+
+	if (argc > 1 && std::string(argv[1]) == "-c")
 	{
-		std::cerr << "Usage: " << argv[0] << " [config file]" << std::endl;
-		exit(EXIT_FAILURE);
+		if (argc < 3 || argc > 5 || std::string(argv[2]) != "compile")
+			printUsage(argv[0]);
+		argIndex = 3;
 	}
+	else if (argc > 2)
+		printUsage(argv[0]);
+
+	configFile = (argIndex < argc) ? argv[argIndex] : "conf/nginx.conf";
+	if (argIndex == 3)
+		snapshotFile = (argIndex + 1 < argc) ? argv[argIndex + 1] : configFile + CONFIG_SNAPSHOT_EXTENSION;
 }
 
 int main(int argc, char **argv)
 {
-	std::vector<ServerConfig>	serverConfigs;
-	MimeTypeConfig				mimeTypeConfig;
-	EventPoller					*eventManager;
-	std::string					configFile;
+	std::shared_ptr<ConfigGeneration>	generation = std::make_shared<ConfigGeneration>(1);
+	EventPoller							*eventManager;
+	std::string							configFile;
+	std::string							snapshotFile;
 
-	initializeConfigFile(argc, argv, configFile);
+	initializeConfigFile(argc, argv, configFile, snapshotFile);
 
     try
 	{
-		ConfigParser parser(configFile);
-		parser.parseConfigFile();
-
-		MimeTypeParser mimeTypeParser("conf/mime.types");
-		mimeTypeParser.parseMimeTypeFile(mimeTypeConfig);
-
-		ConfigLoader loader(parser.getConfigTreeRoot());
-		loader.loadServers(serverConfigs);
+		generation->load(configFile, snapshotFile);
+		if (!snapshotFile.empty())
+			return 0;
 
 		eventManager = new EventManager();
 	
@@ -85,7 +117,8 @@ int main(int argc, char **argv)
 
 	Logger::init(Logger::DEBUG, "logs/WebServer.log");
 
-	ServerManager serverManager(serverConfigs, eventManager, mimeTypeConfig);
+	ServerManager serverManager(configFile, generation, eventManager, argv);
+	generation.reset(); // owned by the server manager, released once replaced by a reload
 	Logger::log(Logger::DEBUG, "Starting server manager", "main");
 	serverManager.start();
 
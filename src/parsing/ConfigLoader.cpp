@@ -8,6 +8,9 @@ ConfigLoader::ConfigLoader(ConfigNode *treeRoot)
 	this->autoindex = DEFAULT_HTTP_AUTOINDEX_VALUE;
 	this->keepalive_timeout = DEFAULT_HTTP_KEEPALIVE_TIMEOUT;
 	this->client_max_body_size = DEFAULT_HTTP_CLIENT_MAX_BODY_SIZE;
+	this->client_body_buffer_size = DEFAULT_HTTP_CLIENT_BODY_BUFFER_SIZE;
+	this->create_full_put_path = DEFAULT_HTTP_CREATE_FULL_PUT_PATH;
+	this->shutdown_timeout = DEFAULT_HTTP_SHUTDOWN_TIMEOUT;
 	this->treeRootNode = treeRoot;
 }
 
@@ -28,14 +31,24 @@ void ConfigLoader::processLocationNode(ContextNode* locationNode, LocationConfig
 				locationConfig.setAutoindex(directive->getValues()[0]);
 			else if (directive->getKey() == "client_max_body_size")
 				locationConfig.setClientMaxBodySize(directive->getValues()[0]);
+			else if (directive->getKey() == "client_body_buffer_size")
+				locationConfig.setClientBodyBufferSize(directive->getValues()[0]);
+			else if (directive->getKey() == "create_full_put_path")
+				locationConfig.setCreateFullPutPath(directive->getValues()[0]);
 			else if (directive->getKey() == "error_page")
 				locationConfig.setErrorPage(directive->getValues(), "Location");
 			else if (directive->getKey() == "try_files")
 				locationConfig.setTryFiles(directive->getValues());
 			else if (directive->getKey() == "return")
 				locationConfig.setReturn(directive->getValues());
+			else if (directive->getKey() == "rewrite")
+				locationConfig.addRewrite(directive->getValues());
 			else if (directive->getKey() == "limit_except")
 				locationConfig.setAllowedMethods(directive->getValues());
+			else if (directive->getKey() == "upload_store")
+				locationConfig.setUploadStore(directive->getValues()[0]);
+			else if (directive->getKey() == "fastcgi_pass")
+				locationConfig.setFastCgiPass(directive->getValues()[0]);
 		}
 	}
 }
@@ -52,9 +65,13 @@ void	ConfigLoader::processServerNode(ContextNode* serverNode, ServerConfig &serv
 			if (directive->getKey() == "listen")
 				serverConfig.setListen(directive->getValues()[0]);
 			else if (directive->getKey() == "server_name")
-				serverConfig.setServerName(directive->getValues()[0]);
+				serverConfig.addServerNames(directive->getValues());
 			else if (directive->getKey() == "client_max_body_size")
 				serverConfig.setClientMaxBodySize(directive->getValues()[0]);
+			else if (directive->getKey() == "client_body_buffer_size")
+				serverConfig.setClientBodyBufferSize(directive->getValues()[0]);
+			else if (directive->getKey() == "create_full_put_path")
+				serverConfig.setCreateFullPutPath(directive->getValues()[0]);
 			else if (directive->getKey() == "error_page")
 				serverConfig.setErrorPage(directive->getValues(), "Server");
 			else if (directive->getKey() == "root")
@@ -69,6 +86,8 @@ void	ConfigLoader::processServerNode(ContextNode* serverNode, ServerConfig &serv
 				serverConfig.setTryFiles(directive->getValues());
 			else if (directive->getKey() == "return")
 				serverConfig.setReturn(directive->getValues());
+			else if (directive->getKey() == "rewrite")
+				serverConfig.addRewrite(directive->getValues());
 			else if (directive->getKey() == "cgi_extension")
 				serverConfig.setCgiExtension(directive->getValues());
 		}
@@ -80,9 +99,9 @@ void	ConfigLoader::processServerNode(ContextNode* serverNode, ServerConfig &serv
 			ContextNode	*locationNode = static_cast<ContextNode *>(serverChildren[i]);
 			if (locationNode->getName() == "location")
 			{
-				LocationConfig location(locationNode->getPath(), serverConfig);
+				LocationConfig &location = serverConfig.addLocation(locationNode->getPath());
 				processLocationNode(locationNode, location);
-				serverConfig.addLocation(locationNode->getPath(), location);
+				serverConfig.addLocationRewrites(location);
 			}
 		}
 	}
@@ -109,10 +128,20 @@ void	ConfigLoader::processHttpNode(ContextNode *treeRoot, std::vector<ServerConf
 				this->keepalive_timeout = directive->getValues()[0];
 			else if (directive->getKey() == "client_max_body_size")
 				this->client_max_body_size = directive->getValues()[0];
+			else if (directive->getKey() == "client_body_buffer_size")
+				this->client_body_buffer_size = directive->getValues()[0];
+			else if (directive->getKey() == "create_full_put_path")
+				this->create_full_put_path = directive->getValues()[0];
 			else if (directive->getKey() == "error_page")
 				this->errorPagesDirectives.push_back(directive);
+			else if (directive->getKey() == "types")
+				this->types = directive->getValues()[0];
+			else if (directive->getKey() == "shutdown_timeout")
+				this->shutdown_timeout = directive->getValues()[0];
 		}
 	}
+	// servers are built in place, the vector is never reallocated while they are filled
+	servers.reserve(servers.size() + httpChildren.size());
 	for (size_t i = 0; i < httpChildren.size(); i++)
 	{
 		if (httpChildren[i]->getType() == Context)
@@ -120,7 +149,7 @@ void	ConfigLoader::processHttpNode(ContextNode *treeRoot, std::vector<ServerConf
 			ContextNode *serverNode = static_cast<ContextNode *>(httpChildren[i]);
 			if (serverNode->getName() == "server")
 			{
-				servers.push_back(ServerConfig(this->root, this->index, this->autoindex, this->keepalive_timeout, this->client_max_body_size, this->errorPagesDirectives));
+				servers.emplace_back(this->root, this->index, this->autoindex, this->keepalive_timeout, this->client_max_body_size, this->client_body_buffer_size, this->create_full_put_path, this->errorPagesDirectives);
 				ServerConfig &server = servers.back();
 				processServerNode(serverNode, server);
 			}
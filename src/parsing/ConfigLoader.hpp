@@ -14,6 +14,9 @@
 #define DEFAULT_HTTP_AUTOINDEX_VALUE "off"
 #define DEFAULT_HTTP_KEEPALIVE_TIMEOUT "15s"
 #define DEFAULT_HTTP_CLIENT_MAX_BODY_SIZE "1m"
+#define DEFAULT_HTTP_CLIENT_BODY_BUFFER_SIZE "16k"
+#define DEFAULT_HTTP_CREATE_FULL_PUT_PATH "off"
+#define DEFAULT_HTTP_SHUTDOWN_TIMEOUT "30s"
 
 
 
@@ -33,6 +36,10 @@ public:
 	std::string						autoindex;
 	std::string						keepalive_timeout;		
 	std::string						client_max_body_size;
+	std::string						client_body_buffer_size;
+	std::string						create_full_put_path;
+	std::string						types; // MIME types file, the default one is optional
+	std::string						shutdown_timeout;
 	std::vector<DirectiveNode *>	errorPagesDirectives;
 
 	ConfigLoader(ConfigNode *treeRoot);
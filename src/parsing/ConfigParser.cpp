@@ -1,8 +1,15 @@
 #include "ConfigParser.hpp"
 
+#include <glob.h>
+
 
 ConfigParser::ConfigParser(const std::string &fileName)
-	: configFileName(fileName), configTreeRoot(NULL) { }
+	: configFileName(fileName), configTreeRoot(NULL)
+{
+	size_t slash = fileName.find_last_of('/');
+	if (slash != std::string::npos)
+		configDirectory = fileName.substr(0, slash + 1);
+}
 
 ConfigParser::~ConfigParser()
 {
@@ -10,86 +17,118 @@ ConfigParser::~ConfigParser()
 		delete configTreeRoot;
 }
 
-void	ConfigParser::readConfigFile()
+void	ConfigParser::readFile(const std::string &fileName, std::string &content)
 {
 	struct stat		fileStat;
-	if (stat(configFileName.c_str(), &fileStat) == 0)
+	if (stat(fileName.c_str(), &fileStat) == 0)
 	{
 		if (!S_ISREG(fileStat.st_mode))
 			throw std::runtime_error("Error: The specified configuration file ('"
-			+ configFileName + "') is not a regular file. Please provide a valid file.");
+			+ fileName + "') is not a regular file. Please provide a valid file.");
 	}
 	else
 		throw std::runtime_error("Error: Unable to find the configuration file ('"
-		+ configFileName + "'). Please check the file path and try again.");
+		+ fileName + "'). Please check the file path and try again.");
 
-	std::ifstream	file(configFileName.c_str());
-	std::string		line;
+	std::ifstream	file(fileName.c_str(), std::ios::binary);
 
 	if (!file.is_open())
 		throw std::runtime_error("Error: Unable to open the configuration file ('"
-		+ configFileName + "') for reading. Please check file permissions and try again.");
-	while (std::getline(file, line))
-		configFileContent += line + "\n";
+		+ fileName + "') for reading. Please check file permissions and try again.");
+	content.resize(fileStat.st_size);
+	file.read(&content[0], content.size());
+	content.resize(file.gcount());
 	file.close();
 }
 
-void	ConfigParser::tokenizeConfigFile()
+void	ConfigParser::readConfigFile()
+{
+	readFile(configFileName, configFileContent);
+}
+
+/*
+	Moves the tokens of a file to the token list, an "include" directive is
+	replaced by the tokens of the files it names. It is recognized wherever a
+	directive can start, so included files may hold any part of the
+	configuration.
+*/
+void	ConfigParser::appendTokens(std::vector<std::string> &fileTokens, std::vector<std::string> &tokens, int depth)
 {
-	std::string					currentToken;
-	std::set<char>				delimiters;
-	delimiters.insert('{');
-	delimiters.insert('}');
-	delimiters.insert(';');
+	bool	isStatementStart = true;
 
-	for (std::string::iterator it = configFileContent.begin(); it != configFileContent.end(); it++)
+	for (size_t i = 0; i < fileTokens.size(); i++)
 	{
-		char	ch = *it;
-		if (delimiters.find(ch) != delimiters.end())
+		if (isStatementStart && fileTokens[i] == "include")
 		{
-			if (!currentToken.empty())
-			{
-				configTokens.push_back(currentToken);
-				currentToken.clear();
-			}
-			configTokens.push_back(std::string(1, ch));
+			if (i + 2 >= fileTokens.size() || fileTokens[i + 2] != ";"
+				|| fileTokens[i + 1] == "{" || fileTokens[i + 1] == "}" || fileTokens[i + 1] == ";")
+				throw std::runtime_error("invalid number of arguments in \"include\" directive");
+			includeFiles(fileTokens[i + 1], tokens, depth + 1);
+			i += 2;
+			continue;
 		}
-		else if (std::isspace(ch))
-		{
-			if (!currentToken.empty())
-			{
-				configTokens.push_back(currentToken);
-				currentToken.clear();
-			}
-		}
-		else if (ch == '"' && currentToken.empty())
-		{
-			it++;
-			while (it != configFileContent.end() && *it != '"')
-			{
-				currentToken += *it;
-				it++;
-			}
-			if (it == configFileContent.end())
-				throw std::runtime_error("unexpected end of file, expecting \";\" or \"}\"");
-			configTokens.push_back(currentToken);
-			currentToken.clear();
-		}
-		else if (ch == '#')
+		isStatementStart = (fileTokens[i] == "{" || fileTokens[i] == "}" || fileTokens[i] == ";");
+		tokens.push_back(std::string());
+		tokens.back().swap(fileTokens[i]);
+	}
+}
+
+/*
+	Files matching a pattern are included in alphabetical order. A pattern
+	without wildcards must name an existing file, one with wildcards may
+	match nothing.
+*/
+void	ConfigParser::includeFiles(const std::string &pattern, std::vector<std::string> &tokens, int depth)
+{
+	if (depth > MAX_INCLUDE_DEPTH)
+		throw std::runtime_error("\"include\" nesting is deeper than " + std::to_string(MAX_INCLUDE_DEPTH)
+			+ " levels in \"" + pattern + "\", the files probably include each other");
+
+	std::string	fullPattern = (pattern[0] == '/') ? pattern : configDirectory + pattern;
+	glob_t		matches;
+	int			status = glob(fullPattern.c_str(), 0, NULL, &matches);
+
+	if (status == GLOB_NOMATCH)
+	{
+		globfree(&matches);
+		if (fullPattern.find_first_of("*?[") != std::string::npos)
+			return;
+		throw std::runtime_error("Error: Unable to find the included file ('"
+		+ fullPattern + "'). Please check the file path and try again.");
+	}
+	if (status != 0)
+	{
+		globfree(&matches);
+		throw std::runtime_error("Error: Unable to read the files matching \"" + fullPattern + "\" in \"include\" directive");
+	}
+	try
+	{
+		for (size_t i = 0; i < matches.gl_pathc; i++)
 		{
-			if (!currentToken.empty())
-			{
-				configTokens.push_back(currentToken);
-				currentToken.clear();
-			}
-			while (it != configFileContent.end() && *it != '\n')
-				it++;
+			std::string					content;
+			std::vector<std::string>	fileTokens;
+
+			readFile(matches.gl_pathv[i], content);
+			ConfigTokenizer::tokenize(content, fileTokens);
+			appendTokens(fileTokens, tokens, depth);
 		}
-		else
-			currentToken += ch;
 	}
-	if (!currentToken.empty())
-		configTokens.push_back(currentToken);
+	catch (...)
+	{
+		globfree(&matches);
+		throw;
+	}
+	globfree(&matches);
+}
+
+void	ConfigParser::tokenizeConfigFile()
+{
+	std::vector<std::string>	fileTokens;
+
+	ConfigTokenizer::tokenize(configFileContent, fileTokens);
+	std::string().swap(configFileContent);
+	configTokens.reserve(fileTokens.size());
+	appendTokens(fileTokens, configTokens, 0);
 }
 
 void	ConfigParser::parseConfigFile()
@@ -102,6 +141,15 @@ void	ConfigParser::parseConfigFile()
 	logicValidator.validate(configTreeRoot);
 }
 
+/*
+	The snapshot was validated when it was compiled, it also holds the MIME
+	types so no other file is read.
+*/
+void	ConfigParser::loadConfigSnapshot(MimeTypeConfig &mimeTypeConfig)
+{
+	configTreeRoot = ConfigSnapshot::load(configFileName, mimeTypeConfig);
+}
+
 
 
 // Getters
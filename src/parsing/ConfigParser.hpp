@@ -9,17 +9,23 @@
 #include "SyntaxValidator.hpp"
 #include "TreeBuilder.hpp"
 #include "LogicValidator.hpp"
+#include "ConfigSnapshot.hpp"
+#include "ConfigTokenizer.hpp"
 
 
 #include <fstream>
 #include <sys/stat.h>
 
+// files included from included files, deeper nesting is most likely an include loop
+#define MAX_INCLUDE_DEPTH 8
+
 
 
 class ConfigParser
 {
 private:
 	std::string					configFileName;
+	std::string					configDirectory; // relative include patterns start from here
 	std::string					configFileContent;
 	std::vector<std::string>	configTokens;
 	ConfigNode					*configTreeRoot;
@@ -27,6 +33,10 @@ private:
 
 	ConfigParser();
 
+	static void	readFile(const std::string &fileName, std::string &content);
+	void		appendTokens(std::vector<std::string> &fileTokens, std::vector<std::string> &tokens, int depth);
+	void		includeFiles(const std::string &pattern, std::vector<std::string> &tokens, int depth);
+
 public:
 	ConfigParser(const std::string &fileName);
 	~ConfigParser();
@@ -34,6 +44,7 @@ public:
 	void	readConfigFile();
 	void	tokenizeConfigFile();
 	void	parseConfigFile();
+	void	loadConfigSnapshot(MimeTypeConfig &mimeTypeConfig);
 
 	// Getters
 	ConfigNode					*getConfigTreeRoot();
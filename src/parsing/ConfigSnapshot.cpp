@@ -0,0 +1,249 @@
+#include "ConfigSnapshot.hpp"
+#include "ContextNode.hpp"
+#include "DirectiveNode.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+ConfigSnapshot::ConfigSnapshot(const char *snapshotData, size_t snapshotSize)
+	: data(snapshotData), size(snapshotSize), offset(0) { }
+
+void	ConfigSnapshot::writeNumber(std::string &buffer, uint32_t value)
+{
+	buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void	ConfigSnapshot::writeString(std::string &buffer, const std::string &value)
+{
+	writeNumber(buffer, value.size());
+	buffer.append(value);
+}
+
+void	ConfigSnapshot::writeNode(std::string &buffer, ConfigNode *node)
+{
+	if (node->getType() == Context)
+	{
+		ContextNode						*context = static_cast<ContextNode *>(node);
+		const std::vector<ConfigNode *>	&children = context->getChildren();
+
+		buffer += static_cast<char>(Context);
+		writeString(buffer, context->getName());
+		writeString(buffer, context->getPath());
+		writeNumber(buffer, children.size());
+		for (size_t i = 0; i < children.size(); i++)
+			writeNode(buffer, children[i]);
+	}
+	else
+	{
+		DirectiveNode					*directive = static_cast<DirectiveNode *>(node);
+		const std::vector<std::string>	&values = directive->getValues();
+
+		buffer += static_cast<char>(Directive);
+		writeString(buffer, directive->getKey());
+		writeNumber(buffer, values.size());
+		for (size_t i = 0; i < values.size(); i++)
+			writeString(buffer, values[i]);
+	}
+}
+
+// FNV-1a, catches truncated and damaged files, not tampering
+uint32_t	ConfigSnapshot::checksum(const char *bytes, size_t length)
+{
+	uint32_t	hash = 2166136261U;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= static_cast<unsigned char>(bytes[i]);
+		hash *= 16777619U;
+	}
+	return (hash);
+}
+
+uint32_t	ConfigSnapshot::readNumber()
+{
+	uint32_t	value;
+
+	if (size - offset < sizeof(value))
+		throw std::runtime_error("unexpected end of snapshot");
+	std::memcpy(&value, data + offset, sizeof(value));
+	offset += sizeof(value);
+	return (value);
+}
+
+std::string	ConfigSnapshot::readString()
+{
+	uint32_t	length = readNumber();
+
+	if (size - offset < length)
+		throw std::runtime_error("unexpected end of snapshot");
+	std::string value(data + offset, length);
+	offset += length;
+	return (value);
+}
+
+void	ConfigSnapshot::readHeader()
+{
+	if (size < CONFIG_SNAPSHOT_HEADER_SIZE
+		|| std::memcmp(data, CONFIG_SNAPSHOT_MAGIC, CONFIG_SNAPSHOT_MAGIC_SIZE) != 0)
+		throw std::runtime_error("not a configuration snapshot");
+	offset = CONFIG_SNAPSHOT_MAGIC_SIZE;
+	if (readNumber() != CONFIG_SNAPSHOT_VERSION)
+		throw std::runtime_error("snapshot version does not match this server, compile it again");
+	if (readNumber() != CONFIG_SNAPSHOT_BYTE_ORDER)
+		throw std::runtime_error("snapshot was compiled on a machine with another byte order");
+	uint32_t payloadSize = readNumber();
+	uint32_t payloadChecksum = readNumber();
+	if (payloadSize != size - offset)
+		throw std::runtime_error("snapshot size does not match its header");
+	if (checksum(data + offset, payloadSize) != payloadChecksum)
+		throw std::runtime_error("snapshot checksum mismatch");
+}
+
+ConfigNode	*ConfigSnapshot::readNode(ConfigNode *parent, int depth)
+{
+	if (depth > MAX_CONFIG_SNAPSHOT_DEPTH || offset >= size)
+		throw std::runtime_error("malformed configuration tree");
+
+	char	type = data[offset++];
+	if (type == Directive)
+	{
+		DirectiveNode	*directive = new DirectiveNode(readString(), parent);
+		try
+		{
+			uint32_t valueCount = readNumber();
+			for (uint32_t i = 0; i < valueCount; i++)
+				directive->addValue(readString());
+		}
+		catch (...)
+		{
+			delete directive;
+			throw;
+		}
+		return (directive);
+	}
+	if (type != Context)
+		throw std::runtime_error("malformed configuration tree");
+
+	std::string	name = readString();
+	ContextNode	*context = new ContextNode(name, parent, readString());
+	try
+	{
+		uint32_t childCount = readNumber();
+		for (uint32_t i = 0; i < childCount; i++)
+			context->addChild(readNode(context, depth + 1));
+	}
+	catch (...)
+	{
+		delete context;
+		throw;
+	}
+	return (context);
+}
+
+void	ConfigSnapshot::readMimeTypes(MimeTypeConfig &mimeTypeConfig)
+{
+	uint32_t	entryCount = readNumber();
+
+	for (uint32_t i = 0; i < entryCount; i++)
+	{
+		std::string extension = readString();
+		mimeTypeConfig.addMimeType(extension, readString());
+	}
+}
+
+bool	ConfigSnapshot::isSnapshot(const std::string &fileName)
+{
+	std::ifstream	file(fileName.c_str(), std::ios::binary);
+	char			magic[CONFIG_SNAPSHOT_MAGIC_SIZE];
+
+	if (!file.read(magic, CONFIG_SNAPSHOT_MAGIC_SIZE))
+		return (false);
+	return (std::memcmp(magic, CONFIG_SNAPSHOT_MAGIC, CONFIG_SNAPSHOT_MAGIC_SIZE) == 0);
+}
+
+/*
+	The snapshot is written next to its final name and renamed over it, a
+	server starting meanwhile never maps a partially written file.
+*/
+void	ConfigSnapshot::write(const std::string &fileName, ConfigNode *root, const MimeTypeConfig &mimeTypeConfig)
+{
+	std::string					payload;
+	std::vector<MimeTypeEntry>	mimeTypes = mimeTypeConfig.getEntries();
+
+	writeNode(payload, root);
+	writeNumber(payload, mimeTypes.size());
+	for (size_t i = 0; i < mimeTypes.size(); i++)
+	{
+		writeString(payload, mimeTypes[i].extension);
+		writeString(payload, mimeTypes[i].mimeType);
+	}
+
+	std::string	header(CONFIG_SNAPSHOT_MAGIC, CONFIG_SNAPSHOT_MAGIC_SIZE);
+	writeNumber(header, CONFIG_SNAPSHOT_VERSION);
+	writeNumber(header, CONFIG_SNAPSHOT_BYTE_ORDER);
+	writeNumber(header, payload.size());
+	writeNumber(header, checksum(payload.data(), payload.size()));
+
+	std::string		temporaryName = fileName + ".tmp";
+	std::ofstream	file(temporaryName.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("Error: Unable to create the configuration snapshot ('"
+		+ temporaryName + "'): " + std::string(strerror(errno)));
+	file.write(header.data(), header.size());
+	file.write(payload.data(), payload.size());
+	file.close();
+	if (file.fail() || rename(temporaryName.c_str(), fileName.c_str()) < 0)
+	{
+		unlink(temporaryName.c_str());
+		throw std::runtime_error("Error: Unable to write the configuration snapshot ('"
+		+ fileName + "'): " + std::string(strerror(errno)));
+	}
+}
+
+ConfigNode	*ConfigSnapshot::load(const std::string &fileName, MimeTypeConfig &mimeTypeConfig)
+{
+	struct stat	fileStat;
+	int			fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		throw std::runtime_error("Error: Unable to open the configuration snapshot ('"
+		+ fileName + "'): " + std::string(strerror(errno)));
+	if (fstat(fd, &fileStat) < 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size == 0)
+	{
+		close(fd);
+		throw std::runtime_error("Error: The configuration snapshot ('" + fileName + "') is not a valid file.");
+	}
+	size_t	fileSize = fileStat.st_size;
+	void	*mapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		throw std::runtime_error("Error: Unable to map the configuration snapshot ('"
+		+ fileName + "'): " + std::string(strerror(errno)));
+
+	ConfigNode	*root = NULL;
+	try
+	{
+		ConfigSnapshot	snapshot(static_cast<const char *>(mapping), fileSize);
+		snapshot.readHeader();
+		root = snapshot.readNode(NULL, 0);
+		snapshot.readMimeTypes(mimeTypeConfig);
+		if (snapshot.offset != snapshot.size)
+			throw std::runtime_error("unexpected data after the MIME types");
+	}
+	catch (const std::exception &e)
+	{
+		delete root;
+		munmap(mapping, fileSize);
+		throw std::runtime_error("Error: Invalid configuration snapshot ('" + fileName + "'): " + e.what());
+	}
+	munmap(mapping, fileSize);
+	return (root);
+}
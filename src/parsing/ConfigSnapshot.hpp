@@ -0,0 +1,77 @@
+
+
+
+#pragma once
+#ifndef CONFIGSNAPSHOT_HPP
+#define CONFIGSNAPSHOT_HPP
+
+#include "ConfigNode.hpp"
+#include "../config/MimeTypeConfig.hpp"
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+#define CONFIG_SNAPSHOT_MAGIC "NGX2SNAP"
+#define CONFIG_SNAPSHOT_MAGIC_SIZE 8
+
+// bumped whenever the layout or the set of directives changes
+#define CONFIG_SNAPSHOT_VERSION 3
+
+// written in native byte order, a snapshot from another architecture is rejected
+#define CONFIG_SNAPSHOT_BYTE_ORDER 0x01020304
+
+// magic, version, byte order, payload size and checksum
+#define CONFIG_SNAPSHOT_HEADER_SIZE (CONFIG_SNAPSHOT_MAGIC_SIZE + 4 * 4)
+
+// appended to the configuration file name when no snapshot name is given
+#define CONFIG_SNAPSHOT_EXTENSION ".snap"
+
+// http > server > location, anything deeper is a corrupted snapshot
+#define MAX_CONFIG_SNAPSHOT_DEPTH 3
+
+/*
+	Binary snapshot of a validated configuration: the configuration tree as
+	built by TreeBuilder followed by the complete MIME type table. Loading it
+	maps the file and rebuilds the tree directly, skipping the reading,
+	tokenizing and validation passes and the MIME types file. The tree still
+	goes through ConfigLoader, which compiles what cannot be stored (regular
+	expressions, location matchers, variable templates).
+
+	Layout, numbers are 32-bit in native byte order, strings are a length
+	followed by their bytes:
+
+		header	magic, version, byte order, payload size, payload checksum
+		node	type (0 context, 1 directive)
+				context: name, path, child count, children
+				directive: key, value count, values
+		mime	entry count, then extension and type of each entry
+*/
+class ConfigSnapshot
+{
+private:
+	const char	*data;
+	size_t		size;
+	size_t		offset;
+
+	ConfigSnapshot(const char *snapshotData, size_t snapshotSize);
+
+	static void		writeNumber(std::string &buffer, uint32_t value);
+	static void		writeString(std::string &buffer, const std::string &value);
+	static void		writeNode(std::string &buffer, ConfigNode *node);
+	static uint32_t	checksum(const char *bytes, size_t length);
+
+	uint32_t		readNumber();
+	std::string		readString();
+	void			readHeader();
+	ConfigNode		*readNode(ConfigNode *parent, int depth);
+	void			readMimeTypes(MimeTypeConfig &mimeTypeConfig);
+
+public:
+	static bool			isSnapshot(const std::string &fileName);
+	static void			write(const std::string &fileName, ConfigNode *root, const MimeTypeConfig &mimeTypeConfig);
+	static ConfigNode	*load(const std::string &fileName, MimeTypeConfig &mimeTypeConfig);
+};
+
+
+#endif /* CONFIGSNAPSHOT_HPP */
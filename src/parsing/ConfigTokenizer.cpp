@@ -1,36 +1,49 @@
 #include "ConfigTokenizer.hpp"
 
+#include <cctype>
+
+bool	ConfigTokenizer::isTokenEnd(char ch)
+{
+	return (ch == '{' || ch == '}' || ch == ';' || ch == '#'
+		|| std::isspace(static_cast<unsigned char>(ch)));
+}
+
 void	ConfigTokenizer::tokenize(const std::string &input, std::vector<std::string> &tokens)
 {
-	std::string					currentToken;
-	std::set<char>				delimiters;
-	delimiters.insert('{');
-	delimiters.insert('}');
-	delimiters.insert(';');
+	size_t	size = input.size();
+	size_t	i = 0;
 
-	for (std::string::const_iterator it = input.begin(); it != input.end(); it++)
+	while (i < size)
 	{
-		char	ch = *it;
-		if (delimiters.find(ch) != delimiters.end())
+		char	ch = input[i];
+		if (ch == '{' || ch == '}' || ch == ';')
 		{
-			if (!currentToken.empty())
-			{
-				tokens.push_back(currentToken);
-				currentToken.clear();
-			}
 			tokens.push_back(std::string(1, ch));
+			i++;
 		}
-		else if (std::isspace(ch))
+		else if (std::isspace(static_cast<unsigned char>(ch)))
+			i++;
+		else if (ch == '#')
 		{
-			if (!currentToken.empty())
-			{
-				tokens.push_back(currentToken);
-				currentToken.clear();
-			}
+			i = input.find('\n', i);
+			if (i == std::string::npos)
+				i = size;
+		}
+		else if (ch == '"')
+		{
+			size_t end = input.find('"', i + 1);
+			if (end == std::string::npos)
+				throw std::runtime_error("unexpected end of file, expecting \";\" or \"}\"");
+			tokens.push_back(input.substr(i + 1, end - i - 1));
+			i = end + 1;
 		}
 		else
-			currentToken += ch;
+		{
+			// a quote inside a word is part of it
+			size_t start = i;
+			while (i < size && !isTokenEnd(input[i]))
+				i++;
+			tokens.push_back(input.substr(start, i - start));
+		}
 	}
-	if (!currentToken.empty())
-		tokens.push_back(currentToken);
 }
@@ -1,5 +1,6 @@
 
 
+
 #pragma once
 #ifndef CONFIGTOKENIZER_HPP
 # define CONFIGTOKENIZER_HPP
@@ -7,11 +8,20 @@
 
 #include <string>
 #include <vector>
-#include <set>
+#include <stdexcept>
 
 
+/*
+	Splits a configuration file into tokens in a single pass: words, quoted
+	strings (without their quotes) and the "{", "}" and ";" delimiters.
+	Comments run from "#" to the end of the line. Every token is copied out
+	of the input once, as a whole.
+*/
 class	ConfigTokenizer
 {
+private:
+	static bool	isTokenEnd(char ch);
+
 public:
 	static void	tokenize(const std::string &input, std::vector<std::string> &tokens);
 };
@@ -9,10 +9,14 @@ LogicValidator::LogicValidator()
 
 	possibleDirs["autoindex"] = std::make_pair(OneArg, Independent); /*only one*/
 
-	possibleDirs["server_name"] = std::make_pair(OneArg, ParentNeeded); /*only one*/
+	possibleDirs["server_name"] = std::make_pair(OneOrMoreArgs, ParentNeeded); /*one or more*/
 
 	possibleDirs["client_max_body_size"] = std::make_pair(OneArg, Independent); /*only one*/
 
+	possibleDirs["client_body_buffer_size"] = std::make_pair(OneArg, Independent); /*only one*/
+
+	possibleDirs["create_full_put_path"] = std::make_pair(OneArg, Independent); /*only one*/
+
 	possibleDirs["error_page"] = std::make_pair(TwoOrMoreArgs, Independent); /*two or more*/
 
 	possibleDirs["try_files"] = std::make_pair(TwoOrMoreArgs, ParentNeeded); /*two or more*/
@@ -21,12 +25,22 @@ LogicValidator::LogicValidator()
 
 	possibleDirs["return"] = std::make_pair(OneOrTwoArgs, ParentNeeded); /*one or two*/
 
+	possibleDirs["rewrite"] = std::make_pair(TwoOrThreeArgs, ParentNeeded); /*two or three*/
+
 	possibleDirs["limit_except"] = std::make_pair(OneOrMoreArgs, ParentNeeded); /*one or more*/
 
+	possibleDirs["upload_store"] = std::make_pair(OneArg, ParentNeeded); /*only one*/
+
 	possibleDirs["keepalive_timeout"] = std::make_pair(OneArg, ParentNeeded); /*only one*/
 
 	possibleDirs["cgi_extension"] = std::make_pair(OneOrMoreArgs, ParentNeeded); /*only one*/
 
+	possibleDirs["types"] = std::make_pair(OneArg, ParentNeeded); /*only one*/
+
+	possibleDirs["shutdown_timeout"] = std::make_pair(OneArg, ParentNeeded); /*only one*/
+
+	possibleDirs["fastcgi_pass"] = std::make_pair(OneArg, ParentNeeded); /*only one*/
+
 }
 
 
@@ -42,6 +56,8 @@ void	LogicValidator::validateDirectiveArgs(DirectiveNode *directive, std::map<st
 		throw (std::runtime_error("Invalid number of arguments in \"" + directive->getKey() + "\" directive"));
 	else if (it->second.first == OneOrTwoArgs && (directive->getValueCount() < 1 || directive->getValueCount() > 2))
 		throw (std::runtime_error("Invalid number of arguments in \"" + directive->getKey() + "\" directive"));
+	else if (it->second.first == TwoOrThreeArgs && (directive->getValueCount() < 2 || directive->getValueCount() > 3))
+		throw (std::runtime_error("Invalid number of arguments in \"" + directive->getKey() + "\" directive"));
 }
 
 void	LogicValidator::validateDirectiveParent(const std::string &key, const std::string &parentName)
@@ -66,11 +82,21 @@ void	LogicValidator::validateDirectiveParent(const std::string &key, const std::
 			if (parentName == "http")
 				throw (std::runtime_error("\"return\" directive is not allowed in this context"));
 		}
+		else if (key == "rewrite")
+		{
+			if (parentName == "http")
+				throw (std::runtime_error("\"rewrite\" directive is not allowed in this context"));
+		}
 		else if (key == "limit_except")
 		{
 			if (parentName != "location")
 				throw (std::runtime_error("\"limit_except\" directive is not allowed in this context"));
 		}
+		else if (key == "upload_store")
+		{
+			if (parentName != "location")
+				throw (std::runtime_error("\"upload_store\" directive is not allowed in this context"));
+		}
 		else if (key == "keepalive_timeout")
 		{
 			if (parentName == "location")
@@ -81,6 +107,21 @@ void	LogicValidator::validateDirectiveParent(const std::string &key, const std::
 			if (parentName != "server")
 				throw (std::runtime_error("\"cgi_extension\" directive is not allowed in this context"));
 		}
+		else if (key == "types")
+		{
+			if (parentName != "http")
+				throw (std::runtime_error("\"types\" directive is not allowed in this context"));
+		}
+		else if (key == "shutdown_timeout")
+		{
+			if (parentName != "http")
+				throw (std::runtime_error("\"shutdown_timeout\" directive is not allowed in this context"));
+		}
+		else if (key == "fastcgi_pass")
+		{
+			if (parentName != "location")
+				throw (std::runtime_error("\"fastcgi_pass\" directive is not allowed in this context"));
+		}
 }
 
 void	 LogicValidator::validateDirectiveDuplicates(ConfigNode *node)
@@ -89,16 +130,19 @@ void	 LogicValidator::validateDirectiveDuplicates(ConfigNode *node)
 		return;
 	ContextNode *parent = static_cast<ContextNode *>(node);
 	const std::vector<ConfigNode *>	&children = parent->getChildren();
+	std::set<std::string>			uniqueKeys; // directives seen in this context, a single pass over the children
 	for (size_t i = 0; i < children.size(); i++)
 	{
 		if (children[i]->getType() == Directive)
 		{
 			DirectiveNode *directiveNode = static_cast<DirectiveNode *>(children[i]);
 			const std::string	&key = directiveNode->getKey();
-			if (key == "root" || key == "client_max_body_size"
+			if (key == "root" || key == "client_max_body_size" || key == "client_body_buffer_size"
+			|| key == "create_full_put_path"
 			|| key == "try_files" || key == "autoindex"
-			|| key == "limit_except" || key == "keepalive_timeout")
-				if (parent->getCountOf(key) > 1)
+			|| key == "limit_except" || key == "keepalive_timeout" || key == "upload_store"
+			|| key == "types" || key == "shutdown_timeout" || key == "fastcgi_pass")
+				if (!uniqueKeys.insert(key).second)
 					throw (std::runtime_error("\"" + key + "\"" + " directive is duplicated"));
 		}
 		validateDirectiveDuplicates(children[i]);
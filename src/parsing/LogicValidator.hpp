@@ -23,7 +23,8 @@ enum numArgs
     TwoArgs,
 	OneOrMoreArgs,
 	TwoOrMoreArgs,
-	OneOrTwoArgs
+	OneOrTwoArgs,
+	TwoOrThreeArgs
 };
 
 
@@ -56,16 +56,25 @@ void	SyntaxValidator::validateRequiredContexts(const std::vector<std::string> &t
         }
 		if (tokens[i] == "location")
 		{
-			if ((i + 1) < tokens.size() && tokens[i + 1] == "}")
+			size_t	pathIndex = i + 1;
+			if (pathIndex < tokens.size() && isLocationModifier(tokens[pathIndex]))
+				pathIndex++;
+			if (pathIndex < tokens.size() && tokens[pathIndex] == "}")
 				throw (SyntaxError(UNEXPECTED_CLOSING_BRACE));
-			if ((i + 1) < tokens.size() && tokens[i + 1] == "{")
+			if (pathIndex < tokens.size() && tokens[pathIndex] == "{")
 				throw (SyntaxError(LOCATION_CONTEXT_ERROR));
-			if ((i + 2) < tokens.size() && tokens[i + 2] != "{")
+			if ((pathIndex + 1) < tokens.size() && tokens[pathIndex + 1] != "{")
 				throw (SyntaxError(LOCATION_CONTEXT_ERROR));
 		}
     }
 }
 
+// "location = /path", "location ~ regex" and "location ~* regex"
+bool	SyntaxValidator::isLocationModifier(const std::string &token)
+{
+	return (token == "=" || token == "~" || token == "~*");
+}
+
 void	SyntaxValidator::validateContexts(const std::vector<std::string> &tokens)
 {
 	std::stack<std::string> contextStack;
@@ -124,7 +133,11 @@ void	SyntaxValidator::validateDirectives(const std::vector<std::string> &tokens)
 		if (contextKeywords.find(tokens[i]) != contextKeywords.end())
 		{
 			if (tokens[i] == "location")
+			{
 				i++;
+				if (i < tokens.size() && isLocationModifier(tokens[i]))
+					i++;
+			}
 			continue;
 		}
 		if (tokens[i] == ";")
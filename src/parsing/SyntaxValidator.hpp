@@ -49,6 +49,7 @@ class SyntaxValidator
 
     public:
         static void	validate(const std::vector<std::string> &tokens);
+        static bool	isLocationModifier(const std::string &token);
 
 };
 
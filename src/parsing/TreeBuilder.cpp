@@ -19,8 +19,13 @@ ConfigNode	*TreeBuilder::getContextNode(ConfigNode *parent, std::vector<std::str
 
 ConfigNode	*TreeBuilder::getLocationNode(ConfigNode *parent, std::vector<std::string>::iterator &it)
 {
-	ConfigNode	*node = new ContextNode(*it, parent, *(it + 1));
-	it += 3;
+	std::string	path = *(it + 1);
+
+	// the modifier becomes part of the path: "=/exact", "~ regex", "~* regex"
+	if (SyntaxValidator::isLocationModifier(path))
+		path += (path == "=" ? "" : " ") + *(it + 2);
+	ConfigNode	*node = new ContextNode(*it, parent, path);
+	it += (path == *(it + 1)) ? 3 : 4;
 	return (node);
 }
 
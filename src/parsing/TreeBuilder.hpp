@@ -6,6 +6,7 @@
 
 #include "DirectiveNode.hpp"
 #include "ContextNode.hpp"
+#include "SyntaxValidator.hpp"
 
 
 class TreeBuilder
@@ -1,36 +1,35 @@
 #include "ClientState.hpp"
+#include "Clock.hpp"
 
-ClientState::ClientState(int fd, const std::string &clientIpAddr)
-	: fd(fd), clientIpAddr(clientIpAddr), requestCount(0), areHeaderComplete(false), isBodyComplete(false)
+ClientState::ClientState(int fd, const std::string &clientIpAddr, const std::shared_ptr<ConfigGeneration> &generation, VirtualHosts &virtualHosts)
+	: fd(fd), clientIpAddr(clientIpAddr), generation(generation), virtualHosts(&virtualHosts),
+	serverConfig(&virtualHosts.getDefault()), location(NULL), requestCount(0), requestBodySize(0), receivedBodySize(0),
+	areHeaderComplete(false), isBodyComplete(false), isChunked(false), isMultipart(false)
 {
-	this->lastRequestTime = std::chrono::steady_clock::now();
+	this->lastRequestTime = Clock::now();
 }
 
-ClientState::~ClientState()
-{
-	if (requestBodyFile.is_open())
-		requestBodyFile.close();
-}
+ClientState::~ClientState() { }
 
 void	ClientState::resetClientState()
 {
 	requestHeaders.clear();
 	requestBody.clear();
-	if (requestBodyFile.is_open())
-		requestBodyFile.close();
-	if (requestBodyFilePath.size() > 0)
-	{
-		remove(requestBodyFilePath.c_str());
-	}
+	bodyStorage.clear();
 	requestBodySize = 0;
-	requestBodyFilePath.clear();
+	receivedBodySize = 0;
 	areHeaderComplete = false;
 	isBodyComplete = false;
+	isChunked = false;
+	isMultipart = false;
+	decodedChunk.clear();
+	multipartParser.clear();
+	putTargetPath.clear();
 }
 
 void	ClientState::updateLastRequestTime()
 {
-	lastRequestTime = std::chrono::steady_clock::now();
+	lastRequestTime = Clock::now();
 }
 
 void	ClientState::incrementRequestCount()
@@ -71,6 +70,8 @@ void	ClientState::parseHeaders(Server &server)
 	requestHeaders.resize(endOfHeaders);
 
 	this->request = HttpRequest(requestHeaders);
+	this->request.setRemoteAddr(clientIpAddr);
+	this->serverConfig = &virtualHosts->find(request.getHeader("Host"));
 
 	if (request.getUri().size() > MAX_URI_SIZE)
 	{
@@ -78,6 +79,10 @@ void	ClientState::parseHeaders(Server &server)
 		return;
 	}
 
+	if (request.getStatus() == 200 && serverConfig->hasRewrites() && !applyRewrites(server))
+		return;
+	this->location = serverConfig->matchLocation(request.getUri());
+
 	if (request.getMethod() == "GET")
 	{
 		
@@ -103,6 +108,14 @@ void	ClientState::parseHeaders(Server &server)
 		Logger::log(Logger::INFO, logStream.str(), "ClientState::parseHeaders");
 		handlePostRequest(server);
 	}
+	else if (request.getMethod() == "PUT")
+	{
+		std::ostringstream logStream;
+		logStream << "Received a 'PUT' request for '" << request.getUri() << "' from IP '"
+				<< clientIpAddr << "', processing on socket descriptor " << fd;
+		Logger::log(Logger::INFO, logStream.str(), "ClientState::parseHeaders");
+		handlePutRequest(server);
+	}
 	else if (request.getMethod() == "DELETE")
 	{
 		std::ostringstream logStream;
@@ -118,11 +131,50 @@ void	ClientState::parseHeaders(Server &server)
 	}
 }
 
+/*
+	Runs the rewrite rules on the request URI before it is dispatched.
+	Returns false when the request was already answered (redirect or
+	rewrite cycle), the client must not be used afterwards.
+*/
+bool	ClientState::applyRewrites(Server &server)
+{
+	const std::vector<std::string>	&queries = request.getQueries();
+	std::string						uri = request.getUri();
+	std::string						query;
+	int								redirectCode = 0;
+
+	for (size_t i = 0; i < queries.size(); i++)
+		query += (i > 0 ? "&" : "") + queries[i];
+
+	RewriteStatus status = serverConfig->rewriteUri(uri, query, redirectCode);
+	if (status == REWRITE_REDIRECTED)
+	{
+		if (!uri.empty() && uri[0] == '/')
+			uri = "http://" + request.getHeader("Host") + uri;
+		Logger::log(Logger::INFO, "Request for '" + request.getUri() + "' redirected to '" + uri + "' on socket descriptor " + std::to_string(fd), "ClientState::applyRewrites");
+		server.processRedirect(fd, request, redirectCode, uri);
+		return (false);
+	}
+	if (status == REWRITE_CYCLE)
+	{
+		Logger::log(Logger::ERROR, "Rewrite cycle while processing '" + request.getUri() + "'", "ClientState::applyRewrites");
+		server.handleInvalidRequest(fd, 500, "Rewrite or internal redirection cycle.");
+		return (false);
+	}
+	if (status == REWRITE_CHANGED)
+	{
+		Logger::log(Logger::DEBUG, "Request URI '" + request.getUri() + "' rewritten to '" + uri + "'", "ClientState::applyRewrites");
+		request.setUri(uri);
+		request.setQueryString(query);
+	}
+	return (true);
+}
+
 void	ClientState::handleGetRequest(Server &server)
 {
 
 	// Log the situation where a GET request contains a body, which is unusual
-	if (!requestBody.empty() || !request.getHeader("Content-Length").empty() || request.getHeader("Transfer-Encoding") == "chunked")
+	if (!requestBody.empty() || !request.getHeader("Content-Length").empty() || !request.getHeader("Transfer-Encoding").empty())
 		server.handleInvalidGetRequest(fd);
 	else
 	{
@@ -140,87 +192,433 @@ void	ClientState::handlePostRequest(Server &server)
 		server.handleInvalidRequest(fd, request.getStatus());
 		return;
 	}
-	if (request.getHeader("Transfer-Encoding") == "chunked")
+
+	size_t maxBodySize = getRequestConfig().clientMaxBodySize;
+	isChunked = request.isChunked();
+	if (!isChunked)
 	{
-		Logger::log(Logger::WARN, "Chunked Transfer-Encoding not supported for client with socket fd " + std::to_string(fd), "ClientState::handlePostRequest");
-		server.handleInvalidRequest(fd, 405, "Chunked Transfer-Encoding Not Supported for Client Requests");
-		return;
+		bool validLength = true;
+		try
+		{
+			requestBodySize = std::stoull(request.getHeader("Content-Length"));
+		}
+		catch (const std::exception &e)
+		{
+			validLength = false;
+		}
+		if (!validLength || requestBodySize > maxBodySize)
+		{
+			Logger::log(Logger::WARN, "Body size of POST request exceeds client max body size for client with socket fd " + std::to_string(fd), "ClientState::handlePostRequest");
+			server.handleInvalidRequest(fd, 413);
+			return;
+		}
 	}
 
-	requestBodySize = std::stoull(request.getHeader("Content-Length"));
-	if (requestBodySize > server._config.clientMaxBodySize)
-	{
-		Logger::log(Logger::WARN, "Body size of POST request exceeds client max body size for client with socket fd " + std::to_string(fd), "ClientState::handlePostRequest");
-		server.handleInvalidRequest(fd, 413);
+	if (!handleExpectation(server))
 		return;
+
+	if (isChunked)
+	{
+		Logger::log(Logger::DEBUG, "Receiving chunked POST body for client with socket fd " + std::to_string(fd), "ClientState::handlePostRequest");
+		requestBodySize = 0;
+		chunkedDecoder.reset(maxBodySize);
 	}
 	initializeBodyStorage(server);
 }
 
-void	ClientState::initializeBodyStorage(Server &server)
+/*
+	A PUT body is received like a POST body, the target is checked before
+	any of it is read so a refused request does not cost the transfer.
+*/
+void	ClientState::handlePutRequest(Server &server)
+{
+	if (request.getStatus() == 200 && !preparePutTarget(server))
+		return;
+	handlePostRequest(server);
+}
+
+bool	ClientState::preparePutTarget(Server &server)
+{
+	BaseConfig		&config = getRequestConfig();
+	struct stat		pathStat;
+
+	// PUT is only accepted where a location lists it in limit_except
+	if (!location || !location->isMethodAllowed(request.getMethod()))
+	{
+		Logger::log(Logger::WARN, "PUT is not allowed for client with socket fd " + std::to_string(fd), "ClientState::preparePutTarget");
+		server.handleInvalidRequest(fd, 405);
+		return (false);
+	}
+
+	std::string path = config.root + request.getUri();
+	if (path[path.size() - 1] == '/' || (stat(path.c_str(), &pathStat) == 0 && S_ISDIR(pathStat.st_mode)))
+	{
+		Logger::log(Logger::WARN, "PUT target \"" + path + "\" is a directory for client with socket fd " + std::to_string(fd), "ClientState::preparePutTarget");
+		server.handleInvalidRequest(fd, 409, "Cannot PUT To A Directory");
+		return (false);
+	}
+
+	std::string directory = path.substr(0, path.find_last_of('/'));
+	if (directory.empty())
+		directory = "/";
+	if (stat(directory.c_str(), &pathStat) < 0 || !S_ISDIR(pathStat.st_mode))
+	{
+		if (config.createFullPutPath != "on")
+		{
+			Logger::log(Logger::WARN, "Directory of PUT target \"" + path + "\" does not exist for client with socket fd " + std::to_string(fd), "ClientState::preparePutTarget");
+			server.handleInvalidRequest(fd, 409, "Parent Directory Does Not Exist");
+			return (false);
+		}
+		if (!RequestBodyStorage::createDirectories(directory))
+		{
+			Logger::log(Logger::ERROR, "Failed to create directory \"" + directory + "\": " + std::string(strerror(errno)), "ClientState::preparePutTarget");
+			server.handleInvalidRequest(fd, 500, "Internal Server Error: Failed To Create Directory");
+			return (false);
+		}
+	}
+	putTargetPath = path;
+	return (true);
+}
+
+bool	ClientState::handleExpectation(Server &server)
 {
-	std::string filename = "post_body_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + "_" + std::to_string(fd) + ".tmp";
-	requestBodyFilePath = TEMP_FILE_DIRECTORY + filename;
+	std::string expectation = request.getHeader("Expect");
+	if (expectation.empty())
+		return (true);
 
-	
+	std::transform(expectation.begin(), expectation.end(), expectation.begin(), ::tolower);
+	if (expectation != "100-continue")
+	{
+		Logger::log(Logger::WARN, "Unsupported expectation \"" + expectation + "\" for client with socket fd " + std::to_string(fd), "ClientState::handleExpectation");
+		server.handleInvalidRequest(fd, 417);
+		return (false);
+	}
+	// HTTP/1.0 clients do not understand interim responses
+	if (request.getVersion() == "HTTP/1.0")
+		return (true);
 
-	requestBodyFile.open(requestBodyFilePath.c_str(), std::ios::out | std::ios::binary);
-	if (!requestBodyFile.is_open())
+	// everything that would make us throw the body away is decided before the client sends it
+	if (location && !location->isMethodAllowed(request.getMethod()))
 	{
-		Logger::log(Logger::ERROR, "Failed to open temporary file for storing POST body for client with socket fd " + std::to_string(fd), "ClientState::initializeBodyStorage");
+		Logger::log(Logger::WARN, "Rejecting expected POST body, method not allowed for client with socket fd " + std::to_string(fd), "ClientState::handleExpectation");
+		server.handleInvalidRequest(fd, 405);
+		return (false);
+	}
+	if (isCgiRequest() && server.isCgiCapacityExceeded())
+	{
+		Logger::log(Logger::WARN, "Rejecting expected POST body, too many CGI requests for client with socket fd " + std::to_string(fd), "ClientState::handleExpectation");
+		server.handleInvalidRequest(fd, 503, "Server is busy and cannot handle the request at the moment. Please try again later.");
+		return (false);
+	}
+
+	// the client did not wait for us, the body is already on its way
+	if (!requestBody.empty())
+		return (true);
+
+	// the client is gone when the interim response could not be sent whole
+	return (server.sendContinueResponse(fd));
+}
+
+bool	ClientState::isCgiRequest()
+{
+	return (request.getMethod() != "PUT" && serverConfig->cgiExtension.isEnabled()
+		&& CgiHandler::validCgiRequest(request, *serverConfig));
+}
+
+bool	ClientState::hasUploadStore() const
+{
+	return (location && location->hasUploadStore());
+}
+
+bool	ClientState::isFastCgiRequest() const
+{
+	return (location && location->pipeline.getHandler(request.getMethod()) == HANDLER_FASTCGI);
+}
+
+LocationConfig	*ClientState::getLocation() const
+{
+	return (this->location);
+}
+
+HttpRequest	&ClientState::getRequest()
+{
+	return (this->request);
+}
+
+/*
+	Turns the request into a GET of "uri", whose arguments replace the
+	current ones, in the location of that URI. False once the request was
+	redirected too many times.
+*/
+bool	ClientState::redirectRequest(const std::string &uri)
+{
+	size_t	queryStart = uri.find('?');
+
+	if (request.getRecursionDepth() >= MAX_RECURSION_DEPTH)
+		return (false);
+	request.incrementRecursionDepth();
+	request.setMethod("GET");
+	request.removeHeader("Content-Length");
+	request.removeHeader("Content-Type");
+	request.removeHeader("Transfer-Encoding");
+	request.setQueryString(queryStart == std::string::npos ? "" : uri.substr(queryStart + 1));
+	request.setUri(uri.substr(0, queryStart));
+	updateLocation();
+	return (true);
+}
+
+// the location of the current URI, once an internal redirect changed it
+void	ClientState::updateLocation()
+{
+	this->location = serverConfig->matchLocation(request.getUri());
+}
+
+BaseConfig	&ClientState::getRequestConfig()
+{
+	if (location)
+		return (*location);
+	return (*serverConfig);
+}
+
+void	ClientState::initializeBodyStorage(Server &server)
+{
+	bool			opened;
+
+	receivedBodySize = 0;
+	// a FastCGI server receives the body as it was sent, upload_store does not apply
+	isMultipart = putTargetPath.empty() && !isFastCgiRequest() && MultipartParser::isMultipart(request.getHeader("Content-Type"))
+		&& ((location && location->hasUploadStore()) || isCgiRequest());
+	if (putTargetPath.empty() && location && location->hasUploadStore() && (isMultipart || !isCgiRequest()) && !isFastCgiRequest())
+	{
+		// nothing is written to the upload store for a request that is refused anyway
+		if (!location->isMethodAllowed(request.getMethod()))
+		{
+			Logger::log(Logger::WARN, "Upload refused, method not allowed for client with socket fd " + std::to_string(fd), "ClientState::initializeBodyStorage");
+			server.handleInvalidRequest(fd, 405);
+			return;
+		}
+	}
+	if (!putTargetPath.empty()) // written next to the target and renamed over it once complete
+		opened = bodyStorage.openTarget(putTargetPath.substr(0, putTargetPath.find_last_of('/')),
+			isChunked ? 0 : requestBodySize, putTargetPath);
+	else if (isMultipart)
+	{
+		// file parts go to the upload store as they arrive, the body itself is not kept
+		if (!multipartParser.open(request.getHeader("Content-Type"), hasUploadStore() ? location->getUploadStore() : ""))
+		{
+			Logger::log(Logger::WARN, "Missing or invalid multipart boundary for client with socket fd " + std::to_string(fd), "ClientState::initializeBodyStorage");
+			server.handleInvalidRequest(fd, 400, "Invalid Multipart Boundary");
+			return;
+		}
+		opened = true;
+		// without a store, a CGI script gets the body as it was sent once a file part shows up
+		if (!hasUploadStore())
+			opened = bodyStorage.open(getRequestConfig().clientBodyBufferSize, isChunked ? 0 : requestBodySize);
+	}
+	else if (location && location->hasUploadStore() && !isCgiRequest() && !isFastCgiRequest())
+		opened = bodyStorage.openTarget(location->getUploadStore(), isChunked ? 0 : requestBodySize);
+	else // a chunked body has no announced size, it starts in memory and spills once it outgrows the buffer
+		opened = bodyStorage.open(getRequestConfig().clientBodyBufferSize, isChunked ? 0 : requestBodySize);
+	if (!opened)
+	{
+		Logger::log(Logger::ERROR, "Failed to create storage for POST body for client with socket fd " + std::to_string(fd), "ClientState::initializeBodyStorage");
 		server.handleInvalidRequest(fd, 500, "Internal Server Error: Temporary File Creation Failed");
 		return;
 	}
 
-	Logger::log(Logger::DEBUG, "Temporary file for POST body created: " + requestBodyFilePath, "ClientState::initializeBodyStorage");
-	
+	if (bodyStorage.isInMemory())
+		Logger::log(Logger::DEBUG, "POST body is buffered in memory for client with socket fd " + std::to_string(fd), "ClientState::initializeBodyStorage");
+
+	if (isChunked)
+	{
+		processChunkedBody(server, requestBody.data(), requestBody.size());
+		return;
+	}
+
 	if (requestBody.size() == requestBodySize)
 	{
 		Logger::log(Logger::DEBUG, "POST request body is complete from the first read for client with socket fd " + std::to_string(fd), "ClientState::initializeBodyStorage");
-		requestBodyFile << requestBody;
-		requestBodyFile.close();
-		isBodyComplete = true;
-		server.processPostRequest(fd, request);
+		if (!storeBody(server, requestBody.data(), requestBody.size()) || !finishBody(server))
+			return;
+		processCompleteBody(server);
 	}
 	else if (requestBody.size() > requestBodySize)
 	{
 		Logger::log(Logger::WARN, "POST request body exceeds the declared content length for client with socket fd " + std::to_string(fd), "ClientState::initializeBodyStorage");
-		requestBodyFile.close();
 		server.handleInvalidRequest(fd, 400, "Request Body Exceeds Content-Length");
 	}
 	else
 	{
 		Logger::log(Logger::DEBUG, "POST request body is incomplete from the first read for client with socket fd " + std::to_string(fd), "ClientState::initializeBodyStorage");
-		requestBodyFile << requestBody;
+		storeBody(server, requestBody.data(), requestBody.size());
+	}
+}
+
+bool	ClientState::storeBody(Server &server, const char *data, size_t length)
+{
+	bool	stored = true;
+
+	receivedBodySize += length;
+	if (isMultipart)
+	{
+		MultipartStatus status = multipartParser.parse(data, length);
+		if (status == MULTIPART_ERROR)
+		{
+			Logger::log(Logger::WARN, "Malformed multipart POST body for client with socket fd " + std::to_string(fd), "ClientState::storeBody");
+			server.handleInvalidRequest(fd, 400, "Malformed Multipart Request Body");
+			return (false);
+		}
+		if (status == MULTIPART_FILE_WITHOUT_STORE)
+		{
+			Logger::log(Logger::DEBUG, "Multipart body with a file part is passed as is for client with socket fd " + std::to_string(fd), "ClientState::storeBody");
+			multipartParser.clear();
+			isMultipart = false;
+		}
+		stored = (status != MULTIPART_WRITE_ERROR);
+	}
+	// the parts of a multipart body went to the upload store, anything else is kept as sent
+	if (stored && (!isMultipart || !hasUploadStore()))
+		stored = bodyStorage.append(data, length);
+	if (stored)
+		return (true);
+	Logger::log(Logger::ERROR, "Failed to store POST body for client with socket fd " + std::to_string(fd), "ClientState::storeBody");
+	server.handleInvalidRequest(fd, 500, "Internal Server Error: Failed To Store Request Body");
+	return (false);
+}
+
+/*
+	Called once the whole body is received. The fields and stored files of a
+	multipart body are handed to the request, the body itself is consumed.
+*/
+bool	ClientState::finishBody(Server &server)
+{
+	isBodyComplete = true;
+	if (!isMultipart)
+		return (true);
+	if (multipartParser.getStatus() != MULTIPART_COMPLETE)
+	{
+		Logger::log(Logger::WARN, "Incomplete multipart POST body for client with socket fd " + std::to_string(fd), "ClientState::finishBody");
+		server.handleInvalidRequest(fd, 400, "Incomplete Multipart Request Body");
+		return (false);
+	}
+	multipartParser.commit();
+
+	const std::vector<std::pair<std::string, std::string> >	&fields = multipartParser.getFields();
+	for (size_t i = 0; i < fields.size(); i++)
+		request.addFormField(fields[i].first, fields[i].second);
+	const std::vector<MultipartFile>	&files = multipartParser.getFiles();
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		request.addFormField(files[i].name, files[i].path);
+		request.addFormField(files[i].name + "_FILENAME", files[i].fileName);
+	}
+	// the copy kept in case a file part had no upload store to go to
+	bodyStorage.clear();
+	request.setHeader("Content-Length", "0");
+	return (true);
+}
+
+void	ClientState::spliceBody(Server &server)
+{
+	ssize_t bytesMoved = bodyStorage.spliceFrom(fd, requestBodySize - receivedBodySize);
+	if (bytesMoved < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return;
+		Logger::log(Logger::ERROR, "Failed to splice POST body for client with socket fd " + std::to_string(fd) + ": " + std::string(strerror(errno)), "ClientState::spliceBody");
+		server.handleInvalidRequest(fd, 500, "Internal Server Error: Failed To Store Request Body");
 	}
+	else if (bytesMoved == 0)
+		server.handleClientDisconnection(fd);
+	else
+	{
+		receivedBodySize += bytesMoved;
+		if (receivedBodySize < requestBodySize)
+			return;
+		Logger::log(Logger::DEBUG, "POST request body is complete for client with socket fd " + std::to_string(fd), "ClientState::spliceBody");
+		if (!finishBody(server))
+			return;
+		processCompleteBody(server);
+	}
+}
+
+void	ClientState::processCompleteBody(Server &server, bool closeConnection)
+{
+	if (request.getMethod() == "PUT")
+		server.processPutRequest(fd, request, closeConnection);
+	else
+		server.processPostRequest(fd, request, closeConnection);
 }
 
 void	ClientState::processBody(Server &server, const char *buffer, size_t bytesRead)
 {
 	Logger::log(Logger::DEBUG, "Processing body of POST request for client with socket fd " + std::to_string(fd), "ClientState::processBody");
 
-	size_t remainingBodySize = requestBodySize - requestBodyFile.tellp();
+	if (isChunked)
+	{
+		processChunkedBody(server, buffer, bytesRead);
+		return;
+	}
+
+	size_t remainingBodySize = requestBodySize - receivedBodySize;
 	if (bytesRead > remainingBodySize)
 	{
 		Logger::log(Logger::WARN, "POST request body exceeds declared content length for client with socket fd " + std::to_string(fd), "ClientState::processBody");
-		requestBodyFile.write(buffer, remainingBodySize);
-		requestBodyFile.close();
-		isBodyComplete = true;
-		server.processPostRequest(fd, request, true);
+		if (!storeBody(server, buffer, remainingBodySize) || !finishBody(server))
+			return;
+		processCompleteBody(server, true);
 		server.removeClient(fd);
 	}
 	else if (bytesRead == remainingBodySize)
 	{
 		 Logger::log(Logger::DEBUG, "POST request body is complete for client with socket fd " + std::to_string(fd), "ClientState::processBody");
-		requestBodyFile.write(buffer, bytesRead);
-		requestBodyFile.close();
-		isBodyComplete = true;
-		server.processPostRequest(fd, request);
+		if (!storeBody(server, buffer, bytesRead) || !finishBody(server))
+			return;
+		processCompleteBody(server);
 	}
 	else
 	{
 		Logger::log(Logger::DEBUG, "Appending to POST request body for client with socket fd " + std::to_string(fd), "ClientState::processBody");
-		requestBodyFile.write(buffer, bytesRead);
+		storeBody(server, buffer, bytesRead);
+	}
+}
+
+void	ClientState::processChunkedBody(Server &server, const char *buffer, size_t bytesRead)
+{
+	size_t			consumed;
+
+	decodedChunk.clear();
+	ChunkedStatus status = chunkedDecoder.decode(buffer, bytesRead, decodedChunk, consumed);
+	if (!decodedChunk.empty() && !storeBody(server, decodedChunk.data(), decodedChunk.size()))
+		return;
+
+	if (status == CHUNKED_ERROR)
+	{
+		Logger::log(Logger::WARN, "Malformed chunked POST body for client with socket fd " + std::to_string(fd), "ClientState::processChunkedBody");
+		server.handleInvalidRequest(fd, 400, "Malformed Chunked Request Body");
+	}
+	else if (status == CHUNKED_TOO_LARGE)
+	{
+		Logger::log(Logger::WARN, "Chunked POST body exceeds client max body size for client with socket fd " + std::to_string(fd), "ClientState::processChunkedBody");
+		server.handleInvalidRequest(fd, 413);
+	}
+	else if (status == CHUNKED_COMPLETE)
+	{
+		Logger::log(Logger::DEBUG, "Chunked POST body is complete for client with socket fd " + std::to_string(fd), "ClientState::processChunkedBody");
+		requestBodySize = chunkedDecoder.getDecodedSize();
+		// from here on the body is a plain sized entity (CGI gets a CONTENT_LENGTH)
+		request.removeHeader("Transfer-Encoding");
+		request.setHeader("Content-Length", std::to_string(requestBodySize));
+		if (!finishBody(server))
+			return;
+		if (consumed < bytesRead)
+		{
+			Logger::log(Logger::WARN, "Unexpected data after the last chunk for client with socket fd " + std::to_string(fd), "ClientState::processChunkedBody");
+			processCompleteBody(server, true);
+			server.removeClient(fd);
+		}
+		else
+			processCompleteBody(server);
 	}
 }
 
@@ -234,19 +632,80 @@ const std::string &ClientState::getClientIpAddr() const
 	return clientIpAddr;
 }
 
+ServerConfig	&ClientState::getServerConfig() const
+{
+	return (*serverConfig);
+}
+
+MimeTypeConfig	&ClientState::getMimeTypes() const
+{
+	return (generation->getMimeTypes());
+}
+
 int		ClientState::getRequestCount() const
 {
 	return requestCount;
 }
 
-const std::string			&ClientState::getPostRequestFileName()
+int		ClientState::openRequestBodyReader()
+{
+	return (bodyStorage.openReader());
+}
+
+/*
+	Sized bodies going to a file are moved from the socket with splice(2)
+	once the part received along with the headers is stored. A multipart
+	body has to pass through the parser.
+*/
+bool	ClientState::canSpliceBody() const
+{
+#ifdef __linux__
+	return (areHeaderComplete && !isBodyComplete && !isChunked && !isMultipart && !bodyStorage.isInMemory()
+		&& receivedBodySize < requestBodySize);
+#else
+	return (false);
+#endif
+}
+
+const std::string	&ClientState::getPutTargetPath() const
+{
+	return (putTargetPath);
+}
+
+bool	ClientState::isUploadRequest() const
 {
-	return (requestBodyFilePath);
+	return (bodyStorage.isTarget() || (isMultipart && !multipartParser.getFiles().empty()));
+}
+
+/*
+	Returns the paths of the files stored by this request, they are kept
+	when the client state is reset.
+*/
+std::vector<std::string>	ClientState::commitUploads()
+{
+	std::vector<std::string>	paths;
+
+	if (bodyStorage.isTarget())
+	{
+		std::string path = bodyStorage.commitTarget();
+		if (!path.empty())
+			paths.push_back(path);
+	}
+	multipartParser.commit();
+	const std::vector<MultipartFile>	&files = multipartParser.getFiles();
+	for (size_t i = 0; i < files.size(); i++)
+		paths.push_back(files[i].path);
+	return (paths);
 }
 
 bool	ClientState::isTimedOut(size_t keepalive_timeout) const
 {
 	std::chrono::seconds timeoutDuration(keepalive_timeout);
-	std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
-	return (std::chrono::duration_cast<std::chrono::seconds>(now - lastRequestTime) > timeoutDuration);
+	return (std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - lastRequestTime) > timeoutDuration);
+}
+
+// no part of a request received since the last response
+bool	ClientState::isIdle() const
+{
+	return (requestHeaders.empty() && !areHeaderComplete);
 }
@@ -6,6 +6,9 @@
 #define CLIENTSTATE_HPP
 
 #include "../server/Server.hpp"
+#include "../http/ChunkedDecoder.hpp"
+#include "RequestBodyStorage.hpp"
+#include "MultipartParser.hpp"
 
 class ClientState
 {
@@ -13,21 +16,31 @@ private:
 
 	int													fd;
 	std::string											clientIpAddr;
+	std::shared_ptr<ConfigGeneration>					generation; // configuration the connection was accepted with
+	VirtualHosts										*virtualHosts; // server blocks of the socket in that generation
+	ServerConfig										*serverConfig; // server block selected by the Host header
+	LocationConfig										*location; // location of the request, after the rewrites
 	int													requestCount;
 	std::chrono::time_point<std::chrono::steady_clock>	lastRequestTime;
 
 	HttpRequest											request;
 	std::string											requestHeaders;
 	std::string											requestBody;
-	std::ofstream										requestBodyFile;
+	RequestBodyStorage									bodyStorage;
 	size_t												requestBodySize;
-	std::string											requestBodyFilePath;
+	size_t												receivedBodySize;
 	bool												areHeaderComplete;
 	bool												isBodyComplete;
+	bool												isChunked;
+	bool												isMultipart;
+	ChunkedDecoder										chunkedDecoder;
+	std::string											decodedChunk;
+	MultipartParser										multipartParser;
+	std::string											putTargetPath;
 	
 public:
 
-	ClientState(int fd, const std::string &clientIpAddr);
+	ClientState(int fd, const std::string &clientIpAddr, const std::shared_ptr<ConfigGeneration> &generation, VirtualHosts &virtualHosts);
 	~ClientState();
 
 	void	resetClientState();
@@ -37,18 +50,42 @@ public:
 	void 	processIncomingData(Server &server, const char *buffer, size_t bytesRead);
 	void	processHeaders(Server &server, const char *buffer, size_t bytesRead);
 	void	processBody(Server &server, const char *buffer, size_t bytesRead);
+	void	processChunkedBody(Server &server, const char *buffer, size_t bytesRead);
 	void	parseHeaders(Server &server);
 	void	initializeBodyStorage(Server &server);
+	bool	storeBody(Server &server, const char *data, size_t length);
+	bool	finishBody(Server &server);
+	void	spliceBody(Server &server);
 
+	bool	applyRewrites(Server &server);
 	void	handleGetRequest(Server &server);
 	void	handleHeadRequest(Server &server);
 	void	handlePostRequest(Server &server);
+	void	handlePutRequest(Server &server);
+	bool	preparePutTarget(Server &server);
+	void	processCompleteBody(Server &server, bool closeConnection = false);
+	bool	handleExpectation(Server &server);
+	bool	isCgiRequest();
+	bool	isFastCgiRequest() const;
+	bool	hasUploadStore() const;
+	BaseConfig	&getRequestConfig();
+	LocationConfig	*getLocation() const;
+	HttpRequest		&getRequest();
+	bool			redirectRequest(const std::string &uri);
+	void			updateLocation();
 
 	int					getFd() const;
 	const std::string	&getClientIpAddr() const;
+	ServerConfig		&getServerConfig() const;
+	MimeTypeConfig		&getMimeTypes() const;
 	int					getRequestCount() const;
-	const std::string			&getPostRequestFileName();
+	int					openRequestBodyReader();
+	bool				canSpliceBody() const;
+	const std::string	&getPutTargetPath() const;
+	bool				isUploadRequest() const;
+	std::vector<std::string>	commitUploads();
 	bool				isTimedOut(size_t keepalive_timeout) const;
+	bool				isIdle() const;
 };
 
 
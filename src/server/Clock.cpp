@@ -0,0 +1,58 @@
+#include "Clock.hpp"
+
+std::chrono::steady_clock::time_point	Clock::monotonicTime;
+time_t									Clock::wallTime = 0;
+std::string								Clock::httpDate;
+std::string								Clock::logTimestamp;
+bool									Clock::isInitialized = false;
+
+void	Clock::update()
+{
+	time_t	currentTime = time(NULL);
+
+	monotonicTime = std::chrono::steady_clock::now();
+	isInitialized = true;
+	if (currentTime == wallTime && !httpDate.empty())
+		return;
+	wallTime = currentTime;
+
+	char		buffer[64];
+	struct tm	timeInfo;
+
+	// IMF-fixdate, RFC 7231 section 7.1.1.1
+	gmtime_r(&wallTime, &timeInfo);
+	httpDate.assign(buffer, strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &timeInfo));
+	localtime_r(&wallTime, &timeInfo);
+	logTimestamp.assign(buffer, strftime(buffer, sizeof(buffer), "%Y/%m/%d %X", &timeInfo));
+}
+
+// used before the event loop starts, e.g. while loading the configuration
+void	Clock::ensureInitialized()
+{
+	if (!isInitialized)
+		update();
+}
+
+std::chrono::steady_clock::time_point	Clock::now()
+{
+	ensureInitialized();
+	return (monotonicTime);
+}
+
+time_t	Clock::getTime()
+{
+	ensureInitialized();
+	return (wallTime);
+}
+
+const std::string	&Clock::getHttpDate()
+{
+	ensureInitialized();
+	return (httpDate);
+}
+
+const std::string	&Clock::getLogTimestamp()
+{
+	ensureInitialized();
+	return (logTimestamp);
+}
@@ -0,0 +1,40 @@
+
+
+
+#pragma once
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <chrono>
+#include <string>
+#include <ctime>
+
+/*
+	Time as seen by the event loop. The clocks are read once per loop
+	iteration by update() and everything else uses the cached values, so
+	handling a request never calls into the clock or the time zone code.
+	The Date header value and the log timestamp are formatted again only
+	when the second changes.
+*/
+class Clock
+{
+private:
+	static std::chrono::steady_clock::time_point	monotonicTime;
+	static time_t									wallTime;
+	static std::string								httpDate;
+	static std::string								logTimestamp;
+	static bool										isInitialized;
+
+	static void		ensureInitialized();
+
+public:
+	static void		update();
+
+	static std::chrono::steady_clock::time_point	now();
+	static time_t									getTime();
+	static const std::string						&getHttpDate();
+	static const std::string						&getLogTimestamp();
+};
+
+
+#endif /* CLOCK_HPP */
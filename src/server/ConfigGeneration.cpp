@@ -0,0 +1,133 @@
+#include "ConfigGeneration.hpp"
+#include "../parsing/ConfigParser.hpp"
+#include "../parsing/ConfigLoader.hpp"
+#include "../parsing/MimeTypeParser.hpp"
+#include "../logging/Logger.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <sys/stat.h>
+
+ConfigGeneration::ConfigGeneration(unsigned long generationNumber) : number(generationNumber), shutdownTimeout(0) { }
+
+ConfigGeneration::~ConfigGeneration() { }
+
+/*
+	The built-in types are always available, a "types" file adds to them and
+	overrides them. Without a "types" directive the default file is optional.
+*/
+void	ConfigGeneration::loadMimeTypes(const std::string &typesFile, MimeTypeConfig &mimeTypeConfig)
+{
+	struct stat	fileStat;
+
+	mimeTypeConfig.addDefaultMimeTypes();
+	if (typesFile.empty() && stat(DEFAULT_MIME_TYPES_FILE, &fileStat) != 0)
+	{
+		Logger::log(Logger::WARN, "MIME types file \"" DEFAULT_MIME_TYPES_FILE "\" not found, using the built-in types", "ConfigGeneration::loadMimeTypes");
+		return;
+	}
+	MimeTypeParser mimeTypeParser(typesFile.empty() ? DEFAULT_MIME_TYPES_FILE : typesFile);
+	mimeTypeParser.parseMimeTypeFile(mimeTypeConfig);
+}
+
+void	ConfigGeneration::setShutdownTimeout(const std::string &shutdownTimeoutValue)
+{
+	size_t		pos = shutdownTimeoutValue.find_first_not_of("0123456789");
+	std::string	unit = (pos == std::string::npos) ? "" : shutdownTimeoutValue.substr(pos);
+
+	// seconds, at most 4 digits so the value cannot overflow
+	if (pos == 0 || (!unit.empty() && unit != "s") || shutdownTimeoutValue.size() - unit.size() > 4)
+		throw std::runtime_error("invalid value in \"shutdown_timeout\" directive: \"" + shutdownTimeoutValue + "\"");
+	this->shutdownTimeout = std::stoul(shutdownTimeoutValue.substr(0, pos));
+	if (this->shutdownTimeout > MAX_SHUTDOWN_TIMEOUT)
+		throw std::runtime_error("invalid value in \"shutdown_timeout\" directive: \"" + shutdownTimeoutValue + "\", it must be at most 3600s");
+}
+
+/*
+	Loads a configuration file or snapshot, throws if it is invalid. With a
+	snapshot file name, the loaded configuration is also written to it.
+*/
+void	ConfigGeneration::load(const std::string &configFile, const std::string &snapshotFile)
+{
+	std::chrono::steady_clock::time_point	loadStart = std::chrono::steady_clock::now();
+	bool									isSnapshot = ConfigSnapshot::isSnapshot(configFile);
+
+	ConfigParser parser(configFile);
+	if (isSnapshot)
+		parser.loadConfigSnapshot(mimeTypes);
+	else
+		parser.parseConfigFile();
+
+	ConfigLoader loader(parser.getConfigTreeRoot());
+	loader.loadServers(servers);
+
+	if (!isSnapshot)
+		loadMimeTypes(loader.types, mimeTypes);
+	setShutdownTimeout(loader.shutdown_timeout);
+
+	compile();
+
+	long long loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStart).count();
+	Logger::log(Logger::INFO, std::string(isSnapshot ? "Configuration snapshot \"" : "Configuration \"") + configFile
+		+ "\" loaded in " + std::to_string(loadTime) + " us", "ConfigGeneration::load");
+
+	if (!snapshotFile.empty())
+	{
+		ConfigSnapshot::write(snapshotFile, parser.getConfigTreeRoot(), mimeTypes);
+		Logger::log(Logger::INFO, "Configuration snapshot written to \"" + snapshotFile + "\"", "ConfigGeneration::load");
+	}
+}
+
+/*
+	Builds what is derived from the server blocks once they have reached
+	their final address, and groups them by listening address.
+*/
+void	ConfigGeneration::compile()
+{
+	for (size_t i = 0; i < servers.size(); i++)
+	{
+		ServerConfig	&config = servers[i];
+
+		config.locationMatcher.compile(config.locations, config.regexLocationPaths);
+		config.responseCache.build(config);
+		config.pipeline.compile(config, NULL);
+		config.cgiEnvironment.compile(config);
+		std::map<std::string, LocationConfig>::iterator it = config.locations.begin();
+		for (; it != config.locations.end(); it++)
+			it->second.pipeline.compile(config, &it->second);
+		listeners[getAddress(config)].add(config);
+	}
+}
+
+unsigned long	ConfigGeneration::getNumber() const
+{
+	return (this->number);
+}
+
+std::vector<ServerConfig>	&ConfigGeneration::getServers()
+{
+	return (this->servers);
+}
+
+MimeTypeConfig	&ConfigGeneration::getMimeTypes()
+{
+	return (this->mimeTypes);
+}
+
+VirtualHosts	*ConfigGeneration::findListener(const std::string &address)
+{
+	std::map<std::string, VirtualHosts>::iterator it = listeners.find(address);
+	if (it == listeners.end())
+		return (NULL);
+	return (&it->second);
+}
+
+size_t	ConfigGeneration::getShutdownTimeout() const
+{
+	return (this->shutdownTimeout);
+}
+
+std::string	ConfigGeneration::getAddress(const ServerConfig &config)
+{
+	return (config.ipAddress + ":" + std::to_string(config.port));
+}
@@ -0,0 +1,58 @@
+
+
+
+#pragma once
+#ifndef CONFIGGENERATION_HPP
+#define CONFIGGENERATION_HPP
+
+#include "VirtualHosts.hpp"
+#include "../config/ServerConfig.hpp"
+#include "../config/MimeTypeConfig.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define MAX_SHUTDOWN_TIMEOUT 3600 // 1 hour
+
+/*
+	One loaded configuration: its server blocks, the MIME types and the
+	virtual hosts of every listening address, with everything derived from
+	them (location matchers, cached responses, request pipelines) built when
+	it is loaded, so requests never build anything. A generation is not
+	modified once loaded. A reload loads a new one, and connections keep the
+	generation they were accepted with until they are closed.
+*/
+class ConfigGeneration
+{
+private:
+	unsigned long						number;
+	std::vector<ServerConfig>			servers;
+	MimeTypeConfig						mimeTypes;
+	std::map<std::string, VirtualHosts>	listeners; // by "ip:port"
+	size_t								shutdownTimeout; // seconds open connections get to finish on a graceful shutdown
+
+	static void		loadMimeTypes(const std::string &typesFile, MimeTypeConfig &mimeTypeConfig);
+	void			setShutdownTimeout(const std::string &shutdownTimeoutValue);
+	void			compile();
+
+	ConfigGeneration(const ConfigGeneration &other);
+	ConfigGeneration	&operator=(const ConfigGeneration &other);
+
+public:
+	ConfigGeneration(unsigned long generationNumber);
+	~ConfigGeneration();
+
+	void						load(const std::string &configFile, const std::string &snapshotFile = "");
+
+	unsigned long				getNumber() const;
+	std::vector<ServerConfig>	&getServers();
+	MimeTypeConfig				&getMimeTypes();
+	size_t						getShutdownTimeout() const;
+	VirtualHosts				*findListener(const std::string &address);
+
+	static std::string			getAddress(const ServerConfig &config);
+};
+
+
+#endif /* CONFIGGENERATION_HPP */
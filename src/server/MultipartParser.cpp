@@ -0,0 +1,393 @@
+#include "MultipartParser.hpp"
+#include "RequestBodyStorage.hpp"
+#include "../logging/Logger.hpp"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+MultipartParser::MultipartParser()
+	: state(PREAMBLE), status(MULTIPART_IN_PROGRESS), isFilePart(false), fileFd(-1), isCommitted(false)
+{
+	std::fill(skipTable, skipTable + 256, 0);
+}
+
+MultipartParser::~MultipartParser()
+{
+	clear();
+}
+
+bool	MultipartParser::isMultipart(const std::string &contentType)
+{
+	std::string	mediaType = contentType.substr(0, contentType.find(';'));
+
+	std::transform(mediaType.begin(), mediaType.end(), mediaType.begin(), ::tolower);
+	mediaType.erase(0, mediaType.find_first_not_of(" \t"));
+	mediaType.erase(mediaType.find_last_not_of(" \t") + 1);
+	return (mediaType == "multipart/form-data");
+}
+
+/*
+	Looks up a "; key=value" parameter of a header value (Content-Type,
+	Content-Disposition), the value may be a quoted string.
+*/
+bool	MultipartParser::getParameter(const std::string &headerValue, const std::string &parameter, std::string &value)
+{
+	size_t	pos = headerValue.find(';');
+
+	while (pos != std::string::npos)
+	{
+		pos = headerValue.find_first_not_of(" \t", pos + 1);
+		if (pos == std::string::npos)
+			return (false);
+		size_t equal = headerValue.find('=', pos);
+		if (equal == std::string::npos)
+			return (false);
+		std::string key = headerValue.substr(pos, equal - pos);
+		key.erase(key.find_last_not_of(" \t") + 1);
+		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+		std::string	currentValue;
+		pos = equal + 1;
+		if (pos < headerValue.size() && headerValue[pos] == '"')
+		{
+			for (pos++; pos < headerValue.size() && headerValue[pos] != '"'; pos++)
+			{
+				if (headerValue[pos] == '\\' && pos + 1 < headerValue.size())
+					pos++;
+				currentValue += headerValue[pos];
+			}
+			pos = headerValue.find(';', pos);
+		}
+		else
+		{
+			size_t end = headerValue.find(';', pos);
+			currentValue = headerValue.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+			currentValue.erase(currentValue.find_last_not_of(" \t") + 1);
+			pos = end;
+		}
+		if (key == parameter)
+		{
+			value = currentValue;
+			return (true);
+		}
+	}
+	return (false);
+}
+
+bool	MultipartParser::open(const std::string &contentType, const std::string &directory)
+{
+	std::string	boundary;
+
+	clear();
+	if (!getParameter(contentType, "boundary", boundary) || boundary.empty()
+		|| boundary.size() > MAX_MULTIPART_BOUNDARY_SIZE)
+		return (false);
+
+	this->delimiter = "\r\n--" + boundary;
+	std::fill(skipTable, skipTable + 256, delimiter.size());
+	for (size_t i = 0; i + 1 < delimiter.size(); i++)
+		skipTable[static_cast<unsigned char>(delimiter[i])] = delimiter.size() - 1 - i;
+
+	// the first boundary is not preceded by a line break, pretend it is
+	this->pending = "\r\n";
+	this->uploadDirectory = directory;
+	return (true);
+}
+
+MultipartStatus	MultipartParser::fail(MultipartStatus failureStatus)
+{
+	this->status = failureStatus;
+	return (failureStatus);
+}
+
+/*
+	Horspool search of the delimiter in the pending bytes.
+*/
+size_t	MultipartParser::findDelimiter() const
+{
+	size_t		delimiterSize = delimiter.size();
+	const char	*data = pending.data();
+	size_t		pos = 0;
+
+	while (pos + delimiterSize <= pending.size())
+	{
+		size_t i = delimiterSize - 1;
+		while (data[pos + i] == delimiter[i])
+		{
+			if (i == 0)
+				return (pos);
+			i--;
+		}
+		pos += skipTable[static_cast<unsigned char>(data[pos + delimiterSize - 1])];
+	}
+	return (std::string::npos);
+}
+
+bool	MultipartParser::parsePartHeaders(const std::string &headers)
+{
+	bool	hasDisposition = false;
+	size_t	lineStart = 0;
+
+	partName.clear();
+	partFileName.clear();
+	isFilePart = false;
+	while (lineStart < headers.size())
+	{
+		size_t lineEnd = headers.find("\r\n", lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = headers.size();
+		std::string line = headers.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 2;
+
+		size_t colon = line.find(':');
+		if (colon == std::string::npos)
+			return (false);
+		std::string name = line.substr(0, colon);
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		if (name != "content-disposition")
+			continue;
+
+		std::string value = line.substr(colon + 1);
+		value.erase(0, value.find_first_not_of(" \t"));
+		std::string dispositionType = value.substr(0, value.find(';'));
+		dispositionType.erase(dispositionType.find_last_not_of(" \t") + 1);
+		std::transform(dispositionType.begin(), dispositionType.end(), dispositionType.begin(), ::tolower);
+		if (dispositionType != "form-data")
+			return (false);
+		getParameter(value, "name", partName);
+		isFilePart = getParameter(value, "filename", partFileName);
+		hasDisposition = true;
+	}
+	return (hasDisposition);
+}
+
+bool	MultipartParser::startPart()
+{
+	fieldValue.clear();
+	// an empty file name is a file input left empty by the browser, its content is dropped
+	if (!isFilePart || partFileName.empty())
+		return (true);
+
+	if (uploadDirectory.empty())
+	{
+		Logger::log(Logger::DEBUG, "Multipart file \"" + partFileName + "\" has no upload store to go to", "MultipartParser::startPart");
+		fail(MULTIPART_FILE_WITHOUT_STORE);
+		return (false);
+	}
+
+	MultipartFile	file;
+	file.name = partName;
+	// some clients send the full client side path
+	file.fileName = partFileName.substr(partFileName.find_last_of("/\\") + 1);
+	file.size = 0;
+	fileFd = RequestBodyStorage::createUploadFile(uploadDirectory, file.path, UPLOAD_TEMP_FILE_PREFIX);
+	if (fileFd < 0)
+	{
+		Logger::log(Logger::ERROR, "Failed to create upload file in \"" + uploadDirectory + "\": " + std::string(strerror(errno)), "MultipartParser::startPart");
+		fail(MULTIPART_WRITE_ERROR);
+		return (false);
+	}
+	Logger::log(Logger::DEBUG, "Multipart file \"" + file.fileName + "\" is stored to \"" + file.path + "\"", "MultipartParser::startPart");
+	files.push_back(file);
+	return (true);
+}
+
+bool	MultipartParser::writePartData(const char *data, size_t length)
+{
+	if (fileFd != -1)
+	{
+		files.back().size += length;
+		while (length > 0)
+		{
+			ssize_t written = write(fileFd, data, length);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written < 0)
+			{
+				Logger::log(Logger::ERROR, "Failed to write multipart file \"" + files.back().path + "\": " + std::string(strerror(errno)), "MultipartParser::writePartData");
+				fail(MULTIPART_WRITE_ERROR);
+				return (false);
+			}
+			data += written;
+			length -= written;
+		}
+	}
+	else if (!isFilePart)
+	{
+		if (fieldValue.size() + length > MAX_MULTIPART_FIELD_SIZE)
+		{
+			Logger::log(Logger::WARN, "Multipart field \"" + partName + "\" is too large", "MultipartParser::writePartData");
+			fail(MULTIPART_ERROR);
+			return (false);
+		}
+		fieldValue.append(data, length);
+	}
+	return (true);
+}
+
+void	MultipartParser::finishPart()
+{
+	if (fileFd != -1)
+	{
+		close(fileFd);
+		fileFd = -1;
+	}
+	else if (!isFilePart)
+		fields.push_back(std::make_pair(partName, fieldValue));
+	fieldValue.clear();
+}
+
+MultipartStatus	MultipartParser::parse(const char *input, size_t length)
+{
+	if (status != MULTIPART_IN_PROGRESS)
+		return (status);
+	pending.append(input, length);
+	while (status == MULTIPART_IN_PROGRESS)
+	{
+		switch (state)
+		{
+			case PREAMBLE:
+			case PART_BODY:
+			{
+				size_t pos = findDelimiter();
+				if (pos == std::string::npos)
+				{
+					// only the bytes that may start a delimiter are kept for the next call
+					if (pending.size() >= delimiter.size())
+					{
+						size_t safeSize = pending.size() - (delimiter.size() - 1);
+						if (state == PART_BODY && !writePartData(pending.data(), safeSize))
+							return (status);
+						pending.erase(0, safeSize);
+					}
+					return (status);
+				}
+				if (state == PART_BODY)
+				{
+					if (!writePartData(pending.data(), pos))
+						return (status);
+					finishPart();
+				}
+				pending.erase(0, pos + delimiter.size());
+				state = BOUNDARY_END;
+				break;
+			}
+			case BOUNDARY_END:
+			{
+				// transport padding after a boundary is ignored
+				size_t pos = pending.find_first_not_of(" \t");
+				pending.erase(0, pos == std::string::npos ? pending.size() : pos);
+				if (pending.size() < 2)
+					return (status);
+				if (pending.compare(0, 2, "--") == 0)
+				{
+					state = EPILOGUE;
+					status = MULTIPART_COMPLETE;
+				}
+				else if (pending.compare(0, 2, "\r\n") == 0)
+					state = PART_HEADERS;
+				else
+					return (fail(MULTIPART_ERROR));
+				pending.erase(0, 2);
+				break;
+			}
+			case PART_HEADERS:
+			{
+				size_t headersSize = 0;
+				if (pending.size() < 2)
+					return (status);
+				if (pending.compare(0, 2, "\r\n") != 0)
+				{
+					size_t pos = pending.find("\r\n\r\n");
+					if (pos == std::string::npos)
+					{
+						if (pending.size() > MAX_MULTIPART_HEADERS_SIZE)
+							return (fail(MULTIPART_ERROR));
+						return (status);
+					}
+					headersSize = pos + 2;
+				}
+				if (headersSize > MAX_MULTIPART_HEADERS_SIZE || !parsePartHeaders(pending.substr(0, headersSize)))
+					return (fail(MULTIPART_ERROR));
+				pending.erase(0, headersSize + 2);
+				if (!startPart())
+					return (status);
+				state = PART_BODY;
+				break;
+			}
+			case EPILOGUE:
+				break;
+		}
+	}
+	// the epilogue is discarded
+	pending.clear();
+	return (status);
+}
+
+/*
+	Keeps the stored files: each one is linked to a new unique name in the
+	upload directory and its temporary name removed, like a single body
+	upload. A file that cannot be named is removed and left out.
+*/
+void	MultipartParser::commit()
+{
+	std::vector<MultipartFile>	published;
+
+	if (isCommitted)
+		return;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		std::string	path;
+		if (RequestBodyStorage::publishUploadFile(files[i].path, path))
+		{
+			published.push_back(files[i]);
+			published.back().path = path;
+			continue;
+		}
+		Logger::log(Logger::ERROR, "Failed to name multipart file \"" + files[i].path + "\": " + std::string(strerror(errno)), "MultipartParser::commit");
+		unlink(files[i].path.c_str());
+	}
+	files.swap(published);
+	this->isCommitted = true;
+}
+
+void	MultipartParser::clear()
+{
+	if (fileFd != -1)
+	{
+		close(fileFd);
+		fileFd = -1;
+	}
+	// files of an upload that was not committed are incomplete, they still have their temporary names
+	if (!isCommitted)
+	{
+		for (size_t i = 0; i < files.size(); i++)
+			unlink(files[i].path.c_str());
+	}
+	files.clear();
+	fields.clear();
+	pending.clear();
+	delimiter.clear();
+	fieldValue.clear();
+	state = PREAMBLE;
+	status = MULTIPART_IN_PROGRESS;
+	isCommitted = false;
+}
+
+MultipartStatus	MultipartParser::getStatus() const
+{
+	return (this->status);
+}
+
+const std::vector<MultipartFile>	&MultipartParser::getFiles() const
+{
+	return (this->files);
+}
+
+const std::vector<std::pair<std::string, std::string> >	&MultipartParser::getFields() const
+{
+	return (this->fields);
+}
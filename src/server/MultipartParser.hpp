@@ -0,0 +1,107 @@
+
+
+
+#pragma once
+#ifndef MULTIPARTPARSER_HPP
+#define MULTIPARTPARSER_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// longest boundary allowed by RFC 2046
+#define MAX_MULTIPART_BOUNDARY_SIZE 70
+
+// headers of a single part (Content-Disposition, Content-Type)
+#define MAX_MULTIPART_HEADERS_SIZE 8192 // 8 KB
+
+// value of a field without a file name, kept in memory
+#define MAX_MULTIPART_FIELD_SIZE 65536 // 64 KB
+
+enum MultipartStatus
+{
+	MULTIPART_IN_PROGRESS,
+	MULTIPART_COMPLETE,
+	MULTIPART_ERROR,
+	MULTIPART_WRITE_ERROR,
+	MULTIPART_FILE_WITHOUT_STORE
+};
+
+struct MultipartFile
+{
+	std::string		name;
+	std::string		fileName;
+	std::string		path;
+	size_t			size;
+};
+
+/*
+	Incremental parser for "multipart/form-data" request bodies. The body can
+	be fed in arbitrary pieces, the boundary is searched with Horspool's
+	algorithm and only the few bytes that could start a boundary are carried
+	over to the next call. Parts with a file name are written directly to their
+	own hidden temporary file in the upload directory, the other parts are kept
+	as fields. commit() gives the files their final names; files that were not
+	committed are removed when the parser is cleared. Opened without an upload
+	directory, the parser stops at the first file part.
+*/
+class MultipartParser
+{
+private:
+	enum State
+	{
+		PREAMBLE,
+		BOUNDARY_END,
+		PART_HEADERS,
+		PART_BODY,
+		EPILOGUE
+	};
+
+	State											state;
+	MultipartStatus									status;
+	std::string										delimiter;
+	size_t											skipTable[256];
+	std::string										pending;
+	std::string										uploadDirectory;
+
+	std::string										partName;
+	std::string										partFileName;
+	bool											isFilePart;
+	std::string										fieldValue;
+	int												fileFd;
+
+	std::vector<MultipartFile>						files;
+	std::vector<std::pair<std::string, std::string> >	fields;
+	bool											isCommitted;
+
+	size_t			findDelimiter() const;
+	bool			parsePartHeaders(const std::string &headers);
+	bool			startPart();
+	bool			writePartData(const char *data, size_t length);
+	void			finishPart();
+
+	MultipartStatus	fail(MultipartStatus failureStatus);
+
+	MultipartParser(const MultipartParser &other);
+	MultipartParser	&operator=(const MultipartParser &other);
+
+public:
+	MultipartParser();
+	~MultipartParser();
+
+	bool			open(const std::string &contentType, const std::string &directory);
+	MultipartStatus	parse(const char *input, size_t length);
+	void			commit();
+	void			clear();
+
+	MultipartStatus										getStatus() const;
+	const std::vector<MultipartFile>					&getFiles() const;
+	const std::vector<std::pair<std::string, std::string> >	&getFields() const;
+
+	static bool		isMultipart(const std::string &contentType);
+	static bool		getParameter(const std::string &headerValue, const std::string &parameter, std::string &value);
+};
+
+
+#endif /* MULTIPARTPARSER_HPP */
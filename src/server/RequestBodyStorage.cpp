@@ -0,0 +1,408 @@
+#include "RequestBodyStorage.hpp"
+#include "Clock.hpp"
+#include "../logging/Logger.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctime>
+#include <cstdio>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+std::vector<std::string>	RequestBodyStorage::bufferPool;
+
+RequestBodyStorage::RequestBodyStorage()
+	: bufferThreshold(0), size(0), fileFd(-1), isOpen(false)
+{
+	splicePipe[0] = -1;
+	splicePipe[1] = -1;
+}
+
+RequestBodyStorage::~RequestBodyStorage()
+{
+	clear();
+}
+
+void	RequestBodyStorage::acquireBuffer()
+{
+	if (buffer.capacity() > 0 || bufferPool.empty())
+		return;
+	buffer.swap(bufferPool.back());
+	bufferPool.pop_back();
+}
+
+void	RequestBodyStorage::releaseBuffer()
+{
+	buffer.clear();
+	if (buffer.capacity() == 0)
+		return;
+	if (bufferPool.size() < MAX_POOLED_BODY_BUFFERS)
+	{
+		bufferPool.push_back(std::string());
+		bufferPool.back().swap(buffer);
+	}
+	else
+		std::string().swap(buffer);
+}
+
+int	RequestBodyStorage::createAnonymousFile()
+{
+	int	fd = -1;
+
+#ifdef O_TMPFILE
+	fd = ::open(TEMP_FILE_DIRECTORY, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+	if (fd >= 0)
+		return (fd);
+#endif
+	// no O_TMPFILE (or not supported by the filesystem): create a file and unlink it right away
+	char	pathTemplate[] = TEMP_FILE_DIRECTORY "body_XXXXXX";
+	fd = mkstemp(pathTemplate);
+	if (fd < 0)
+		return (-1);
+	unlink(pathTemplate);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return (fd);
+}
+
+// next free-looking name in an upload directory: current time, process id and a counter
+std::string	RequestBodyStorage::makeUploadName(const std::string &directory, const char *prefix)
+{
+	static unsigned long	uploadCounter = 0;
+
+	return (directory + "/" + prefix + std::to_string(Clock::getTime()) + "_"
+		+ std::to_string(getpid()) + "_" + std::to_string(uploadCounter++));
+}
+
+/*
+	Creates the destination file of an upload. The file is opened with O_EXCL
+	so an existing file is never reused or overwritten.
+*/
+int	RequestBodyStorage::createUploadFile(const std::string &directory, std::string &path, const char *prefix)
+{
+	for (int attempt = 0; attempt < MAX_UPLOAD_NAME_ATTEMPTS; attempt++)
+	{
+		path = makeUploadName(directory, prefix);
+		int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+		if (fd >= 0)
+			return (fd);
+		if (errno != EEXIST)
+			break;
+	}
+	path.clear();
+	return (-1);
+}
+
+/*
+	Gives a complete upload its final name. link(2) fails instead of
+	replacing an existing file, the temporary name is removed afterwards.
+*/
+bool	RequestBodyStorage::publishUploadFile(const std::string &tempPath, std::string &path)
+{
+	std::string	directory = tempPath.substr(0, tempPath.find_last_of('/'));
+
+	for (int attempt = 0; attempt < MAX_UPLOAD_NAME_ATTEMPTS; attempt++)
+	{
+		path = makeUploadName(directory, UPLOAD_FILE_PREFIX);
+		if (link(tempPath.c_str(), path.c_str()) == 0)
+		{
+			unlink(tempPath.c_str());
+			return (true);
+		}
+		if (errno != EEXIST)
+			break;
+	}
+	path.clear();
+	return (false);
+}
+
+/*
+	Creates the missing directories of a path, like "mkdir -p".
+*/
+bool	RequestBodyStorage::createDirectories(const std::string &path)
+{
+	struct stat	pathStat;
+	size_t		pos = 0;
+
+	while (pos != std::string::npos)
+	{
+		pos = path.find('/', pos + 1);
+		std::string current = path.substr(0, pos);
+		if (stat(current.c_str(), &pathStat) == 0)
+		{
+			if (!S_ISDIR(pathStat.st_mode))
+				return (false);
+			continue;
+		}
+		if (mkdir(current.c_str(), 0755) < 0 && errno != EEXIST)
+			return (false);
+	}
+	return (true);
+}
+
+bool	RequestBodyStorage::spillToFile()
+{
+	fileFd = createAnonymousFile();
+	if (fileFd < 0)
+	{
+		Logger::log(Logger::ERROR, "Failed to create temporary file for request body: " + std::string(strerror(errno)), "RequestBodyStorage::spillToFile");
+		return (false);
+	}
+	Logger::log(Logger::DEBUG, "Request body spilled to an anonymous temporary file", "RequestBodyStorage::spillToFile");
+	if (!buffer.empty())
+	{
+		size_t bufferedSize = buffer.size();
+		size = 0;
+		if (!append(buffer.data(), bufferedSize))
+			return (false);
+	}
+	releaseBuffer();
+	return (true);
+}
+
+bool	RequestBodyStorage::open(size_t threshold, size_t expectedSize)
+{
+	clear();
+	isOpen = true;
+	bufferThreshold = threshold;
+	if (expectedSize > bufferThreshold)
+		return (spillToFile());
+	acquireBuffer();
+	return (true);
+}
+
+/*
+	The body is written to a hidden temporary file next to its destination,
+	it only shows up under its final name once commitTarget() is called.
+*/
+bool	RequestBodyStorage::openTarget(const std::string &directory, size_t expectedSize, const std::string &finalPath)
+{
+	clear();
+	isOpen = true;
+	renamePath = finalPath;
+	fileFd = createUploadFile(directory, targetPath, UPLOAD_TEMP_FILE_PREFIX);
+	if (fileFd < 0)
+	{
+		Logger::log(Logger::ERROR, "Failed to create upload file in \"" + directory + "\": " + std::string(strerror(errno)), "RequestBodyStorage::openTarget");
+		return (false);
+	}
+#ifdef __linux__
+	// reserve the blocks up front, a full disk is detected before receiving anything
+	if (expectedSize > 0 && fallocate(fileFd, 0, 0, expectedSize) < 0
+		&& errno != EOPNOTSUPP && errno != ENOSYS)
+	{
+		Logger::log(Logger::ERROR, "Failed to preallocate upload file \"" + targetPath + "\": " + std::string(strerror(errno)), "RequestBodyStorage::openTarget");
+		clear();
+		return (false);
+	}
+#else
+	(void)expectedSize;
+#endif
+	Logger::log(Logger::DEBUG, "Request body is stored to \"" + targetPath + "\"", "RequestBodyStorage::openTarget");
+	return (true);
+}
+
+/*
+	Keeps the uploaded file and returns its path, the storage no longer owns it.
+	The file is renamed to the final path given to openTarget(), or linked to
+	a new unique name in its directory. An empty path is returned (and the
+	file removed) if that fails.
+*/
+std::string	RequestBodyStorage::commitTarget()
+{
+	std::string	path;
+
+	if (!renamePath.empty())
+	{
+		if (rename(targetPath.c_str(), renamePath.c_str()) < 0)
+		{
+			Logger::log(Logger::ERROR, "Failed to rename \"" + targetPath + "\" to \"" + renamePath + "\": " + std::string(strerror(errno)), "RequestBodyStorage::commitTarget");
+			clear();
+			return (path);
+		}
+		targetPath.clear();
+		path = renamePath;
+	}
+	else if (!publishUploadFile(targetPath, path))
+	{
+		Logger::log(Logger::ERROR, "Failed to name upload file \"" + targetPath + "\": " + std::string(strerror(errno)), "RequestBodyStorage::commitTarget");
+		clear();
+		return (path);
+	}
+	targetPath.clear();
+	clear();
+	return (path);
+}
+
+bool	RequestBodyStorage::append(const char *data, size_t length)
+{
+	if (fileFd == -1 && size + length > bufferThreshold)
+	{
+		if (!spillToFile())
+			return (false);
+	}
+	if (fileFd == -1)
+	{
+		buffer.append(data, length);
+		size += length;
+		return (true);
+	}
+	while (length > 0)
+	{
+		ssize_t written = write(fileFd, data, length);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			Logger::log(Logger::ERROR, "Failed to write request body to temporary file: " + std::string(strerror(errno)), "RequestBodyStorage::append");
+			return (false);
+		}
+		data += written;
+		length -= written;
+		size += written;
+	}
+	return (true);
+}
+
+void	RequestBodyStorage::closeSplicePipe()
+{
+	if (splicePipe[0] != -1)
+		close(splicePipe[0]);
+	if (splicePipe[1] != -1)
+		close(splicePipe[1]);
+	splicePipe[0] = -1;
+	splicePipe[1] = -1;
+}
+
+void	RequestBodyStorage::clear()
+{
+	if (fileFd != -1)
+	{
+		close(fileFd);
+		fileFd = -1;
+	}
+	// an upload that was not committed is incomplete
+	if (!targetPath.empty())
+	{
+		unlink(targetPath.c_str());
+		targetPath.clear();
+	}
+	renamePath.clear();
+	closeSplicePipe();
+	if (isOpen)
+		releaseBuffer();
+	size = 0;
+	isOpen = false;
+}
+
+/*
+	Returns a new descriptor the body can be read from, from its first byte,
+	meant to become the stdin of a CGI script. In-memory bodies are written
+	into a pipe, which never blocks because client_body_buffer_size is capped
+	to the pipe capacity.
+*/
+int	RequestBodyStorage::openReader()
+{
+	if (fileFd != -1)
+	{
+		if (lseek(fileFd, 0, SEEK_SET) < 0)
+			return (-1);
+		return (dup(fileFd));
+	}
+
+	int	pipeFd[2];
+	if (pipe(pipeFd) < 0)
+		return (-1);
+	// a body that does not fit must fail instead of blocking the event loop
+	fcntl(pipeFd[1], F_SETFL, fcntl(pipeFd[1], F_GETFL, 0) | O_NONBLOCK);
+	const char	*data = buffer.data();
+	size_t		remaining = buffer.size();
+	while (remaining > 0)
+	{
+		ssize_t written = write(pipeFd[1], data, remaining);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+		{
+			close(pipeFd[0]);
+			close(pipeFd[1]);
+			return (-1);
+		}
+		data += written;
+		remaining -= written;
+	}
+	close(pipeFd[1]);
+	return (pipeFd[0]);
+}
+
+/*
+	Moves up to "length" bytes from the socket to the body file through a pipe,
+	without copying them to user space. Returns the number of bytes stored,
+	0 when the peer closed the connection and -1 on error (EAGAIN when the
+	socket has nothing to read yet).
+*/
+ssize_t	RequestBodyStorage::spliceFrom(int socketFd, size_t length)
+{
+#ifdef __linux__
+	if (fileFd == -1)
+	{
+		errno = EINVAL;
+		return (-1);
+	}
+	if (splicePipe[0] == -1 && pipe2(splicePipe, O_CLOEXEC | O_NONBLOCK) < 0)
+	{
+		splicePipe[0] = -1;
+		splicePipe[1] = -1;
+		return (-1);
+	}
+	if (length > SPLICE_CHUNK_SIZE)
+		length = SPLICE_CHUNK_SIZE;
+	ssize_t received = splice(socketFd, NULL, splicePipe[1], NULL, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	if (received <= 0)
+		return (received);
+	// the pipe is drained completely, the file is a regular file and never blocks
+	ssize_t remaining = received;
+	while (remaining > 0)
+	{
+		ssize_t written = splice(splicePipe[0], NULL, fileFd, NULL, remaining, SPLICE_F_MOVE);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+		{
+			Logger::log(Logger::ERROR, "Failed to splice request body to file: " + std::string(strerror(errno)), "RequestBodyStorage::spliceFrom");
+			closeSplicePipe();
+			errno = EIO;
+			return (-1);
+		}
+		remaining -= written;
+		size += written;
+	}
+	return (received);
+#else
+	(void)socketFd;
+	(void)length;
+	errno = ENOSYS;
+	return (-1);
+#endif
+}
+
+size_t	RequestBodyStorage::getSize() const
+{
+	return (this->size);
+}
+
+bool	RequestBodyStorage::isInMemory() const
+{
+	return (this->fileFd == -1);
+}
+
+bool	RequestBodyStorage::isTarget() const
+{
+	return (!this->targetPath.empty());
+}
+
+const std::string	&RequestBodyStorage::getBuffer() const
+{
+	return (this->buffer);
+}
@@ -0,0 +1,92 @@
+
+
+
+#pragma once
+#ifndef REQUESTBODYSTORAGE_HPP
+#define REQUESTBODYSTORAGE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <sys/types.h>
+
+// bodies are spilled to anonymous files created in this directory
+#define TEMP_FILE_DIRECTORY "uploads/"
+
+// number of released in-memory body buffers kept around for the next requests
+#define MAX_POOLED_BODY_BUFFERS 64
+
+// attempts at finding a free name for an uploaded file before giving up
+#define MAX_UPLOAD_NAME_ATTEMPTS 16
+
+// names of the files in an upload store, and of the ones still being received
+#define UPLOAD_FILE_PREFIX "upload_"
+#define UPLOAD_TEMP_FILE_PREFIX ".upload_tmp_"
+
+// bytes moved from the socket per splice(2) call, the default pipe capacity
+#define SPLICE_CHUNK_SIZE 65536 // 64 KB
+
+/*
+	Holds the body of the request being received. Bodies up to the
+	"client_body_buffer_size" threshold live in a pooled in-memory buffer,
+	bigger ones spill to an anonymous temporary file (O_TMPFILE where available)
+	that disappears as soon as its descriptor is closed, so no file name is
+	generated and nothing has to be removed afterwards.
+
+	With "upload_store" the body is written straight to a hidden temporary
+	file in the store instead; it is removed again unless the upload completes
+	and is committed, which gives it a new unique name. A final path can be
+	given for the file to be renamed to when it is committed instead, so it
+	is replaced atomically (PUT). On Linux, file backed bodies are moved from the socket
+	with splice(2) so the data never passes through user space.
+*/
+class RequestBodyStorage
+{
+private:
+	std::string							buffer;
+	size_t								bufferThreshold;
+	size_t								size;
+	int									fileFd;
+	bool								isOpen;
+	std::string							targetPath;
+	std::string							renamePath;
+	int									splicePipe[2];
+
+	static std::vector<std::string>		bufferPool;
+
+	bool				spillToFile();
+	void				acquireBuffer();
+	void				releaseBuffer();
+	void				closeSplicePipe();
+
+	static std::string	makeUploadName(const std::string &directory, const char *prefix);
+
+	RequestBodyStorage(const RequestBodyStorage &other);
+	RequestBodyStorage	&operator=(const RequestBodyStorage &other);
+
+public:
+	RequestBodyStorage();
+	~RequestBodyStorage();
+
+	bool				open(size_t threshold, size_t expectedSize);
+	bool				openTarget(const std::string &directory, size_t expectedSize, const std::string &finalPath = "");
+	std::string			commitTarget();
+	bool				append(const char *data, size_t length);
+	void				clear();
+
+	int					openReader();
+	ssize_t				spliceFrom(int socketFd, size_t length);
+
+	size_t				getSize() const;
+	bool				isInMemory() const;
+	bool				isTarget() const;
+	const std::string	&getBuffer() const;
+
+	static int			createAnonymousFile();
+	static int			createUploadFile(const std::string &directory, std::string &path, const char *prefix = UPLOAD_FILE_PREFIX);
+	static bool			publishUploadFile(const std::string &tempPath, std::string &path);
+	static bool			createDirectories(const std::string &path);
+};
+
+
+#endif /* REQUESTBODYSTORAGE_HPP */
@@ -1,14 +1,42 @@
 #include "ResponseState.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
 ResponseState::ResponseState(const std::string &smallResponse, bool closeConnection)
-	: type(SMALL_RESPONSE), smallResponse(smallResponse), closeConnection(closeConnection), bytesSent(0) {}
+	: type(SMALL_RESPONSE), smallResponse(smallResponse), sourceFd(-1), isSourceFinished(false), isChunked(true), streamRemaining(0), closeConnection(closeConnection), bytesSent(0), chunkRemaining(0) {}
 
 ResponseState::ResponseState(const std::string &responseHeaders, const std::string &filePath, size_t fileSize)
-	: type(LARGE_RESPONSE), headers(responseHeaders), filePath(filePath), fileSize(fileSize), bytesSent(0), headersSent(0), isHeaderSent(false), currentChunkPosition(0)
+	: type(LARGE_RESPONSE), headers(responseHeaders), filePath(filePath), fileSize(fileSize), sourceFd(-1), isSourceFinished(false), isChunked(true), streamRemaining(0),
+	bytesSent(0), headersSent(0), isHeaderSent(false), currentChunkPosition(0), chunkRemaining(0)
 {
 	fileStream.open(filePath, std::ifstream::binary);
 }
 
+ResponseState::ResponseState(const HttpResponse &response, bool closeConnection)
+	: type(response.getType()), filePath(response.getFilePath()), fileSize(response.getFileSize()), sourceFd(-1), isSourceFinished(false), isChunked(true), streamRemaining(0),
+	closeConnection(closeConnection), bytesSent(0), headersSent(0), isHeaderSent(false), currentChunkPosition(0), chunkRemaining(0)
+{
+	if (type == SMALL_RESPONSE)
+		response.writeResponse(smallResponse);
+	else
+	{
+		response.writeHead(headers);
+		fileStream.open(filePath, std::ifstream::binary);
+	}
+}
+
+// the head goes out with the first chunk, as part of currentChunk
+ResponseState::ResponseState(const HttpResponse &response, int sourceFd, bool closeConnection)
+	: type(STREAM_RESPONSE), fileSize(0), sourceFd(sourceFd), isSourceFinished(false), isChunked(true), streamRemaining(0),
+	closeConnection(closeConnection), bytesSent(0), headersSent(0), isHeaderSent(true), currentChunkPosition(0), chunkRemaining(0)
+{
+	response.writeHead(currentChunk);
+}
+
 ResponseType ResponseState::getType() const
 {
 	return type;
@@ -46,8 +74,129 @@ std::string ResponseState::getNextChunk()
 		return "";
 }
 
+int	ResponseState::getSourceFd() const
+{
+	return (this->sourceFd);
+}
+
+// the producer is done with its descriptor, which may be reused before the response is sent
+void	ResponseState::releaseSource()
+{
+	this->sourceFd = -1;
+}
+
+// bytes the producer has written to the pipe and not yet forwarded, 0 also once it closed the pipe
+size_t	ResponseState::getPendingSourceBytes() const
+{
+	int	available = 0;
+
+	if (ioctl(this->sourceFd, FIONREAD, &available) < 0 || available < 0)
+		return (0);
+	return (static_cast<size_t>(available));
+}
+
+// a body of known length is passed on without chunk framing, up to that length
+void	ResponseState::setStreamLength(size_t length)
+{
+	this->isChunked = false;
+	this->streamRemaining = length;
+	this->isSourceFinished = (length == 0);
+}
+
+// a chunk whose data was already read from the pipe
+void	ResponseState::appendChunk(const char *data, size_t length)
+{
+	if (!this->isChunked)
+	{
+		length = std::min(length, this->streamRemaining);
+		this->currentChunk.append(data, length);
+		this->streamRemaining -= length;
+		this->isSourceFinished = (this->streamRemaining == 0);
+	}
+	else if (length > 0)
+	{
+		std::stringstream ss;
+		ss << std::hex << length;
+		this->currentChunk.append(ss.str()).append("\r\n").append(data, length).append("\r\n");
+	}
+	this->bytesSent += length;
+}
+
+// a chunk of "length" bytes waiting in the pipe, only its size line is buffered
+void	ResponseState::startChunk(size_t length)
+{
+	if (!this->isChunked)
+	{
+		this->chunkRemaining = std::min(length, this->streamRemaining);
+		return;
+	}
+	std::stringstream ss;
+	ss << std::hex << length;
+	this->currentChunk.append(ss.str()).append("\r\n");
+	this->chunkRemaining = length;
+}
+
+/*
+	Moves the rest of the current chunk from the pipe to the socket. On Linux
+	it is spliced, elsewhere it is read into currentChunk and sent with the
+	chunk framing. Returns the number of bytes moved, or -1 with errno set
+	(EAGAIN while the socket is full).
+*/
+ssize_t	ResponseState::forwardChunk(int socketFd)
+{
+#ifdef __linux__
+	ssize_t moved = splice(this->sourceFd, NULL, socketFd, NULL, this->chunkRemaining, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+#else
+	char	buffer[CHUNK_SIZE];
+	(void)socketFd;
+	ssize_t moved = read(this->sourceFd, buffer, std::min(this->chunkRemaining, static_cast<size_t>(CHUNK_SIZE)));
+	if (moved > 0)
+		this->currentChunk.append(buffer, moved);
+#endif
+	if (moved == 0)
+	{
+		// the pipe announced these bytes, it cannot be empty
+		errno = EIO;
+		return (-1);
+	}
+	if (moved < 0)
+		return (-1);
+	this->chunkRemaining -= moved;
+	this->bytesSent += moved;
+	if (!this->isChunked)
+	{
+		this->streamRemaining -= moved;
+		this->isSourceFinished = (this->streamRemaining == 0);
+	}
+	else if (this->chunkRemaining == 0)
+		this->currentChunk.append("\r\n");
+	return (moved);
+}
+
+/*
+	The producer closed the pipe: the last chunk ends a chunked body. False
+	when a body of known length is cut short, the response cannot be
+	completed.
+*/
+bool	ResponseState::finishStream()
+{
+	if (!this->isChunked)
+		return (this->isSourceFinished);
+	this->isSourceFinished = true;
+	this->currentChunk.append("0\r\n\r\n");
+	return (true);
+}
+
+// bytes appended to the response and not sent yet
+size_t	ResponseState::getBufferedSize() const
+{
+	return (this->currentChunk.size() - this->currentChunkPosition);
+}
+
 bool ResponseState::isFinished() const
 {
+	if (type == STREAM_RESPONSE)
+		return (isSourceFinished && chunkRemaining == 0 && currentChunkPosition >= currentChunk.size());
 	if (type == LARGE_RESPONSE)
 		return (fileStream.eof() || bytesSent >= fileSize);
 	else
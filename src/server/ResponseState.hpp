@@ -7,10 +7,20 @@
 #include "../http/HttpResponse.hpp"
 
 #include <sstream>
+#include <sys/types.h>
 
 
 #define CHUNK_SIZE  16384 // 16 KB
 
+/*
+	A response being sent. Small responses are serialized in one buffer,
+	large ones stream a file in chunks. A streamed response sends its head
+	first and then forwards the body from a pipe in chunks as large as the
+	data waiting in the pipe, or unframed when its length is known; on Linux
+	the data is spliced to the socket and never copied to user space. The
+	output of a FastCGI application arrives in records instead, it is
+	appended to the response as it is received.
+*/
 class ResponseState
 {
 
@@ -21,11 +31,17 @@ private:
 	std::string		filePath;
 	std::ifstream	fileStream;
 	size_t			fileSize;
+	int				sourceFd; // pipe a streamed body is read from, owned by its producer
+	bool			isSourceFinished;
+	bool			isChunked; // a streamed body of unknown length, otherwise streamRemaining bytes are passed on as is
+	size_t			streamRemaining;
 
 public:
 
 	ResponseState(const std::string &smallResponse, bool closeConnection = false); // small response
 	ResponseState(const std::string &responseHeaders, const std::string &filePath, size_t fileSize); // large response
+	ResponseState(const HttpResponse &response, bool closeConnection = false); // serialized in place
+	ResponseState(const HttpResponse &response, int sourceFd, bool closeConnection = false); // body streamed from sourceFd
 
 	bool				closeConnection;
 	size_t				bytesSent;
@@ -33,12 +49,23 @@ public:
 	bool				isHeaderSent;
 	std::string			currentChunk;
 	size_t				currentChunkPosition;
+	size_t				chunkRemaining; // bytes of the streamed chunk still in the pipe
 
 	ResponseType		getType() const;
 	const std::string	&getSmallResponse() const;
 	const std::string	&getHeaders() const;
 	std::string			getNextChunk();
 
+	int					getSourceFd() const;
+	void				releaseSource();
+	size_t				getPendingSourceBytes() const;
+	void				setStreamLength(size_t length);
+	void				appendChunk(const char *data, size_t length);
+	void				startChunk(size_t length);
+	ssize_t				forwardChunk(int socketFd);
+	bool				finishStream();
+	size_t				getBufferedSize() const;
+
 	bool				isFinished() const;
 };
 
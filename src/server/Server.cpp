@@ -1,19 +1,102 @@
 #include "Server.hpp"
 #include "ClientState.hpp"
+#include "../http/StatusCodes.hpp"
 #include <iterator>
+#include <set>
 
 
 // -----------------------------------
 // Constructor and Destructor
 // -----------------------------------
 
-Server::Server(ServerConfig &config, EventPoller *eventManager, MimeTypeConfig &mimeTypes)
-	: _config(config), _mimeTypes(mimeTypes), _eventManager(eventManager), _socket(-1)
+Server::Server(const ServerConfig &config, EventPoller *eventManager, const std::shared_ptr<ConfigGeneration> &generation)
+	: _address(ConfigGeneration::getAddress(config)), _port(config.port), _virtualHosts(NULL), _draining(false), _eventManager(eventManager), _socket(-1)
 {
 	_serverAddr.sin_family = AF_INET;
-	_serverAddr.sin_port = htons(_config.port);
-	_serverAddr.sin_addr.s_addr = inet_addr(_config.ipAddress.c_str());
+	_serverAddr.sin_port = htons(config.port);
+	_serverAddr.sin_addr.s_addr = inet_addr(config.ipAddress.c_str());
 	memset(_serverAddr.sin_zero, '\0', sizeof(_serverAddr.sin_zero));
+	setGeneration(generation);
+}
+
+/*
+	Connections accepted from now on use the server blocks of this
+	generation, the ones already open keep theirs.
+*/
+void	Server::setGeneration(const std::shared_ptr<ConfigGeneration> &generation)
+{
+	_generation = generation;
+	_virtualHosts = generation->findListener(_address);
+}
+
+// server block of the client's current request, the default one before its headers are parsed
+ServerConfig	&Server::getClientConfig(int clientSocket)
+{
+	std::map<int, ClientState *>::iterator it = _clients.find(clientSocket);
+	if (it == _clients.end())
+		return (_virtualHosts->getDefault());
+	return (it->second->getServerConfig());
+}
+
+MimeTypeConfig	&Server::getClientMimeTypes(int clientSocket)
+{
+	std::map<int, ClientState *>::iterator it = _clients.find(clientSocket);
+	if (it == _clients.end())
+		return (_generation->getMimeTypes());
+	return (it->second->getMimeTypes());
+}
+
+/*
+	The address is no longer in the configuration: no new connection is
+	accepted, the open ones are still served.
+*/
+void	Server::stopListening()
+{
+	if (_socket == -1)
+		return;
+	_eventManager->unregisterEvent(_socket, READ);
+	close(_socket);
+	_socket = -1;
+}
+
+/*
+	Graceful shutdown: no new connection is accepted, idle keep-alive
+	connections are closed and every other one is closed after its current
+	response, which announces it with "Connection: close".
+*/
+void	Server::drain()
+{
+	stopListening();
+	_draining = true;
+	closeIdleConnections();
+}
+
+// connections between two requests, with no response or CGI output pending
+void	Server::closeIdleConnections()
+{
+	std::set<int>	busyClients;
+
+	for (std::map<int, CgiHandler *>::iterator cgi = _cgi.begin(); cgi != _cgi.end(); cgi++)
+		busyClients.insert(cgi->second->getCgiClientSocket());
+	std::map<int, ClientState *>::iterator it = _clients.begin();
+	while (it != _clients.end())
+	{
+		if (!it->second->isIdle() || _responses.count(it->first) > 0 || busyClients.count(it->first) > 0)
+		{
+			it++;
+			continue;
+		}
+		Logger::log(Logger::INFO, "Closing idle connection with socket fd " + std::to_string(it->first), "Server::closeIdleConnections");
+		_eventManager->unregisterEvent(it->first, READ);
+		close(it->first);
+		delete it->second;
+		it = _clients.erase(it);
+	}
+}
+
+bool	Server::isIdle() const
+{
+	return (_clients.empty() && _responses.empty() && _cgi.empty() && !hasFastCgiRequests());
 }
 
 Server::~Server()
@@ -46,6 +129,23 @@ Server::~Server()
 	}
 	_cgi.clear();
 
+	std::map<int, FastCgiConnection *>::iterator fastcgi = _fastcgi.begin();
+	while (fastcgi != _fastcgi.end())
+	{
+		_eventManager->unregisterEvent(fastcgi->first, READ);
+		delete fastcgi->second;
+		fastcgi++;
+	}
+	_fastcgi.clear();
+
+	std::map<std::string, FastCgiPool *>::iterator pool = _fastcgiPools.begin();
+	while (pool != _fastcgiPools.end())
+	{
+		delete pool->second;
+		pool++;
+	}
+	_fastcgiPools.clear();
+
 	if (_socket != -1)
 	{
 		_eventManager->unregisterEvent(_socket, READ);
@@ -66,7 +166,11 @@ void	Server::createServerSocket()
 		this->_socket = -1;
 	}
 	else
+	{
+		// CGI scripts must not inherit it, a binary upgrade passes it on explicitly
+		fcntl(this->_socket, F_SETFD, FD_CLOEXEC);
 		Logger::log(Logger::INFO, "Server socket created successfully", "Server::createServerSocket");
+	}
 }
 
 void	Server::setSocketOptions()
@@ -127,6 +231,22 @@ void	Server::bindAndListen()
 		Logger::log(Logger::INFO, "Server is now listening on socket", "Server::bindAndListen");
 }
 
+// whether an inherited descriptor is a socket listening on this server's address
+bool	Server::isListeningSocket(int fd) const
+{
+	struct sockaddr_in	boundAddr;
+	socklen_t			boundAddrLen = sizeof(boundAddr);
+	int					isListening = 0;
+	socklen_t			optionLen = sizeof(isListening);
+
+	if (getsockname(fd, (struct sockaddr *)&boundAddr, &boundAddrLen) < 0 || boundAddr.sin_family != AF_INET)
+		return (false);
+	if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &isListening, &optionLen) < 0 || !isListening)
+		return (false);
+	return (boundAddr.sin_port == _serverAddr.sin_port
+		&& boundAddr.sin_addr.s_addr == _serverAddr.sin_addr.s_addr);
+}
+
 void	Server::run()
 {
 	createServerSocket();
@@ -135,6 +255,20 @@ void	Server::run()
 	bindAndListen();
 }
 
+/*
+	Uses a socket that is already bound and listening, inherited from the
+	process that executed this one, instead of creating a new one. The
+	connections waiting in its queue are accepted by this process.
+*/
+void	Server::adoptSocket(int fd)
+{
+	_socket = fd;
+	fcntl(_socket, F_SETFD, FD_CLOEXEC);
+	setSocketToNonBlocking();
+	if (_socket != -1)
+		Logger::log(Logger::INFO, "Inherited listening socket fd " + std::to_string(fd) + " adopted for " + _address, "Server::adoptSocket");
+}
+
 // -----------------------------------
 // Client Connection Handling
 // -----------------------------------
@@ -163,7 +297,9 @@ void	Server::acceptNewConnection()
 				close(clientSocket);
 		return;
 	}
-	ClientState *clientState = new ClientState(clientSocket, inet_ntoa(clientAddr.sin_addr));
+	// a CGI script must not keep the connection open once the server closed it
+	fcntl(clientSocket, F_SETFD, FD_CLOEXEC);
+	ClientState *clientState = new ClientState(clientSocket, inet_ntoa(clientAddr.sin_addr), _generation, *_virtualHosts);
 	_clients[clientSocket] = clientState;
 	_eventManager->registerEvent(clientSocket, READ);
 }
@@ -179,6 +315,8 @@ void	Server::handleClientDisconnection(int clientSocket)
 		_responses.erase(clientSocket);
 		delete responseState;
 	}
+	cancelCgiRequests(clientSocket);
+	cancelFastCgiRequests(clientSocket);
 	_eventManager->unregisterEvent(clientSocket, READ);
 	ClientState *clientState = _clients[clientSocket];
 	_clients.erase(clientSocket);
@@ -194,11 +332,20 @@ void	Server::handleClientDisconnection(int clientSocket)
 
 void	Server::handleClientRequest(int clientSocket)
 {
+	if (_clients[clientSocket]->canSpliceBody())
+	{
+		_clients[clientSocket]->updateLastRequestTime();
+		_clients[clientSocket]->spliceBody(*this);
+		return;
+	}
+
 	char buffer[BUFFER_SIZE + 1];
 	ssize_t bytesRead = recv(clientSocket, buffer, BUFFER_SIZE, 0);
 	if (bytesRead < 0)
 	{
 		Logger::log(Logger::ERROR, "Error receiving data from client with socket fd " + std::to_string(clientSocket), "Server::handleClientRequest");
+		cancelCgiRequests(clientSocket);
+		cancelFastCgiRequests(clientSocket);
 		removeClient(clientSocket);
 		close(clientSocket);
 	}
@@ -219,15 +366,18 @@ void	Server::handleClientRequest(int clientSocket)
 
 void	Server::processGetRequest(int clientSocket, HttpRequest &request)
 {
-	if (_config.cgiExtension.isEnabled() && CgiHandler::validCgiRequest(request, _config))
+	ServerConfig &config = getClientConfig(clientSocket);
+	if (_clients.count(clientSocket) > 0 && _clients[clientSocket]->isFastCgiRequest())
+		passToFastCgi(clientSocket, request);
+	else if (config.cgiExtension.isEnabled() && CgiHandler::validCgiRequest(request, config))
 	{
-		if (_cgi.size() > MAX_CONCURRENT_CGI_REQUESTS)
+		if (isCgiCapacityExceeded())
 		{
 			Logger::log(Logger::WARN, "Server is busy and cannot handle the request at the moment. Please try again later.", "Server::processGetRequest");
 			handleInvalidRequest(clientSocket, 503, "Server is busy and cannot handle the request at the moment. Please try again later.");
 			return;
 		}
-		CgiHandler *cgi = new CgiHandler(request, _config, _eventManager, clientSocket);
+		CgiHandler *cgi = new CgiHandler(request, config, _eventManager, clientSocket);
 		if (cgi->isValidCgi())
 			_cgi[cgi->getCgiReadFd()] = cgi;
 		else
@@ -238,27 +388,25 @@ void	Server::processGetRequest(int clientSocket, HttpRequest &request)
 	}
 	else
 	{
-		ResponseState *responseState;
-		RequestHandler handler(_config, _mimeTypes);
+		RequestHandler handler(config, getClientMimeTypes(clientSocket));
 		HttpResponse response = handler.handleRequest(request);
+		if (response.getType() == FASTCGI_RESPONSE)
+		{
+			passRedirectToFastCgi(clientSocket, request);
+			return;
+		}
 		if (_clients.count(clientSocket) > 0)
 			_clients[clientSocket]->resetClientState();
 		if (!request.getHeader("Cookie").empty())
 			response.setHeader("Set-Cookie", request.getHeader("Cookie"));
-		if (response.getType() == SMALL_RESPONSE)
-			responseState = new ResponseState(response.buildResponse());
-		else
-			responseState = new ResponseState(response.buildResponse(), response.getFilePath(), response.getFileSize());
-
-		_responses[clientSocket] = responseState;
-		_eventManager->registerEvent(clientSocket, WRITE);
+		queueResponse(clientSocket, response);
 	}
 }
 
 void	Server::processHeadRequest(int clientSocket, HttpRequest &request)
 {
-	ResponseState *responseState;
-	RequestHandler handler(_config, _mimeTypes);
+	ServerConfig &config = getClientConfig(clientSocket);
+	RequestHandler handler(config, getClientMimeTypes(clientSocket));
 	HttpResponse response = handler.handleRequest(request);
 	response.setBody("");
 
@@ -267,22 +415,24 @@ void	Server::processHeadRequest(int clientSocket, HttpRequest &request)
 
 	if (!request.getHeader("Cookie").empty())
 		response.setHeader("Set-Cookie", request.getHeader("Cookie"));
-	
-	if (response.getType() == SMALL_RESPONSE)
-		responseState = new ResponseState(response.buildResponse());
-	else
-		responseState = new ResponseState(response.buildResponse(), response.getFilePath(), response.getFileSize());
-
-	_responses[clientSocket] = responseState;
-	_eventManager->registerEvent(clientSocket, WRITE);
+	queueResponse(clientSocket, response);
 }
 
 void	Server::processPostRequest(int clientSocket, HttpRequest &request, bool closeConnection)
 {
+	ServerConfig &config = getClientConfig(clientSocket);
 
-	if (_config.cgiExtension.isEnabled() && CgiHandler::validCgiRequest(request, _config))
+	if (_clients.count(clientSocket) > 0 && _clients[clientSocket]->isFastCgiRequest())
+		passToFastCgi(clientSocket, request, closeConnection);
+	else if (config.cgiExtension.isEnabled() && CgiHandler::validCgiRequest(request, config))
 	{
-		CgiHandler *cgi = new CgiHandler(request, _config, _eventManager, clientSocket, _clients[clientSocket]->getPostRequestFileName());
+		if (isCgiCapacityExceeded())
+		{
+			Logger::log(Logger::WARN, "Server is busy and cannot handle the request at the moment. Please try again later.", "Server::processPostRequest");
+			handleInvalidRequest(clientSocket, 503, "Server is busy and cannot handle the request at the moment. Please try again later.");
+			return;
+		}
+		CgiHandler *cgi = new CgiHandler(request, config, _eventManager, clientSocket, _clients[clientSocket]->openRequestBodyReader());
 		if (cgi->isValidCgi())
 			_cgi[cgi->getCgiReadFd()] = cgi;
 		else
@@ -293,89 +443,576 @@ void	Server::processPostRequest(int clientSocket, HttpRequest &request, bool clo
 	}
 	else
 	{
-		ResponseState *responseState;
-		RequestHandler handler(_config, _mimeTypes);
-		HttpResponse response = handler.handleRequest(request);
+		RequestHandler handler(config, getClientMimeTypes(clientSocket));
+		HttpResponse response;
+		if (_clients.count(clientSocket) > 0 && _clients[clientSocket]->isUploadRequest())
+			response = handler.handleUploadedFiles(request, _clients[clientSocket]->commitUploads());
+		else
+			response = handler.handleRequest(request);
+		if (response.getType() == FASTCGI_RESPONSE)
+		{
+			passRedirectToFastCgi(clientSocket, request, closeConnection);
+			return;
+		}
 		if (_clients.count(clientSocket) > 0)
 			_clients[clientSocket]->resetClientState();
 
 		if (!request.getHeader("Cookie").empty())
 			response.setHeader("Set-Cookie", request.getHeader("Cookie"));
-		
-		responseState = new ResponseState(response.buildResponse(), closeConnection);
+		queueResponse(clientSocket, response, closeConnection);
+	}
+}
 
-		_responses[clientSocket] = responseState;
-		_eventManager->registerEvent(clientSocket, WRITE);
+void	Server::processPutRequest(int clientSocket, HttpRequest &request, bool closeConnection)
+{
+	ServerConfig &config = getClientConfig(clientSocket);
+	RequestHandler	handler(config, getClientMimeTypes(clientSocket));
+	ClientState		*client = _clients[clientSocket];
+	struct stat		targetStat;
+
+	bool replaced = (stat(client->getPutTargetPath().c_str(), &targetStat) == 0);
+	if (client->commitUploads().empty())
+	{
+		handleInvalidRequest(clientSocket, 500, "Failed to store the request body.");
+		return;
 	}
+	HttpResponse response = handler.handleStoredPutRequest(request, replaced);
+	client->resetClientState();
+
+	if (!request.getHeader("Cookie").empty())
+		response.setHeader("Set-Cookie", request.getHeader("Cookie"));
+	queueResponse(clientSocket, response, closeConnection);
 }
 
 void	Server::processDeleteRequest(int clientSocket, HttpRequest &request)
 {
-	ResponseState *responseState;
-	RequestHandler handler(_config, _mimeTypes);
+	ServerConfig &config = getClientConfig(clientSocket);
+	RequestHandler handler(config, getClientMimeTypes(clientSocket));
 	HttpResponse response = handler.handleRequest(request);
 	if (_clients.count(clientSocket) > 0)
 		_clients[clientSocket]->resetClientState();
 
 	if (!request.getHeader("Cookie").empty())
 		response.setHeader("Set-Cookie", request.getHeader("Cookie"));
-	
-	responseState = new ResponseState(response.buildResponse());
-
-	_responses[clientSocket] = responseState;
-	_eventManager->registerEvent(clientSocket, WRITE);
+	queueResponse(clientSocket, response);
 }
 
 // ----------------------------- Handle CGI Output -----------------------------
 
+/*
+	Until the header section of the output is complete the pipe is watched
+	and the output collected; it starts the response, or redirects locally.
+	From then on the body is streamed:
+	the pipe is only watched while the client's socket waits for more output
+	(or for its end), so a client slower than the script stops reading the
+	pipe and the script blocks on it.
+*/
 void	Server::handleCgiOutput(int cgiReadFd)
 {
 	Logger::log(Logger::DEBUG, "Handling CGI output from pipe with fd " + std::to_string(cgiReadFd), "Server::handleCgiOutput");
-	char		buffer[BUFFER_SIZE + 1];
 	CgiHandler	*cgi = _cgi[cgiReadFd];
+	int			clientSocket = cgi->getCgiClientSocket();
+
+	if (cgi->isStreamingOutput())
+	{
+		cgi->watchOutput(_eventManager, false);
+		if (_responses.count(clientSocket) == 0 || _responses[clientSocket]->getSourceFd() != cgiReadFd)
+		{
+			releaseCgi(cgiReadFd, true);
+			return;
+		}
+		ResponseState *responseState = _responses[clientSocket];
+		if (responseState->getPendingSourceBytes() == 0 && !responseState->finishStream())
+		{
+			Logger::log(Logger::ERROR, "CGI script with pipe fd " + std::to_string(cgiReadFd) + " ended before its Content-Length", "Server::handleCgiOutput");
+			abortStreamResponse(clientSocket, responseState);
+			return;
+		}
+		_eventManager->registerEvent(clientSocket, WRITE);
+		return;
+	}
+
+	char		buffer[BUFFER_SIZE];
 	ssize_t 	bytesRead = read(cgiReadFd, buffer, BUFFER_SIZE);
 	if (bytesRead < 0)
 	{
+		releaseCgi(cgiReadFd, true);
+		handleInvalidRequest(clientSocket, 500, "Failed to read CGI output from pipe.");
+		return;
+	}
+	if (_clients.count(clientSocket) == 0)
+	{
+		Logger::log(Logger::ERROR, "No client state found for CGI client with socket fd " + std::to_string(clientSocket), "Server::handleCgiOutput");
+		releaseCgi(cgiReadFd, true);
+		return;
+	}
+	cgi->addCgiResponseMessage(std::string(buffer, bytesRead));
+	CgiHeaderStatus status = cgi->parseResponseHeaders(bytesRead == 0);
+	if (status == CGI_HEADERS_INCOMPLETE)
+		return;
+	if (status == CGI_HEADERS_INVALID)
+	{
+		Logger::log(Logger::ERROR, "CGI script with pipe fd " + std::to_string(cgiReadFd) + " sent an invalid response", "Server::handleCgiOutput");
+		releaseCgi(cgiReadFd, true);
+		handleInvalidRequest(clientSocket, 502, "The CGI script sent an invalid response.");
+	}
+	else if (cgi->getResponseHeaders().isLocalRedirect())
+	{
+		std::string uri = cgi->getResponseHeaders().getLocation();
+		releaseCgi(cgiReadFd, false);
+		processLocalRedirect(clientSocket, uri);
+	}
+	else
+		startCgiResponse(cgi);
+}
+
+/*
+	Sends the head with the part of the body read with the headers, the
+	rest is streamed. A body the script gave a Content-Length is passed on
+	as is, any other one in chunks.
+*/
+void	Server::startCgiResponse(CgiHandler *cgi)
+{
+	int						clientSocket = cgi->getCgiClientSocket();
+	const CgiResponseHeaders	&headers = cgi->getResponseHeaders();
+	const std::string		&output = cgi->getCgiResponseMessage();
+	HttpResponse			response = cgi->buildCgiResponse();
+	ResponseState			*responseState;
+
+	response.setConstantHeaders(&_clients[clientSocket]->getRequestConfig().constantHeaders);
+	_clients[clientSocket]->resetClientState();
+	responseState = queueStreamResponse(clientSocket, response, cgi->getCgiReadFd());
+	if (headers.hasBodyLength())
+		responseState->setStreamLength(headers.getBodyLength());
+	responseState->appendChunk(output.data() + headers.getBodyStart(), output.size() - headers.getBodyStart());
+	cgi->startStreaming();
+	cgi->watchOutput(_eventManager, false);
+}
+
+/*
+	Local redirect of a CGI script or FastCGI application (RFC 3875, section
+	6.2.2): the client gets the response to a GET of the new URI instead,
+	served the way its location says.
+*/
+void	Server::processLocalRedirect(int clientSocket, const std::string &uri)
+{
+	ClientState	*client = _clients[clientSocket];
+
+	Logger::log(Logger::DEBUG, "Local redirect to '" + uri + "' for client with socket fd " + std::to_string(clientSocket), "Server::processLocalRedirect");
+	if (!client->redirectRequest(uri))
+	{
+		handleInvalidRequest(clientSocket, 500, "Too many internal redirects.");
+		return;
+	}
+	processGetRequest(clientSocket, client->getRequest());
+}
+
+// "terminate" kills a script that is still running, its output is no longer wanted
+void	Server::releaseCgi(int cgiReadFd, bool terminate)
+{
+	CgiHandler	*cgi = _cgi[cgiReadFd];
+
+	if (terminate && cgi->getChildPid() > 0)
 		kill(cgi->getChildPid(), SIGKILL);
-		_eventManager->unregisterEvent(cgiReadFd, READ);
-		handleInvalidRequest(cgi->getCgiClientSocket(), 500, "Failed to read CGI output from pipe.");
-		_cgi.erase(cgiReadFd);
-		delete cgi;
+	cgi->watchOutput(_eventManager, false);
+	_cgi.erase(cgiReadFd);
+	delete cgi;
+}
+
+// the client went away, its scripts are stopped
+void	Server::cancelCgiRequests(int clientSocket)
+{
+	std::vector<int>	cancelled;
+
+	for (std::map<int, CgiHandler *>::iterator it = _cgi.begin(); it != _cgi.end(); it++)
+	{
+		if (it->second->getCgiClientSocket() == clientSocket)
+			cancelled.push_back(it->first);
 	}
-	else if (bytesRead == 0)
+	for (size_t i = 0; i < cancelled.size(); i++)
+	{
+		Logger::log(Logger::INFO, "Client with socket fd " + std::to_string(clientSocket) + " went away, stopping its CGI script", "Server::cancelCgiRequests");
+		releaseCgi(cancelled[i], true);
+	}
+}
+
+// ----------------------------- Handle FastCGI -----------------------------
+
+/*
+	Passes the request to the FastCGI server of its location. It goes out on
+	an idle or new connection of the pool, or waits in the pool's queue while
+	every connection is busy.
+*/
+void	Server::passToFastCgi(int clientSocket, HttpRequest &request, bool closeConnection)
+{
+	ClientState		*client = _clients[clientSocket];
+	LocationConfig	*location = client->getLocation();
+	int				bodyFd = -1;
+
+	if (request.getMethod() == "POST" && (bodyFd = client->openRequestBodyReader()) < 0)
+	{
+		handleInvalidRequest(clientSocket, 500, "Failed to read the request body.");
+		return;
+	}
+	FastCgiRequest	*fastcgiRequest = new FastCgiRequest(clientSocket, request, *location, getClientConfig(clientSocket), bodyFd);
+	FastCgiPool		*pool = getFastCgiPool(location->getFastCgiPass());
+
+	fastcgiRequest->setCloseConnection(closeConnection);
+	if (!pool->isSaturated())
+		startFastCgiRequest(pool, fastcgiRequest);
+	else if (pool->enqueue(fastcgiRequest))
+		Logger::log(Logger::DEBUG, "Every connection to FastCGI server " + pool->getAddress() + " is busy, request of socket fd " + std::to_string(clientSocket) + " is queued", "Server::passToFastCgi");
+	else
+	{
+		Logger::log(Logger::WARN, "Too many requests waiting for FastCGI server " + pool->getAddress(), "Server::passToFastCgi");
+		delete fastcgiRequest;
+		handleInvalidRequest(clientSocket, 503, "Server is busy and cannot handle the request at the moment. Please try again later.");
+	}
+}
+
+/*
+	A try_files or error_page fallback rewrote the request into a location
+	with fastcgi_pass: the client's location is updated to it before the
+	request is passed on.
+*/
+void	Server::passRedirectToFastCgi(int clientSocket, HttpRequest &request, bool closeConnection)
+{
+	if (_clients.count(clientSocket) == 0)
+	{
+		handleInvalidRequest(clientSocket, 500, "Failed to pass the request to the FastCGI server.");
+		return;
+	}
+	_clients[clientSocket]->updateLocation();
+	passToFastCgi(clientSocket, request, closeConnection);
+}
+
+FastCgiPool	*Server::getFastCgiPool(const FastCgiDirective &address)
+{
+	std::map<std::string, FastCgiPool *>::iterator it = _fastcgiPools.find(address.getAddress());
+
+	if (it != _fastcgiPools.end())
+		return (it->second);
+	FastCgiPool *pool = new FastCgiPool(address);
+	_fastcgiPools[address.getAddress()] = pool;
+	return (pool);
+}
+
+void	Server::startFastCgiRequest(FastCgiPool *pool, FastCgiRequest *fastcgiRequest, bool reuseIdle)
+{
+	bool				isNew;
+	FastCgiConnection	*connection = pool->acquire(isNew, reuseIdle);
+
+	if (connection == NULL)
+	{
+		failFastCgiRequest(fastcgiRequest, 502, "The FastCGI server is not available.");
+		return;
+	}
+	if (isNew)
+	{
+		_fastcgi[connection->getFd()] = connection;
+		connection->watchOutput(_eventManager, true);
+	}
+	connection->start(fastcgiRequest);
+	_eventManager->registerEvent(connection->getFd(), WRITE);
+}
+
+void	Server::startQueuedFastCgiRequests(FastCgiPool *pool)
+{
+	while (!pool->isSaturated())
+	{
+		FastCgiRequest *fastcgiRequest = pool->dequeue();
+		if (fastcgiRequest == NULL)
+			return;
+		startFastCgiRequest(pool, fastcgiRequest);
+	}
+}
+
+void	Server::handleFastCgiWrite(int fastcgiFd)
+{
+	FastCgiConnection	*connection = _fastcgi[fastcgiFd];
+	FastCgiStatus		status = connection->sendRecords();
+
+	if (status == FASTCGI_DONE)
+		_eventManager->unregisterEvent(fastcgiFd, WRITE);
+	else if (status == FASTCGI_ERROR)
+	{
+		if (!retryFastCgiRequest(connection))
+			abortFastCgiRequest(connection, 502, "The request could not be sent to the FastCGI server.");
+	}
+}
+
+void	Server::handleFastCgiRead(int fastcgiFd)
+{
+	FastCgiConnection	*connection = _fastcgi[fastcgiFd];
+	FastCgiStatus		status = connection->receiveRecords();
+
+	if (connection->getRequest() == NULL)
+	{
+		if (status == FASTCGI_AGAIN)
+			return;
+		Logger::log(Logger::DEBUG, "Idle FastCGI connection with fd " + std::to_string(fastcgiFd) + " was closed by the server", "Server::handleFastCgiRead");
+		closeFastCgiConnection(connection);
+	}
+	else if (status == FASTCGI_ERROR)
 	{
+		if (!retryFastCgiRequest(connection))
+			abortFastCgiRequest(connection, 502, "The FastCGI server failed to answer the request.");
+	}
+	else if (status == FASTCGI_DONE)
+		completeFastCgiRequest(connection);
+	else
+		handleFastCgiOutput(connection);
+}
 
-		if (_clients.count(cgi->getCgiClientSocket()) == 0)
+/*
+	Until the header section of the output is complete it is collected, then
+	the response starts; a local redirect is followed once the request
+	completes. From then on the output is appended to the response as it
+	arrives. The connection is no longer read while the client has more than
+	FASTCGI_MAX_BUFFERED_OUTPUT waiting, sendStreamResponse() reads it again
+	once the client caught up.
+*/
+void	Server::handleFastCgiOutput(FastCgiConnection *connection)
+{
+	FastCgiRequest	*fastcgiRequest = connection->getRequest();
+	int				clientSocket = fastcgiRequest->getClientSocket();
+	ResponseState	*responseState;
+
+	if (fastcgiRequest->getOutput().empty() || (fastcgiRequest->hasResponseHeaders() && !fastcgiRequest->isStreamingOutput()))
+		return;
+	if (fastcgiRequest->isStreamingOutput())
+	{
+		// a body of known length was sent completely, what follows is dropped
+		if (_responses.count(clientSocket) == 0 || _responses[clientSocket]->getSourceFd() != connection->getFd())
 		{
-			Logger::log(Logger::ERROR, "No client state found for CGI client with socket fd " + std::to_string(cgi->getCgiClientSocket()), "Server::handleCgiOutput");
-			_eventManager->unregisterEvent(cgiReadFd, READ);
-			_cgi.erase(cgiReadFd);
-			delete cgi;
+			fastcgiRequest->getOutput().clear();
 			return;
 		}
+		responseState = _responses[clientSocket];
+		appendFastCgiOutput(fastcgiRequest, responseState);
+	}
+	else
+	{
+		CgiHeaderStatus status = fastcgiRequest->parseResponseHeaders(false);
+		if (status == CGI_HEADERS_INCOMPLETE)
+			return;
+		if (status == CGI_HEADERS_INVALID)
+		{
+			Logger::log(Logger::ERROR, "FastCGI application on fd " + std::to_string(connection->getFd()) + " sent an invalid response", "Server::handleFastCgiOutput");
+			abortFastCgiRequest(connection, 502, "The FastCGI application sent an invalid response.");
+			return;
+		}
+		if (fastcgiRequest->getResponseHeaders().isLocalRedirect())
+		{
+			fastcgiRequest->getOutput().clear();
+			return;
+		}
+		responseState = startFastCgiResponse(fastcgiRequest, connection->getFd());
+	}
+	if (responseState->getBufferedSize() > FASTCGI_MAX_BUFFERED_OUTPUT)
+		connection->watchOutput(_eventManager, false);
+}
+
+/*
+	Sends the head with the part of the body received with the headers. A
+	body the application gave a Content-Length is passed on as is, any other
+	one in chunks.
+*/
+ResponseState	*Server::startFastCgiResponse(FastCgiRequest *fastcgiRequest, int sourceFd)
+{
+	int							clientSocket = fastcgiRequest->getClientSocket();
+	const CgiResponseHeaders	&headers = fastcgiRequest->getResponseHeaders();
+	std::string					&output = fastcgiRequest->getOutput();
+	HttpResponse				response = fastcgiRequest->buildResponse();
+	ResponseState				*responseState;
+
+	if (_clients.count(clientSocket) > 0)
+	{
+		response.setConstantHeaders(&_clients[clientSocket]->getRequestConfig().constantHeaders);
+		_clients[clientSocket]->resetClientState();
+	}
+	responseState = queueStreamResponse(clientSocket, response, sourceFd, fastcgiRequest->closesConnection());
+	if (headers.hasBodyLength())
+		responseState->setStreamLength(headers.getBodyLength());
+	responseState->appendChunk(output.data() + headers.getBodyStart(), output.size() - headers.getBodyStart());
+	fastcgiRequest->startStreaming();
+	return (responseState);
+}
+
+// the output received since the last call, the client's socket is watched for it
+void	Server::appendFastCgiOutput(FastCgiRequest *fastcgiRequest, ResponseState *responseState)
+{
+	std::string	&output = fastcgiRequest->getOutput();
+
+	responseState->appendChunk(output.data(), output.size());
+	output.clear();
+	fastcgiRequest->updateOutputTime();
+	_eventManager->registerEvent(fastcgiRequest->getClientSocket(), WRITE);
+}
 
-		ResponseState *responseState = new ResponseState(cgi->buildCgiResponse());
-		if (_clients.count(cgi->getCgiClientSocket()) > 0)
-			_clients[cgi->getCgiClientSocket()]->resetClientState();
-		_responses[cgi->getCgiClientSocket()] = responseState;
-		_eventManager->registerEvent(cgi->getCgiClientSocket() , WRITE);
-		_eventManager->unregisterEvent(cgiReadFd, READ);
-		_cgi.erase(cgiReadFd);
-		delete cgi;
+/*
+	Ends the response with the rest of the output of the application. The
+	connection goes back to the pool unless it is out of step, and the next
+	waiting request takes it.
+*/
+void	Server::completeFastCgiRequest(FastCgiConnection *connection)
+{
+	FastCgiPool		*pool = connection->getPool();
+	int				fastcgiFd = connection->getFd();
+	FastCgiRequest	*fastcgiRequest = connection->detachRequest();
+	int				clientSocket = fastcgiRequest->getClientSocket();
+	bool			isWaiting = _clients.count(clientSocket) > 0 || fastcgiRequest->closesConnection();
+	ResponseState	*responseState = NULL;
+
+	if (connection->canBeReused())
+	{
+		_eventManager->unregisterEvent(fastcgiFd, WRITE);
+		pool->release(connection);
 	}
 	else
+		closeFastCgiConnection(connection);
+
+	if (fastcgiRequest->isStreamingOutput())
 	{
-		buffer[bytesRead] = '\0';
-		cgi->addCgiResponseMessage(std::string(buffer, bytesRead));
-		if (cgi->getCgiResponseMessage().length() >= CGI_MAX_OUTPUT_SIZE)
+		if (_responses.count(clientSocket) > 0 && _responses[clientSocket]->getSourceFd() == fastcgiFd)
+			responseState = _responses[clientSocket];
+	}
+	else if (isWaiting) // a client that went away gets no response
+	{
+		if (!fastcgiRequest->hasResponseHeaders() && fastcgiRequest->parseResponseHeaders(true) != CGI_HEADERS_COMPLETE)
+			handleInvalidRequest(clientSocket, 502, "The FastCGI application sent an invalid response.");
+		else if (fastcgiRequest->getResponseHeaders().isLocalRedirect() && _clients.count(clientSocket) > 0)
+			processLocalRedirect(clientSocket, fastcgiRequest->getResponseHeaders().getLocation());
+		else
+			responseState = startFastCgiResponse(fastcgiRequest, fastcgiFd);
+	}
+
+	if (responseState)
+	{
+		appendFastCgiOutput(fastcgiRequest, responseState);
+		responseState->releaseSource();
+		if (!responseState->finishStream())
 		{
-			kill(cgi->getChildPid(), SIGKILL);
-			_eventManager->unregisterEvent(cgiReadFd, READ);
-			handleInvalidRequest(cgi->getCgiClientSocket(), 500, "The CGI script's output exceeded the maximum allowed size of 2 MB and was terminated.");
-			_cgi.erase(cgiReadFd);
-			delete cgi;
+			Logger::log(Logger::ERROR, "FastCGI application on fd " + std::to_string(fastcgiFd) + " ended before its Content-Length", "Server::completeFastCgiRequest");
+			abortStreamResponse(clientSocket, responseState);
 		}
 	}
+	delete fastcgiRequest;
+	startQueuedFastCgiRequests(pool);
+}
+
+/*
+	A kept connection the server closed while it was idle fails the next
+	request before anything is answered. The connection is closed and the
+	request starts again on a new one, once. A body read from a pipe cannot
+	be rewound: it is read again from the client's storage while the client
+	still waits.
+*/
+bool	Server::retryFastCgiRequest(FastCgiConnection *connection)
+{
+	FastCgiPool		*pool = connection->getPool();
+	FastCgiRequest	*fastcgiRequest = connection->getRequest();
+	int				clientSocket;
+
+	if (!connection->canRetryRequest() || fastcgiRequest->wasRetried())
+		return (false);
+	clientSocket = fastcgiRequest->getClientSocket();
+	if (!fastcgiRequest->rewindBody())
+	{
+		int bodyFd = -1;
+
+		if (_clients.count(clientSocket) == 0 || (bodyFd = _clients[clientSocket]->openRequestBodyReader()) < 0)
+			return (false);
+		fastcgiRequest->setBodyFd(bodyFd);
+	}
+	Logger::log(Logger::INFO, "Kept FastCGI connection with fd " + std::to_string(connection->getFd()) + " was closed by the server, sending the request of socket fd "
+		+ std::to_string(clientSocket) + " again on a new connection", "Server::retryFastCgiRequest");
+	connection->detachRequest();
+	closeFastCgiConnection(connection);
+	fastcgiRequest->markRetried();
+	startFastCgiRequest(pool, fastcgiRequest, false);
+	return (true);
+}
+
+/*
+	The request cannot complete on this connection, which is closed. Once
+	the response started, its status line is long gone: the client's
+	connection is closed so that it sees the body is incomplete.
+*/
+void	Server::abortFastCgiRequest(FastCgiConnection *connection, int statusCode, const std::string &detail)
+{
+	FastCgiPool		*pool = connection->getPool();
+	int				fastcgiFd = connection->getFd();
+	FastCgiRequest	*fastcgiRequest = connection->detachRequest();
+
+	closeFastCgiConnection(connection);
+	if (fastcgiRequest && fastcgiRequest->isStreamingOutput())
+	{
+		int clientSocket = fastcgiRequest->getClientSocket();
+
+		delete fastcgiRequest;
+		if (_responses.count(clientSocket) > 0 && _responses[clientSocket]->getSourceFd() == fastcgiFd)
+			abortStreamResponse(clientSocket, _responses[clientSocket]);
+	}
+	else if (fastcgiRequest)
+		failFastCgiRequest(fastcgiRequest, statusCode, detail);
+	startQueuedFastCgiRequests(pool);
+}
+
+void	Server::failFastCgiRequest(FastCgiRequest *fastcgiRequest, int statusCode, const std::string &detail)
+{
+	int		clientSocket = fastcgiRequest->getClientSocket();
+	bool	isWaiting = _clients.count(clientSocket) > 0 || fastcgiRequest->closesConnection();
+
+	delete fastcgiRequest;
+	if (isWaiting)
+		handleInvalidRequest(clientSocket, statusCode, detail);
+}
+
+// the client went away, its request is dropped from the queue or its connection closed
+void	Server::cancelFastCgiRequests(int clientSocket)
+{
+	std::vector<FastCgiConnection *>	cancelled;
+
+	for (std::map<std::string, FastCgiPool *>::iterator pool = _fastcgiPools.begin(); pool != _fastcgiPools.end(); pool++)
+		pool->second->cancel(clientSocket);
+	for (std::map<int, FastCgiConnection *>::iterator it = _fastcgi.begin(); it != _fastcgi.end(); it++)
+	{
+		if (it->second->getRequest() && it->second->getRequest()->getClientSocket() == clientSocket)
+			cancelled.push_back(it->second);
+	}
+	for (size_t i = 0; i < cancelled.size(); i++)
+	{
+		FastCgiPool *pool = cancelled[i]->getPool();
+		Logger::log(Logger::INFO, "Client with socket fd " + std::to_string(clientSocket) + " went away, closing its FastCGI connection", "Server::cancelFastCgiRequests");
+		closeFastCgiConnection(cancelled[i]);
+		startQueuedFastCgiRequests(pool);
+	}
+}
+
+void	Server::closeFastCgiConnection(FastCgiConnection *connection)
+{
+	if (connection->isWatchingOutput())
+		_eventManager->unregisterEvent(connection->getFd(), READ);
+	_fastcgi.erase(connection->getFd());
+	connection->getPool()->remove(connection);
+	delete connection;
+}
+
+// requests sent or waiting, idle connections do not count
+bool	Server::hasFastCgiRequests() const
+{
+	for (std::map<int, FastCgiConnection *>::const_iterator it = _fastcgi.begin(); it != _fastcgi.end(); it++)
+	{
+		if (it->second->getRequest())
+			return (true);
+	}
+	for (std::map<std::string, FastCgiPool *>::const_iterator it = _fastcgiPools.begin(); it != _fastcgiPools.end(); it++)
+	{
+		if (it->second->hasQueuedRequests())
+			return (true);
+	}
+	return (false);
 }
 
 // -----------------------------------
@@ -397,6 +1034,8 @@ void	Server::handleClientResponse(int clientSocket)
 		sendSmallResponse(clientSocket, responseState);
 	else if (responseState->getType() == LARGE_RESPONSE)
 		sendLargeResponse(clientSocket, responseState);
+	else
+		sendStreamResponse(clientSocket, responseState);
 }
 
 void	Server::sendSmallResponse(int clientSocket, ResponseState *responseState)
@@ -422,14 +1061,7 @@ void	Server::sendSmallResponse(int clientSocket, ResponseState *responseState)
 		if (responseState->isFinished())
 		{
 			Logger::log(Logger::DEBUG, "Small response sent completely to client with socket fd " + std::to_string(clientSocket), "Server::sendSmallResponse");
-			_eventManager->unregisterEvent(clientSocket, WRITE);
-			_responses.erase(clientSocket);
-			if (responseState->closeConnection)
-			{
-				Logger::log(Logger::INFO, "Closing connection after sending small response to client with socket fd " + std::to_string(clientSocket), "Server::sendSmallResponse");
-				close(clientSocket);
-			}
-			delete responseState;
+			finishResponse(clientSocket, responseState);
 		}
 		else
 			Logger::log(Logger::DEBUG, "Partial small response sent to client with socket fd " + std::to_string(clientSocket), "Server::sendSmallResponse");
@@ -514,9 +1146,7 @@ void	Server::sendLargeResponseChunk(int clientSocket, ResponseState *responseSta
 				else
 				{
 					Logger::log(Logger::DEBUG, "End chunk sent completely to client with socket fd " + std::to_string(clientSocket), "Server::sendLargeResponseChunk");
-					_eventManager->unregisterEvent(clientSocket, WRITE);
-					_responses.erase(clientSocket);
-					delete responseState;
+					finishResponse(clientSocket, responseState);
 				}
 			}
 		}
@@ -528,6 +1158,151 @@ void	Server::sendLargeResponseChunk(int clientSocket, ResponseState *responseSta
 
 }
 
+/*
+	Sends what is buffered (head, chunk framing), then splices the current
+	chunk from the pipe, then starts a chunk with whatever the pipe holds.
+	When the pipe is empty the socket stops being watched and the pipe is
+	watched instead, handleCgiOutput() switches back once there is more
+	output or the script closed it.
+*/
+void	Server::sendStreamResponse(int clientSocket, ResponseState *responseState)
+{
+	while (!responseState->isFinished())
+	{
+		if (responseState->currentChunkPosition < responseState->currentChunk.size())
+		{
+			const std::string	&chunk = responseState->currentChunk;
+			ssize_t bytesSent = send(clientSocket, chunk.data() + responseState->currentChunkPosition, chunk.size() - responseState->currentChunkPosition, 0);
+			if (bytesSent < 0)
+			{
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return;
+				Logger::log(Logger::ERROR, "Failed to send streamed response to client with socket fd " + std::to_string(clientSocket) + ". Error: " + strerror(errno), "Server::sendStreamResponse");
+				abortStreamResponse(clientSocket, responseState);
+				return;
+			}
+			responseState->currentChunkPosition += bytesSent;
+			if (responseState->currentChunkPosition < chunk.size())
+				return;
+			responseState->currentChunk.clear();
+			responseState->currentChunkPosition = 0;
+		}
+		else if (responseState->chunkRemaining > 0)
+		{
+			if (responseState->forwardChunk(clientSocket) < 0)
+			{
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return;
+				Logger::log(Logger::ERROR, "Failed to forward CGI output to client with socket fd " + std::to_string(clientSocket) + ". Error: " + strerror(errno), "Server::sendStreamResponse");
+				abortStreamResponse(clientSocket, responseState);
+				return;
+			}
+		}
+		else if (_fastcgi.count(responseState->getSourceFd()) > 0)
+		{
+			// the output of a FastCGI application is appended by handleFastCgiRead(), its connection is read again
+			FastCgiConnection *connection = _fastcgi[responseState->getSourceFd()];
+			_eventManager->unregisterEvent(clientSocket, WRITE);
+			connection->watchOutput(_eventManager, true);
+			if (connection->getRequest())
+				connection->getRequest()->updateOutputTime();
+			if (_clients.count(clientSocket) > 0)
+				_clients[clientSocket]->updateLastRequestTime();
+			return;
+		}
+		else
+		{
+			size_t available = responseState->getPendingSourceBytes();
+			if (_cgi.count(responseState->getSourceFd()) == 0)
+			{
+				abortStreamResponse(clientSocket, responseState);
+				return;
+			}
+			if (available == 0)
+			{
+				_eventManager->unregisterEvent(clientSocket, WRITE);
+				_cgi[responseState->getSourceFd()]->watchOutput(_eventManager, true);
+				return;
+			}
+			responseState->startChunk(available);
+			_cgi[responseState->getSourceFd()]->updateOutputTime();
+			if (_clients.count(clientSocket) > 0)
+				_clients[clientSocket]->updateLastRequestTime();
+		}
+	}
+	Logger::log(Logger::DEBUG, "Streamed response sent completely to client with socket fd " + std::to_string(clientSocket), "Server::sendStreamResponse");
+	if (_cgi.count(responseState->getSourceFd()) > 0)
+		releaseCgi(responseState->getSourceFd(), false);
+	finishResponse(clientSocket, responseState);
+}
+
+/*
+	The status line of a streamed response is long gone when it fails, the
+	connection is closed so that the client sees the body is incomplete.
+*/
+void	Server::abortStreamResponse(int clientSocket, ResponseState *responseState)
+{
+	if (_cgi.count(responseState->getSourceFd()) > 0)
+		releaseCgi(responseState->getSourceFd(), true);
+	cancelFastCgiRequests(clientSocket);
+	_eventManager->unregisterEvent(clientSocket, WRITE);
+	_responses.erase(clientSocket);
+	delete responseState;
+	if (_clients.count(clientSocket) > 0)
+		removeClient(clientSocket);
+	close(clientSocket);
+}
+
+/*
+	The response is sent completely. A connection that does not stay alive,
+	or any connection once the server drains, is closed; its client state is
+	removed first if the response did not.
+*/
+void	Server::finishResponse(int clientSocket, ResponseState *responseState)
+{
+	_eventManager->unregisterEvent(clientSocket, WRITE);
+	_responses.erase(clientSocket);
+	if (responseState->closeConnection || _draining)
+	{
+		Logger::log(Logger::INFO, "Closing connection after sending the response to client with socket fd " + std::to_string(clientSocket), "Server::finishResponse");
+		if (_clients.count(clientSocket) > 0)
+			removeClient(clientSocket);
+		close(clientSocket);
+	}
+	delete responseState;
+}
+
+/*
+	Sends the interim response that asks the client for its body. It goes
+	out right away: it must not wait behind, or replace, a queued final
+	response, so none is sent while one is still pending. Returns false
+	when only part of it could be written; the rest would end up in front
+	of the final response, so the connection is closed instead.
+*/
+bool	Server::sendContinueResponse(int clientSocket)
+{
+	static const char	continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+	const size_t		continueLength = sizeof(continueResponse) - 1;
+
+	if (_responses.count(clientSocket) > 0)
+	{
+		Logger::log(Logger::DEBUG, "Response pending, not sending 100 Continue to client with socket fd " + std::to_string(clientSocket), "Server::sendContinueResponse");
+		return (true);
+	}
+	ssize_t bytesSent = send(clientSocket, continueResponse, continueLength, 0);
+	if (bytesSent == static_cast<ssize_t>(continueLength))
+		Logger::log(Logger::DEBUG, "Sent 100 Continue to client with socket fd " + std::to_string(clientSocket), "Server::sendContinueResponse");
+	else if (bytesSent <= 0)
+		Logger::log(Logger::WARN, "Could not send 100 Continue to client with socket fd " + std::to_string(clientSocket) + ", the client will send the body after its own timeout", "Server::sendContinueResponse");
+	else
+	{
+		Logger::log(Logger::WARN, "Partial 100 Continue sent to client with socket fd " + std::to_string(clientSocket) + ", closing the connection", "Server::sendContinueResponse");
+		handleClientDisconnection(clientSocket);
+		return (false);
+	}
+	return (true);
+}
+
 // -----------------------------------
 // Error Handling
 // -----------------------------------
@@ -541,7 +1316,7 @@ void	Server::handleHeaderSizeExceeded(int clientSocket)
 
 	removeClient(clientSocket);
 	response.generateStandardErrorResponse("400", "Bad Request", "400 Request Header Or Cookie Too Large", "Request Header Or Cookie Too Large");
-	ResponseState *responseState = new ResponseState(response.buildResponse(), true);
+	ResponseState *responseState = new ResponseState(response, true);
 	_responses[clientSocket] = responseState;
 	_eventManager->registerEvent(clientSocket, WRITE);
 }
@@ -554,7 +1329,7 @@ void	Server::handleUriTooLarge(int clientSocket)
 
 	removeClient(clientSocket);
 	response.generateStandardErrorResponse("414", "Request-URI Too Large", "414 Request-URI Too Large");
-	ResponseState *responseState = new ResponseState(response.buildResponse(), true);
+	ResponseState *responseState = new ResponseState(response, true);
 	_responses[clientSocket] = responseState;
 	_eventManager->registerEvent(clientSocket, WRITE);
 }
@@ -567,21 +1342,79 @@ void	Server::handleInvalidGetRequest(int clientSocket)
 
 	removeClient(clientSocket);
 	response.generateStandardErrorResponse("400", "Bad Request", "400 Invalid GET Request (with body indicators)", "Invalid GET Request (with body indicators)");
-	ResponseState *responseState = new ResponseState(response.buildResponse(), true);
+	ResponseState *responseState = new ResponseState(response, true);
 	_responses[clientSocket] = responseState;
 	_eventManager->registerEvent(clientSocket, WRITE);
 }
 
 
+/*
+	Answers a request a rewrite rule redirected. The connection is kept
+	alive unless the request announced a body, which is not read.
+*/
+void	Server::processRedirect(int clientSocket, HttpRequest &request, int statusCode, const std::string &url)
+{
+	HttpResponse	response;
+	bool			hasBody = !request.getHeader("Content-Length").empty() || !request.getHeader("Transfer-Encoding").empty();
+
+	response.generateRedirectResponse(statusCode, url);
+	if (hasBody)
+	{
+		response.setHeader("Connection", "close");
+		removeClient(clientSocket);
+	}
+	else if (_clients.count(clientSocket) > 0)
+		_clients[clientSocket]->resetClientState();
+	queueResponse(clientSocket, response, hasBody);
+}
+
+/*
+	Queues the response of a connection. While the server drains, a response
+	that would keep the connection alive closes it instead.
+*/
+void	Server::queueResponse(int clientSocket, HttpResponse &response, bool closeConnection)
+{
+	if (_draining && !closeConnection)
+	{
+		response.setHeader("Connection", "close");
+		closeConnection = true;
+	}
+	_responses[clientSocket] = new ResponseState(response, closeConnection);
+	_eventManager->registerEvent(clientSocket, WRITE);
+}
+
+ResponseState	*Server::queueStreamResponse(int clientSocket, HttpResponse &response, int sourceFd, bool closeConnection)
+{
+	closeConnection = closeConnection || _draining;
+	if (closeConnection)
+		response.setHeader("Connection", "close");
+	ResponseState *responseState = new ResponseState(response, sourceFd, closeConnection);
+	_responses[clientSocket] = responseState;
+	_eventManager->registerEvent(clientSocket, WRITE);
+	return (responseState);
+}
+
 void	Server::handleInvalidRequest(int clientSocket, int requestStatusCode, const std::string &detail)
 {
-	std::string statusCode = std::to_string(requestStatusCode);
-	std::string statusMessage = getStatusMessage(requestStatusCode);
+	const std::string *cachedResponse = detail.empty() ? getClientConfig(clientSocket).responseCache.getClosingErrorResponse(requestStatusCode) : NULL;
+	ResponseState *responseState;
 
-	HttpResponse response;
 	removeClient(clientSocket);
-	response.generateStandardErrorResponse(statusCode, statusMessage, statusCode + " " + statusMessage, detail);
-	ResponseState *responseState = new ResponseState(response.buildResponse(), true);
+	if (cachedResponse)
+	{
+		HttpResponse response;
+		response.setCachedResponse(cachedResponse);
+		responseState = new ResponseState(response, true);
+	}
+	else
+	{
+		std::string statusCode = std::to_string(requestStatusCode);
+		std::string statusMessage = StatusCodes::getReason(requestStatusCode);
+
+		HttpResponse response;
+		response.generateStandardErrorResponse(statusCode, statusMessage, statusCode + " " + statusMessage, detail);
+		responseState = new ResponseState(response, true);
+	}
 	_responses[clientSocket] = responseState;
 	_eventManager->registerEvent(clientSocket, WRITE);
 }
@@ -596,9 +1429,11 @@ void	Server::checkForTimeouts()
 	std::map<int, ClientState *>::iterator it = _clients.begin();
 	while (it != _clients.end())
 	{
-		if (it->second->isTimedOut(this->_config.keepalive_timeout))
+		if (it->second->isTimedOut(it->second->getServerConfig().keepalive_timeout))
 		{
 			Logger::log(Logger::INFO, "Client with socket fd " + std::to_string(it->first) + " timed out and is being disconnected", "Server::checkForTimeouts");
+			cancelCgiRequests(it->first);
+			cancelFastCgiRequests(it->first);
 			_eventManager->unregisterEvent(it->first, READ);
 			close(it->first);
 			delete it->second;
@@ -609,25 +1444,56 @@ void	Server::checkForTimeouts()
 	}
 }
 
+/*
+	A script that did not start its response yet is answered with 504, one
+	that stopped streaming its output has its connection closed.
+*/
 void	Server::checkForCgiTimeouts()
 {
-	std::map<int, CgiHandler *>::iterator it = _cgi.begin();
-	while (it != _cgi.end())
+	std::vector<int>	timedOut;
+
+	for (std::map<int, CgiHandler *>::iterator it = _cgi.begin(); it != _cgi.end(); it++)
 	{
 		if (it->second->isTimedOut(CGI_TIMEOUT))
-		{
-			Logger::log(Logger::INFO, "Cgi with socket fd " + std::to_string(it->first) + " timed out and is being disconnected", "Server::checkForCgiTimeouts");
+			timedOut.push_back(it->first);
+	}
+	for (size_t i = 0; i < timedOut.size(); i++)
+	{
+		CgiHandler	*cgi = _cgi[timedOut[i]];
+		int			clientSocket = cgi->getCgiClientSocket();
 
-			kill(it->second->getChildPid(), SIGKILL);
-			_eventManager->unregisterEvent(it->first, READ);
-			close(it->first);
-			handleInvalidRequest(it->second->getCgiClientSocket(), 504, "The CGI script failed to complete in a timely manner. Please try again later.");
-			delete it->second;
-			it = _cgi.erase(it);
-			
+		Logger::log(Logger::INFO, "Cgi with socket fd " + std::to_string(timedOut[i]) + " timed out and is being disconnected", "Server::checkForCgiTimeouts");
+		if (!cgi->isStreamingOutput())
+		{
+			releaseCgi(timedOut[i], true);
+			handleInvalidRequest(clientSocket, 504, "The CGI script failed to complete in a timely manner. Please try again later.");
 		}
+		else if (_responses.count(clientSocket) > 0 && _responses[clientSocket]->getSourceFd() == timedOut[i])
+			abortStreamResponse(clientSocket, _responses[clientSocket]);
 		else
-			it++;
+			releaseCgi(timedOut[i], true);
+	}
+}
+
+void	Server::checkForFastCgiTimeouts()
+{
+	std::vector<FastCgiConnection *>	timedOut;
+
+	for (std::map<int, FastCgiConnection *>::iterator it = _fastcgi.begin(); it != _fastcgi.end(); it++)
+	{
+		if (it->second->getRequest() && it->second->getRequest()->isTimedOut(CGI_TIMEOUT))
+			timedOut.push_back(it->second);
+	}
+	for (size_t i = 0; i < timedOut.size(); i++)
+	{
+		Logger::log(Logger::INFO, "FastCGI request on fd " + std::to_string(timedOut[i]->getFd()) + " timed out and is being disconnected", "Server::checkForFastCgiTimeouts");
+		abortFastCgiRequest(timedOut[i], 504, "The FastCGI server failed to answer in a timely manner. Please try again later.");
+	}
+	for (std::map<std::string, FastCgiPool *>::iterator pool = _fastcgiPools.begin(); pool != _fastcgiPools.end(); pool++)
+	{
+		std::vector<FastCgiRequest *> expired = pool->second->takeTimedOut(CGI_TIMEOUT);
+		for (size_t i = 0; i < expired.size(); i++)
+			failFastCgiRequest(expired[i], 504, "The FastCGI server failed to answer in a timely manner. Please try again later.");
 	}
 }
 
@@ -647,21 +1513,7 @@ void	Server::removeClient(int clientSocket)
 	delete clientState;
 }
 
-std::string	Server::getStatusMessage(int statusCode)
+bool	Server::isCgiCapacityExceeded() const
 {
-	std::map<int, std::string>			statusCodeMessages;
-
-	statusCodeMessages[400] = "Bad Request";
-	statusCodeMessages[411] = "Length Required";
-	statusCodeMessages[413] = "Request Entity Too Large";
-	statusCodeMessages[414] = "Request-URI Too Large";
-	statusCodeMessages[500] = "Internal Server Error";
-	statusCodeMessages[501] = "Not Implemented";
-	statusCodeMessages[503] = "Service Unavailable";
-	statusCodeMessages[504] = "Gateway Timeout";
-	statusCodeMessages[505] = "HTTP Version Not Supported";
-
-	if (statusCodeMessages.count(statusCode) == 0)
-		return "";
-	return statusCodeMessages[statusCode];
+	return (_cgi.size() > MAX_CONCURRENT_CGI_REQUESTS);
 }
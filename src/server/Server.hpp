@@ -7,11 +7,17 @@
 
 #include "ResponseState.hpp"
 #include "../cgi/CgiHandler.hpp"
+#include "../cgi/FastCgiPool.hpp"
 #include "../config/ServerConfig.hpp"
+#include "VirtualHosts.hpp"
+#include "ConfigGeneration.hpp"
+
+#include <memory>
 
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <signal.h>
 #include <sys/signal.h>
 #include <sys/types.h>
@@ -30,13 +36,7 @@
 
 #define MAX_URI_SIZE 4096 // 4 KB
 
-// #define TEMP_FILE_DIRECTORY "./uploads/"
-#define TEMP_FILE_DIRECTORY "uploads/"
-
-#define CGI_TIMEOUT 20 // 10 seconds
-
-// define max size of cgi output
-#define CGI_MAX_OUTPUT_SIZE 2097152 // 2 MB in bytes
+#define CGI_TIMEOUT 20 // 10 seconds, without output from the script
 
 #define MAX_CONCURRENT_CGI_REQUESTS 15
 
@@ -47,17 +47,22 @@ class Server
 {
 
 public:
-	Server(ServerConfig &config, EventPoller *eventManager, MimeTypeConfig &mimeTypes);
+	Server(const ServerConfig &config, EventPoller *eventManager, const std::shared_ptr<ConfigGeneration> &generation);
 	~Server();
 
-	ServerConfig						&_config;
-	MimeTypeConfig						&_mimeTypes;
+	std::string							_address; // "ip:port"
+	int									_port;
+	std::shared_ptr<ConfigGeneration>	_generation; // given to the connections accepted from now on
+	VirtualHosts						*_virtualHosts; // server blocks of the socket in that generation
+	bool								_draining; // shutting down, connections are closed after their response
 	EventPoller							*_eventManager;
 	int									_socket;
 	struct sockaddr_in					_serverAddr;
 	std::map<int, ClientState *>		_clients;
 	std::map<int, ResponseState *>		_responses;
 	std::map<int, CgiHandler *>			_cgi;
+	std::map<int, FastCgiConnection *>	_fastcgi; // connections to FastCGI servers, idle or busy
+	std::map<std::string, FastCgiPool *>	_fastcgiPools; // by "fastcgi_pass" address
 	
 
 	// Server Creation
@@ -65,8 +70,17 @@ public:
 	void		setSocketOptions();
 	void		setSocketToNonBlocking();
 	void		bindAndListen();
+	bool		isListeningSocket(int fd) const;
 
 	void		run();
+	void		adoptSocket(int fd);
+	void		setGeneration(const std::shared_ptr<ConfigGeneration> &generation);
+	void		stopListening();
+	void		drain();
+	void		closeIdleConnections();
+	bool		isIdle() const;
+	ServerConfig	&getClientConfig(int clientSocket);
+	MimeTypeConfig	&getClientMimeTypes(int clientSocket);
 
 	// Client Handling
 	void		acceptNewConnection();
@@ -77,7 +91,11 @@ public:
 	void		processGetRequest(int clientSocket, HttpRequest &request);
 	void		processHeadRequest(int clientSocket, HttpRequest &request);
 	void		processPostRequest(int clientSocket, HttpRequest &request, bool closeConnection = false);
+	void		processPutRequest(int clientSocket, HttpRequest &request, bool closeConnection = false);
 	void		processDeleteRequest(int clientSocket, HttpRequest &request);
+	void		processRedirect(int clientSocket, HttpRequest &request, int statusCode, const std::string &url);
+	void		queueResponse(int clientSocket, HttpResponse &response, bool closeConnection = false);
+	ResponseState	*queueStreamResponse(int clientSocket, HttpResponse &response, int sourceFd, bool closeConnection = false);
 
 	// Response Handling
 	void		handleClientResponse(int clientSocket);
@@ -85,6 +103,10 @@ public:
 	void		sendLargeResponse(int clientSocket, ResponseState *responseState);
 	void		sendLargeResponseHeaders(int clientSocket, ResponseState *responseState);
 	void		sendLargeResponseChunk(int clientSocket, ResponseState *responseState);
+	void		sendStreamResponse(int clientSocket, ResponseState *responseState);
+	void		abortStreamResponse(int clientSocket, ResponseState *responseState);
+	bool		sendContinueResponse(int clientSocket);
+	void		finishResponse(int clientSocket, ResponseState *responseState);
 
 	// Error Handling
 	void		handleHeaderSizeExceeded(int clientSocket);
@@ -95,13 +117,37 @@ public:
 	// Timeout and Cleanup
 	void		checkForTimeouts();
 	void		checkForCgiTimeouts();
+	void		checkForFastCgiTimeouts();
 	void		removeClient(int clientSocket);
 
 	// Utility
-	std::string	getStatusMessage(int statusCode);
+	bool		isCgiCapacityExceeded() const;
 
 	// Handle Cgi
 	void		handleCgiOutput(int cgiReadFd);
+	void		startCgiResponse(CgiHandler *cgi);
+	void		processLocalRedirect(int clientSocket, const std::string &uri);
+	void		releaseCgi(int cgiReadFd, bool terminate);
+	void		cancelCgiRequests(int clientSocket);
+
+	// Handle FastCGI
+	void		passToFastCgi(int clientSocket, HttpRequest &request, bool closeConnection = false);
+	void		passRedirectToFastCgi(int clientSocket, HttpRequest &request, bool closeConnection = false);
+	FastCgiPool	*getFastCgiPool(const FastCgiDirective &address);
+	void		startFastCgiRequest(FastCgiPool *pool, FastCgiRequest *fastcgiRequest, bool reuseIdle = true);
+	void		startQueuedFastCgiRequests(FastCgiPool *pool);
+	void		handleFastCgiRead(int fastcgiFd);
+	void		handleFastCgiWrite(int fastcgiFd);
+	void		handleFastCgiOutput(FastCgiConnection *connection);
+	ResponseState	*startFastCgiResponse(FastCgiRequest *fastcgiRequest, int sourceFd);
+	void		appendFastCgiOutput(FastCgiRequest *fastcgiRequest, ResponseState *responseState);
+	void		completeFastCgiRequest(FastCgiConnection *connection);
+	bool		retryFastCgiRequest(FastCgiConnection *connection);
+	void		abortFastCgiRequest(FastCgiConnection *connection, int statusCode, const std::string &detail);
+	void		failFastCgiRequest(FastCgiRequest *fastcgiRequest, int statusCode, const std::string &detail);
+	void		cancelFastCgiRequests(int clientSocket);
+	void		closeFastCgiConnection(FastCgiConnection *connection);
+	bool		hasFastCgiRequests() const;
 	};
 
 #endif /* SERVER_HPP */
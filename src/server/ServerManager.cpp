@@ -1,33 +1,358 @@
 #include "ServerManager.hpp"
+#include "Clock.hpp"
 
+#include <algorithm>
+#include <sstream>
+#include <climits>
+#include <cstdlib>
 
-int	ServerManager::running = 1;
 
-ServerManager::ServerManager(std::vector<ServerConfig> &_serverConfigs, EventPoller *_eventManager, MimeTypeConfig &_mimeTypes)
-	: eventManager(_eventManager)
+int		ServerManager::running = 1;
+int		ServerManager::reloadRequested = 0;
+int		ServerManager::upgradeRequested = 0;
+int		ServerManager::gracefulShutdownRequested = 0;
+pid_t	ServerManager::upgradePid = 0;
+int		ServerManager::upgradeExited = 0;
+
+ServerManager::ServerManager(const std::string &_configFile, const std::shared_ptr<ConfigGeneration> &_generation, EventPoller *_eventManager, char **_arguments)
+	: eventManager(_eventManager), configFile(_configFile), generation(_generation), arguments(_arguments), draining(false)
 {
-	initializeServers(_serverConfigs, _mimeTypes);
+	initializeServers();
 }
 
 ServerManager::~ServerManager() { }
 
-void	ServerManager::initializeServers(std::vector<ServerConfig> &serverConfigs, MimeTypeConfig &mimeTypes)
+// listening socket of an address, sockets that stopped listening are not reused
+Server	*ServerManager::findListener(const std::string &address) const
 {
-	for (size_t i = 0; i < serverConfigs.size(); i++)
+	for (size_t i = 0; i < servers.size(); i++)
 	{
-		Server *server = new Server(serverConfigs[i], eventManager, mimeTypes);
+		if (servers[i]->_socket != -1 && servers[i]->_address == address)
+			return (servers[i]);
+	}
+	return (NULL);
+}
+
+Server	*ServerManager::createListener(ServerConfig &config, const std::shared_ptr<ConfigGeneration> &listenerGeneration)
+{
+	Server	*server = new Server(config, eventManager, listenerGeneration);
+	int		inheritedSocket = takeInheritedSocket(*server);
+
+	if (inheritedSocket != -1)
+		server->adoptSocket(inheritedSocket);
+	else
 		server->run();
-		if (server->_socket == -1)
+	if (server->_socket == -1)
+	{
+		Logger::log(Logger::ERROR, "Failed to create server", "ServerManager::createListener");
+		delete server;
+		return (NULL);
+	}
+	Logger::log(Logger::INFO, "Server is created and it is listening on port: " + std::to_string(server->_port), "ServerManager::createListener");
+	return (server);
+}
+
+/*
+	Server blocks with the same address and port share one listening socket,
+	requests are routed to them by their Host header.
+*/
+void	ServerManager::initializeServers()
+{
+	std::vector<ServerConfig>	&serverConfigs = generation->getServers();
+	bool						isUpgrade = loadInheritedSockets();
+
+	for (size_t i = 0; i < serverConfigs.size(); i++)
+	{
+		std::string	address = ConfigGeneration::getAddress(serverConfigs[i]);
+		if (findListener(address))
 		{
-			Logger::log(Logger::ERROR, "Failed to create server", "ServerManager::initializeServers");
-			delete server;
+			Logger::log(Logger::INFO, "Server is added to the listener on " + address, "ServerManager::initializeServers");
 			continue;
 		}
-		Logger::log(Logger::INFO, "Server is created and it is listening on port: " + std::to_string(server->_config.port), "ServerManager::initializeServers");
+
+		Server *server = createListener(serverConfigs[i], generation);
+		if (!server)
+			continue;
 		eventManager->registerEvent(server->_socket, READ);
 		servers.push_back(server);
 	}
+	closeInheritedSockets();
 	displayStartupDetails();
+
+	// the process that executed this one listens on the same sockets, it can stop now
+	if (isUpgrade && getppid() > 1)
+	{
+		if (servers.empty())
+		{
+			Logger::log(Logger::ERROR, "No listening socket could be adopted, the previous process keeps running", "ServerManager::initializeServers");
+			return;
+		}
+		Logger::log(Logger::INFO, "Binary upgrade completed, process " + std::to_string(getppid()) + " stops accepting", "ServerManager::initializeServers");
+		kill(getppid(), SIGQUIT);
+	}
+}
+
+/*
+	Reads the listening sockets passed by the previous binary. The variable
+	is removed so CGI scripts and later upgrades never see stale descriptors.
+	Returns whether the process was started by a binary upgrade.
+*/
+bool	ServerManager::loadInheritedSockets()
+{
+	loadActivatedSockets();
+
+	const char	*value = getenv(INHERITED_SOCKETS_ENV);
+	if (!value)
+		return (false);
+	std::string			descriptors(value);
+	std::stringstream	stream(descriptors);
+	std::string			descriptor;
+	unsetenv(INHERITED_SOCKETS_ENV);
+	while (std::getline(stream, descriptor, ';'))
+	{
+		char	*end;
+		long	fd = strtol(descriptor.c_str(), &end, 10);
+		if (descriptor.empty() || *end != '\0' || fd < 0 || fd > INT_MAX || fcntl(fd, F_GETFD) < 0)
+		{
+			Logger::log(Logger::WARN, "Ignoring invalid inherited socket \"" + descriptor + "\"", "ServerManager::loadInheritedSockets");
+			continue;
+		}
+		inheritedSockets.push_back(fd);
+	}
+	return (true);
+}
+
+/*
+	systemd socket activation: LISTEN_FDS sockets are passed from descriptor
+	SD_LISTEN_FDS_START on. LISTEN_PID tells whether they are meant for this
+	process, the variables may have been left by a parent that did not use them.
+*/
+void	ServerManager::loadActivatedSockets()
+{
+	const char	*listenPid = getenv("LISTEN_PID");
+	const char	*listenFds = getenv("LISTEN_FDS");
+
+	if (!listenPid || !listenFds)
+		return;
+	std::string	pidValue(listenPid);
+	std::string	countValue(listenFds);
+	unsetenv("LISTEN_PID");
+	unsetenv("LISTEN_FDS");
+	unsetenv("LISTEN_FDNAMES");
+
+	char	*end;
+	long	pid = strtol(pidValue.c_str(), &end, 10);
+	if (pidValue.empty() || *end != '\0' || pid != getpid())
+	{
+		Logger::log(Logger::WARN, "Ignoring LISTEN_FDS, the sockets are meant for process " + pidValue, "ServerManager::loadActivatedSockets");
+		return;
+	}
+	long	count = strtol(countValue.c_str(), &end, 10);
+	if (countValue.empty() || *end != '\0' || count <= 0 || count > INT_MAX - SD_LISTEN_FDS_START)
+	{
+		Logger::log(Logger::WARN, "Ignoring invalid LISTEN_FDS \"" + countValue + "\"", "ServerManager::loadActivatedSockets");
+		return;
+	}
+	for (int fd = SD_LISTEN_FDS_START; fd < SD_LISTEN_FDS_START + count; fd++)
+	{
+		if (fcntl(fd, F_GETFD) < 0)
+			continue;
+		inheritedSockets.push_back(fd);
+	}
+	Logger::log(Logger::INFO, std::to_string(inheritedSockets.size()) + " listening sockets passed by socket activation", "ServerManager::loadActivatedSockets");
+}
+
+// removes and returns the inherited socket listening on the server's address, -1 if none
+int	ServerManager::takeInheritedSocket(const Server &server)
+{
+	for (size_t i = 0; i < inheritedSockets.size(); i++)
+	{
+		if (server.isListeningSocket(inheritedSockets[i]))
+		{
+			int fd = inheritedSockets[i];
+			inheritedSockets.erase(inheritedSockets.begin() + i);
+			return (fd);
+		}
+	}
+	return (-1);
+}
+
+// inherited sockets whose address is no longer configured
+void	ServerManager::closeInheritedSockets()
+{
+	for (size_t i = 0; i < inheritedSockets.size(); i++)
+	{
+		Logger::log(Logger::INFO, "Closing inherited socket fd " + std::to_string(inheritedSockets[i]) + ", no server block listens on its address", "ServerManager::closeInheritedSockets");
+		close(inheritedSockets[i]);
+	}
+	inheritedSockets.clear();
+}
+
+/*
+	Loads the configuration file again. Nothing changes if it is invalid or
+	if a new address cannot be listened on, the running generation is kept.
+*/
+void	ServerManager::reload()
+{
+	std::shared_ptr<ConfigGeneration>	next = std::make_shared<ConfigGeneration>(generation->getNumber() + 1);
+
+	Logger::log(Logger::INFO, "Reloading configuration \"" + configFile + "\"", "ServerManager::reload");
+	try
+	{
+		next->load(configFile);
+	}
+	catch (const std::exception &e)
+	{
+		Logger::log(Logger::ERROR, "Configuration reload failed, generation " + std::to_string(generation->getNumber())
+			+ " is kept: " + e.what(), "ServerManager::reload");
+		return;
+	}
+
+	std::vector<Server *>		added;
+	std::vector<ServerConfig>	&serverConfigs = next->getServers();
+	for (size_t i = 0; i < serverConfigs.size(); i++)
+	{
+		std::string	address = ConfigGeneration::getAddress(serverConfigs[i]);
+		bool		isOpen = (findListener(address) != NULL);
+		for (size_t j = 0; j < added.size() && !isOpen; j++)
+			isOpen = (added[j]->_address == address);
+		if (isOpen)
+			continue;
+
+		Server *server = createListener(serverConfigs[i], next);
+		if (!server)
+		{
+			Logger::log(Logger::ERROR, "Configuration reload failed, cannot listen on " + address + ", generation "
+				+ std::to_string(generation->getNumber()) + " is kept", "ServerManager::reload");
+			for (size_t j = 0; j < added.size(); j++)
+				delete added[j];
+			return;
+		}
+		added.push_back(server);
+	}
+
+	for (size_t i = 0; i < servers.size(); i++)
+	{
+		if (servers[i]->_socket == -1)
+			continue;
+		if (next->findListener(servers[i]->_address))
+			servers[i]->setGeneration(next);
+		else
+		{
+			Logger::log(Logger::INFO, "No longer listening on " + servers[i]->_address, "ServerManager::reload");
+			servers[i]->stopListening();
+		}
+	}
+	for (size_t i = 0; i < added.size(); i++)
+	{
+		eventManager->registerEvent(added[i]->_socket, READ);
+		servers.push_back(added[i]);
+	}
+
+	retiredGenerations.push_back(generation);
+	generation = next;
+	Logger::log(Logger::INFO, "Configuration generation " + std::to_string(generation->getNumber()) + " is running", "ServerManager::reload");
+}
+
+/*
+	Executes the binary again with the same arguments. The child keeps only
+	the listening sockets open, every other descriptor (connections, CGI
+	pipes, files) stays with this process. SIGCHLD is blocked until the pid
+	is recorded, so a child failing right away is still recognized.
+*/
+void	ServerManager::upgradeBinary()
+{
+	std::vector<int>	listeningSockets;
+	std::string			descriptors;
+	sigset_t			childSignal;
+	sigset_t			previousMask;
+
+	if (draining || upgradePid > 0)
+	{
+		Logger::log(Logger::WARN, "Binary upgrade ignored, one is already in progress", "ServerManager::upgradeBinary");
+		return;
+	}
+	for (size_t i = 0; i < servers.size(); i++)
+	{
+		if (servers[i]->_socket == -1)
+			continue;
+		listeningSockets.push_back(servers[i]->_socket);
+		descriptors += std::to_string(servers[i]->_socket) + ";";
+	}
+
+	sigemptyset(&childSignal);
+	sigaddset(&childSignal, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &childSignal, &previousMask);
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		long maxDescriptors = sysconf(_SC_OPEN_MAX);
+		for (int fd = STDERR_FILENO + 1; fd < maxDescriptors; fd++)
+		{
+			if (std::find(listeningSockets.begin(), listeningSockets.end(), fd) == listeningSockets.end())
+				close(fd);
+		}
+		for (size_t i = 0; i < listeningSockets.size(); i++)
+			fcntl(listeningSockets[i], F_SETFD, 0);
+		setenv(INHERITED_SOCKETS_ENV, descriptors.c_str(), 1);
+		sigprocmask(SIG_SETMASK, &previousMask, NULL);
+		execvp(arguments[0], arguments);
+		_exit(EXIT_FAILURE);
+	}
+	if (pid < 0)
+		Logger::log(Logger::ERROR, "Binary upgrade failed, fork(): " + std::string(strerror(errno)), "ServerManager::upgradeBinary");
+	else
+	{
+		upgradePid = pid;
+		Logger::log(Logger::INFO, "Binary upgrade started, executing \"" + std::string(arguments[0]) + "\" as process " + std::to_string(pid), "ServerManager::upgradeBinary");
+	}
+	sigprocmask(SIG_SETMASK, &previousMask, NULL);
+}
+
+/*
+	Graceful shutdown: the listening sockets are closed and the process exits
+	once the connections in progress are done, or when "shutdown_timeout"
+	expires.
+*/
+void	ServerManager::stopAccepting()
+{
+	if (draining)
+		return;
+	Logger::log(Logger::INFO, "Graceful shutdown, no longer accepting connections, waiting at most "
+		+ std::to_string(generation->getShutdownTimeout()) + "s for the open ones", "ServerManager::stopAccepting");
+	for (size_t i = 0; i < servers.size(); i++)
+		servers[i]->drain();
+	draining = true;
+	drainStart = Clock::now();
+}
+
+/*
+	Called between two event loop iterations, when no request handler can
+	still refer to a retired generation or a closed socket's server.
+*/
+void	ServerManager::releaseRetired()
+{
+	for (size_t i = 0; i < servers.size(); )
+	{
+		if (servers[i]->_socket == -1 && servers[i]->isIdle())
+		{
+			delete servers[i];
+			servers.erase(servers.begin() + i);
+		}
+		else
+			i++;
+	}
+	for (size_t i = 0; i < retiredGenerations.size(); )
+	{
+		// the last reference is this one, every connection using it is closed
+		if (retiredGenerations[i].use_count() == 1)
+		{
+			Logger::log(Logger::INFO, "Configuration generation " + std::to_string(retiredGenerations[i]->getNumber()) + " is released", "ServerManager::releaseRetired");
+			retiredGenerations.erase(retiredGenerations.begin() + i);
+		}
+		else
+			i++;
+	}
 }
 
 void	ServerManager::displayStartupDetails()
@@ -36,15 +361,15 @@ void	ServerManager::displayStartupDetails()
 	for (size_t i = 0; i < servers.size(); i++)
 	{
 		if (i < servers.size() - 1)
-			std::cout << "├── \033[0;36m🔵 Listening on Port \033[1;33m" << std::to_string(servers[i]->_config.port) << "\033[0;36m 🌐\033[0m\n│\n";
+			std::cout << "├── \033[0;36m🔵 Listening on Port \033[1;33m" << std::to_string(servers[i]->_port) << "\033[0;36m 🌐\033[0m\n│\n";
 		else
-			std::cout << "└── \033[0;32m🟢 Listening on Port \033[1;33m" << std::to_string(servers[i]->_config.port) << "\033[0;32m 🌟\033[0m\n";
+			std::cout << "└── \033[0;32m🟢 Listening on Port \033[1;33m" << std::to_string(servers[i]->_port) << "\033[0;32m 🌟\033[0m\n";
 	}
 }
 
 void	ServerManager::checkTimeouts()
 {
-	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point now = Clock::now();
 	if (std::chrono::duration_cast<std::chrono::seconds>(now - lastTimeoutCheck) > std::chrono::seconds(SERVER_TIMEOUT_CHECK_INTERVAL))
 	{
 		for (size_t i = 0; i < servers.size(); i++)
@@ -54,7 +379,10 @@ void	ServerManager::checkTimeouts()
 	if (std::chrono::duration_cast<std::chrono::seconds>(now - lastCgiTimeoutCheck) > std::chrono::seconds(CGI_TIMEOUT_CHECK_INTERVAL))
 	{
 		for (size_t i = 0; i < servers.size(); i++)
+		{
 			servers[i]->checkForCgiTimeouts();
+			servers[i]->checkForFastCgiTimeouts();
+		}
 		lastCgiTimeoutCheck = now;
 	}
 }
@@ -89,6 +417,12 @@ void	ServerManager::processReadEvent(EventInfo &event)
 			servers[i]->handleCgiOutput(event.fd);
 			return;
 		}
+		else if (servers[i]->_fastcgi.count(event.fd) > 0)
+		{
+			Logger::log(Logger::DEBUG, "processReadEvent: FastCGI server sent data", "EventLoop");
+			servers[i]->handleFastCgiRead(event.fd);
+			return;
+		}
 	}
 }
 
@@ -102,16 +436,56 @@ void	ServerManager::processWriteEvent(EventInfo &event)
 			servers[i]->handleClientResponse(event.fd);
 			return;
 		}
+		else if (servers[i]->_fastcgi.count(event.fd) > 0)
+		{
+			Logger::log(Logger::DEBUG, "processWriteEvent: FastCGI server is ready to receive data", "EventLoop");
+			servers[i]->handleFastCgiWrite(event.fd);
+			return;
+		}
 	}
 }
 
 void	ServerManager::start()
 {
-	this->lastTimeoutCheck = std::chrono::steady_clock::now();
-	this->lastCgiTimeoutCheck = std::chrono::steady_clock::now();
+	Clock::update();
+	this->lastTimeoutCheck = Clock::now();
+	this->lastCgiTimeoutCheck = Clock::now();
 
 	while (running)
 	{
+		if (reloadRequested)
+		{
+			reloadRequested = 0;
+			if (!draining)
+				reload();
+		}
+		if (upgradeRequested)
+		{
+			upgradeRequested = 0;
+			upgradeBinary();
+		}
+		if (upgradeExited)
+		{
+			upgradeExited = 0;
+			Logger::log(Logger::ERROR, "The upgraded binary exited, this process keeps running", "ServerManager::start");
+		}
+		if (gracefulShutdownRequested)
+		{
+			gracefulShutdownRequested = 0;
+			stopAccepting();
+		}
+		if (!retiredGenerations.empty() || draining)
+			releaseRetired();
+		if (draining && servers.empty())
+		{
+			Logger::log(Logger::INFO, "Every connection is closed, exiting", "ServerManager::start");
+			break;
+		}
+		if (draining && Clock::now() - drainStart >= std::chrono::seconds(generation->getShutdownTimeout()))
+		{
+			Logger::log(Logger::WARN, "Shutdown timeout expired, closing the remaining connections", "ServerManager::start");
+			break;
+		}
 		checkTimeouts();
 
 		Logger::log(Logger::DEBUG, "Waiting for events", "EventLoop");
@@ -119,6 +493,7 @@ void	ServerManager::start()
 		int nev = eventManager->waitForEvents();
 		if (!running)
 			break;
+		Clock::update();
 
 		Logger::log(Logger::DEBUG, "Received " + std::to_string(nev) + " events", "EventLoop");
 
@@ -7,6 +7,9 @@
 
 #include "Server.hpp"
 #include "../config/ServerConfig.hpp"
+#include "ConfigGeneration.hpp"
+
+#include <memory>
 
 #ifdef __linux__
     // Linux-specific implementation
@@ -22,24 +25,74 @@
 #define SERVER_TIMEOUT_CHECK_INTERVAL 20 // 5 seconds
 #define CGI_TIMEOUT_CHECK_INTERVAL 20 // 10 seconds
 
+// listening socket descriptors passed to the new binary on an upgrade, "fd;fd;..."
+#define INHERITED_SOCKETS_ENV "NGINX2_LISTEN_FDS"
+
+// first descriptor of the sockets passed by systemd socket activation (LISTEN_FDS)
+#define SD_LISTEN_FDS_START 3
+
+/*
+	Owns the listening sockets and the running configuration generation.
+	On SIGHUP the configuration file is loaded into a new generation: sockets
+	whose address is still configured are kept and accept with the new
+	generation, new addresses are opened and removed ones stop accepting.
+	Open connections keep the generation they were accepted with, a retired
+	generation is freed between two event loop iterations once its last
+	connection is gone.
+
+	On SIGUSR2 the binary is executed again with the listening sockets passed
+	through the environment. The new process adopts them instead of binding
+	its own, so no connection is refused meanwhile, and once it runs it sends
+	SIGQUIT to this one, which shuts down gracefully. If the new process
+	fails to start, this one simply keeps running.
+
+	A graceful shutdown (SIGTERM or SIGQUIT) stops accepting, closes the idle
+	keep-alive connections and lets responses and CGI scripts in progress
+	finish, for at most "shutdown_timeout" seconds. SIGINT exits right away.
+
+	Sockets passed by systemd socket activation (LISTEN_FDS and LISTEN_PID)
+	are adopted the same way, matched to the server blocks by address.
+*/
 class ServerManager
 {
 private:
-	EventPoller								*eventManager;
-	std::chrono::steady_clock::time_point	lastTimeoutCheck;
-	std::chrono::steady_clock::time_point	lastCgiTimeoutCheck;
-	std::vector<Server *>					servers;
-
+	EventPoller										*eventManager;
+	std::chrono::steady_clock::time_point			lastTimeoutCheck;
+	std::chrono::steady_clock::time_point			lastCgiTimeoutCheck;
+	std::vector<Server *>							servers;
+	std::string										configFile;
+	std::shared_ptr<ConfigGeneration>				generation;
+	std::vector<std::shared_ptr<ConfigGeneration> >	retiredGenerations;
+	char											**arguments;
+	std::vector<int>								inheritedSockets;
+	bool											draining;
+	std::chrono::steady_clock::time_point			drainStart;
+
+	Server				*findListener(const std::string &address) const;
+	Server				*createListener(ServerConfig &config, const std::shared_ptr<ConfigGeneration> &listenerGeneration);
+	void				releaseRetired();
+	bool				loadInheritedSockets();
+	void				loadActivatedSockets();
+	int					takeInheritedSocket(const Server &server);
+	void				closeInheritedSockets();
 
 public:
 	static int								running;
+	static int								reloadRequested;
+	static int								upgradeRequested;
+	static int								gracefulShutdownRequested;
+	static pid_t							upgradePid;
+	static int								upgradeExited;
 
-	ServerManager(std::vector<ServerConfig> &_serverConfigs, EventPoller *_eventManager, MimeTypeConfig &_mimeTypes);
+	ServerManager(const std::string &_configFile, const std::shared_ptr<ConfigGeneration> &_generation, EventPoller *_eventManager, char **_arguments);
 	~ServerManager();
 	
 	
 
-	void				initializeServers(std::vector<ServerConfig> &serverConfigs, MimeTypeConfig &mimeTypes);
+	void				initializeServers();
+	void				reload();
+	void				upgradeBinary();
+	void				stopAccepting();
 	void				displayStartupDetails();
 	void 				checkTimeouts();
 	void				processReadEvent(EventInfo &event);
@@ -0,0 +1,69 @@
+#include "VirtualHosts.hpp"
+#include "../logging/Logger.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+VirtualHosts::VirtualHosts() : defaultServer(NULL) { }
+
+VirtualHosts::~VirtualHosts() { }
+
+void	VirtualHosts::add(ServerConfig &config)
+{
+	if (defaultServer == NULL)
+		defaultServer = &config;
+	for (size_t i = 0; i < config.serverNames.size(); i++)
+	{
+		const std::string	&name = config.serverNames[i];
+		bool				isWildcard = (name.compare(0, 2, "*.") == 0);
+
+		std::unordered_map<std::string, ServerConfig *>	&names = isWildcard ? wildcardNames : exactNames;
+		std::string										key = isWildcard ? name.substr(1) : name;
+		if (names.find(key) != names.end())
+		{
+			Logger::log(Logger::WARN, "conflicting server name \"" + name + "\" on port " + std::to_string(config.port) + ", ignored", "VirtualHosts::add");
+			continue;
+		}
+		names[key] = &config;
+	}
+}
+
+// "Example.COM:8080." is looked up as "example.com"
+std::string	VirtualHosts::normalizeHost(const std::string &host)
+{
+	std::string	name = host;
+
+	if (!name.empty() && name[0] != '[')
+		name = name.substr(0, name.find(':'));
+	if (!name.empty() && name[name.size() - 1] == '.')
+		name.erase(name.size() - 1);
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+	return (name);
+}
+
+ServerConfig	&VirtualHosts::find(const std::string &host) const
+{
+	if (exactNames.empty() && wildcardNames.empty())
+		return (*defaultServer);
+
+	std::string	name = normalizeHost(host);
+	std::unordered_map<std::string, ServerConfig *>::const_iterator it = exactNames.find(name);
+	if (it != exactNames.end())
+		return (*it->second);
+
+	// "www.a.example.com" tries ".a.example.com", then ".example.com", then ".com"
+	size_t dot = name.find('.');
+	while (!wildcardNames.empty() && dot != std::string::npos)
+	{
+		it = wildcardNames.find(name.substr(dot));
+		if (it != wildcardNames.end())
+			return (*it->second);
+		dot = name.find('.', dot + 1);
+	}
+	return (*defaultServer);
+}
+
+ServerConfig	&VirtualHosts::getDefault() const
+{
+	return (*defaultServer);
+}
@@ -0,0 +1,38 @@
+
+
+
+#pragma once
+#ifndef VIRTUALHOSTS_HPP
+#define VIRTUALHOSTS_HPP
+
+#include "../config/ServerConfig.hpp"
+
+#include <string>
+#include <unordered_map>
+
+/*
+	Server blocks sharing a listening socket, found by the Host header of a
+	request. Exact names are looked up first, then wildcard names from the
+	longest suffix ("*.a.example.com" before "*.example.com"). A request
+	matching no name goes to the default server, the first one of the socket.
+*/
+class VirtualHosts
+{
+private:
+	ServerConfig									*defaultServer;
+	std::unordered_map<std::string, ServerConfig *>	exactNames;
+	std::unordered_map<std::string, ServerConfig *>	wildcardNames; // keyed by ".example.com"
+
+	static std::string	normalizeHost(const std::string &host);
+
+public:
+	VirtualHosts();
+	~VirtualHosts();
+
+	void			add(ServerConfig &config);
+	ServerConfig	&find(const std::string &host) const;
+	ServerConfig	&getDefault() const;
+};
+
+
+#endif /* VIRTUALHOSTS_HPP */